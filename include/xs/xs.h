@@ -113,6 +113,7 @@ XS_EXPORT void xs_version (int *major, int *minor, int *patch);
 #define ETERM (XS_HAUSNUMERO + 53)
 #define EMTHREAD (XS_HAUSNUMERO + 54)  /*  Kept for backward compatibility.   */
                                        /*  Not used anymore.                  */
+#define EQUORUM (XS_HAUSNUMERO + 55)
 
 /*  This function retrieves the errno as it is known to Crossroads library.   */
 /*  The goal of this function is to make the code 100% portable, including    */
@@ -150,11 +151,40 @@ XS_EXPORT int xs_getmsgopt (xs_msg_t *msg, int option, void *optval,
 #define XS_MAX_SOCKETS 1
 #define XS_IO_THREADS 2
 #define XS_PLUGIN 3
+#define XS_IO_STATS 4
+#define XS_IO_THREAD_STATS 5
+#define XS_CLOCK 6
+
+/*  Clocks (values of XS_CLOCK context option).                               */
+#define XS_CLOCK_SYSTEM 0
+#define XS_CLOCK_TSC 1
+
+/*  Statistics of an I/O thread (XS_IO_THREAD_STATS option yields an array).  */
+typedef struct
+{
+    unsigned long long wakeups;
+    unsigned long long events;
+    unsigned long long max_batch;
+    unsigned long long in_events;
+    unsigned long long in_event_ns;
+    unsigned long long out_events;
+    unsigned long long out_event_ns;
+    unsigned long long timer_events;
+    unsigned long long timer_event_ns;
+    unsigned long long max_handler_ns;
+    unsigned long long commands;
+    unsigned long long command_ns;
+    unsigned long long timer_lag_ms;
+    unsigned long long max_timer_lag_ms;
+    int load;
+} xs_io_stats_t;
 
 XS_EXPORT void *xs_init (void);
 XS_EXPORT int xs_term (void *context);
 XS_EXPORT int xs_setctxopt (void *context, int option, const void *optval,
     size_t optvallen);
+XS_EXPORT int xs_getctxopt (void *context, int option, void *optval,
+    size_t *optvallen);
 
 /******************************************************************************/
 /*  Crossroads socket definition.                                             */
@@ -209,9 +239,68 @@ XS_EXPORT int xs_setctxopt (void *context, int option, const void *optval,
 #define XS_PATTERN_VERSION 33
 #define XS_SURVEY_TIMEOUT 35
 #define XS_SERVICE_ID 36
+#define XS_REQ_OUTSTANDING 39
+#define XS_LB_STRATEGY 40
+#define XS_RCVPRIORITY 41
+#define XS_SURVEY_QUORUM 42
+#define XS_SNDHWM_BYTES 43
+#define XS_RCVHWM_BYTES 44
+#define XS_STATS 45
+#define XS_PIPE_STATS 46
+#define XS_LATENCY 47
+#define XS_LATENCY_STATS 48
+#define XS_PIPE_RING 49
+
+/*  Load-balancing strategies (values of XS_LB_STRATEGY option).              */
+#define XS_LB_ROUND_ROBIN 0
+#define XS_LB_LEAST_QUEUED 1
+#define XS_LB_TWO_CHOICES 2
+
+/*  Socket statistics (value of XS_STATS option).                             */
+typedef struct
+{
+    unsigned long long msgs_sent;
+    unsigned long long bytes_sent;
+    unsigned long long msgs_received;
+    unsigned long long bytes_received;
+    unsigned long long msgs_dropped;
+    unsigned long long reconnects;
+    int pipes;
+} xs_stats_t;
+
+/*  Snapshot of a single pipe (XS_PIPE_STATS option yields an array).         */
+typedef struct
+{
+    unsigned long long msgs_in;
+    unsigned long long bytes_in;
+    unsigned long long msgs_out;
+    unsigned long long bytes_out;
+    unsigned long long queued_out;
+    int blocked_out;
+} xs_pipe_stats_t;
+
+/*  Hops of the message pipeline (indices into XS_LATENCY_STATS array).       */
+#define XS_HOP_OUT_PIPE 0
+#define XS_HOP_OUT_ENGINE 1
+#define XS_HOP_IN_DECODER 2
+#define XS_HOP_IN_PIPE 3
+#define XS_HOP_TOTAL 4
+#define XS_HOPS 5
+
+/*  Dwell times of messages at a single hop. Bucket N counts the samples      */
+/*  that took less than 2^(N+1) nanoseconds, the last bucket counts the rest. */
+#define XS_LATENCY_BUCKETS 32
+typedef struct
+{
+    unsigned long long count;
+    unsigned long long sum_ns;
+    unsigned long long max_ns;
+    unsigned long long buckets [XS_LATENCY_BUCKETS];
+} xs_latency_stats_t;
 
 /*  Message options                                                           */
 #define XS_MORE 1
+#define XS_AGE 2
 
 /*  Send/recv options.                                                        */
 #define XS_DONTWAIT 1
@@ -267,18 +356,35 @@ XS_EXPORT void *xs_stopwatch_start (void);
 /*  the stopwatch was started.                                                */
 XS_EXPORT unsigned long xs_stopwatch_stop (void *watch);
 
+/******************************************************************************/
+/*  Event tracing.                                                            */
+/******************************************************************************/
+
+/*  Starts recording the internal events into per-thread ring buffers of      */
+/*  'size' events each. 'size' must be a power of 2.                          */
+XS_EXPORT int xs_trace_start (int size);
+
+/*  Stops recording the events. The events recorded so far are retained.      */
+XS_EXPORT int xs_trace_stop (void);
+
+/*  Writes the recorded events into the specified file.                       */
+XS_EXPORT int xs_trace_dump (const char *filename);
+
 /******************************************************************************/
 /*  The API for pluggable filters.                                            */
 /*  THIS IS EXPERIMENTAL WORK AND MAY CHANGE WITHOUT PRIOR NOTICE.            */
 /******************************************************************************/
 
 #define XS_FILTER 34
+#define XS_FILTER_OFFLOAD 37
+#define XS_FILTER_AGGREGATE 38
 
 #define XS_PLUGIN_FILTER 1
 
 #define XS_FILTER_ALL 0
 #define XS_FILTER_PREFIX 1
 #define XS_FILTER_TOPIC 2
+#define XS_FILTER_EXACT 3
 
 typedef struct
 {
@@ -305,6 +411,15 @@ typedef struct
     int (*sf_match) (void *core, void *sf,
         const unsigned char *data, size_t size);
 
+    /*  Following member is present only in version 2 of the filter.         */
+    /*  pf_match_batch matches 'count' messages in a single call. For each    */
+    /*  message, the matching subscribers are reported using                  */
+    /*  xs_filter_matching_batch, possibly in several chunks. The 'index'     */
+    /*  passed to it is the position of the message in the 'data' and 'size' */
+    /*  arrays. The array of subscribers is valid only during the call.       */
+    void (*pf_match_batch) (void *core, void *pf, int count,
+        const unsigned char **data, const size_t *size);
+
 } xs_filter_t;
 
 XS_EXPORT int xs_filter_subscribed (void *core,
@@ -315,6 +430,9 @@ XS_EXPORT int xs_filter_unsubscribed (void *core,
 
 XS_EXPORT int xs_filter_matching (void *core, void *subscriber);
 
+XS_EXPORT int xs_filter_matching_batch (void *core, int index,
+    void **subscribers, int count);
+
 #undef XS_EXPORT
 
 #ifdef __cplusplus
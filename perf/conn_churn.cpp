@@ -0,0 +1,291 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+//  Measures the cost of setting up and tearing down connections. In each
+//  round a batch of PUSH sockets connects to a single PULL socket, each of
+//  them sends one message and all of them are closed afterwards. Two modes
+//  are available:
+//
+//  churn: PULL socket is bound for the whole test, the batch connects to an
+//         existing listener.
+//  storm: the batch connects while there's no listener, PULL socket is
+//         bound afterwards so that all the peers reconnect at once, such as
+//         after a failover.
+//
+//  Reported are connects per second, time from connect (or bind in storm
+//  mode) to the delivery of the first message and growth of the resident
+//  memory of the process.
+
+#include "../include/xs/xs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "histogram.hpp"
+
+#if defined XS_HAVE_LINUX
+#include <unistd.h>
+#endif
+
+static void *ctx;
+
+//  Returns resident set size of the process in bytes or zero if it cannot
+//  be determined on this platform.
+static uint64_t resident_memory ()
+{
+#if defined XS_HAVE_LINUX
+    FILE *f = fopen ("/proc/self/statm", "r");
+    if (!f)
+        return 0;
+    unsigned long size;
+    unsigned long resident;
+    int rc = fscanf (f, "%lu %lu", &size, &resident);
+    fclose (f);
+    if (rc != 2)
+        return 0;
+    return (uint64_t) resident * sysconf (_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+static void *open_socket (int type_)
+{
+    void *s = xs_socket (ctx, type_);
+    if (!s) {
+        printf ("error in xs_socket: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+    return s;
+}
+
+static void close_socket (void *s_)
+{
+    int rc = xs_close (s_);
+    if (rc != 0) {
+        printf ("error in xs_close: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+}
+
+static void set_option (void *s_, int option_, int value_)
+{
+    int rc = xs_setsockopt (s_, option_, &value_, sizeof (value_));
+    if (rc != 0) {
+        printf ("error in xs_setsockopt: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+}
+
+static void *bind_listener (const char *address_, int backlog_)
+{
+    void *s = open_socket (XS_PULL);
+    set_option (s, XS_LINGER, 0);
+    set_option (s, XS_BACKLOG, backlog_);
+    set_option (s, XS_RCVTIMEO, 10000);
+    int rc = xs_bind (s, address_);
+    if (rc == -1) {
+        printf ("error in xs_bind: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+    return s;
+}
+
+int main (int argc, char *argv [])
+{
+    const char *address;
+    int connection_count;
+    int round_count;
+    bool storm;
+    int io_threads;
+    void *listener;
+    void **peers;
+    uint64_t *connected;
+    histogram_t *ttfm;
+    uint64_t start;
+    uint64_t end;
+    uint64_t setup_time;
+    uint64_t teardown_time;
+    uint64_t rss_start;
+    uint64_t rss_first;
+    uint64_t rss;
+    int rc;
+    int i;
+    int round;
+
+    if (argc < 4 || argc > 6) {
+        printf ("usage: conn_churn <address> <connection-count> "
+            "<round-count> [churn|storm] [io-threads]\n");
+        return 1;
+    }
+    address = argv [1];
+    connection_count = atoi (argv [2]);
+    round_count = atoi (argv [3]);
+    storm = argc > 4 && strcmp (argv [4], "storm") == 0;
+    if (argc > 4 && !storm && strcmp (argv [4], "churn") != 0) {
+        printf ("unknown mode: %s\n", argv [4]);
+        return 1;
+    }
+    io_threads = argc > 5 ? atoi (argv [5]) : 1;
+    if (connection_count <= 0 || round_count <= 0 || io_threads <= 0) {
+        printf ("invalid arguments\n");
+        return 1;
+    }
+
+    peers = (void**) malloc (connection_count * sizeof (void*));
+    connected = (uint64_t*) malloc (connection_count * sizeof (uint64_t));
+    ttfm = (histogram_t*) malloc (sizeof (histogram_t));
+    if (!peers || !connected || !ttfm) {
+        printf ("out of memory\n");
+        return 1;
+    }
+    histogram_init (ttfm);
+
+    ctx = xs_init ();
+    if (!ctx) {
+        printf ("error in xs_init: %s\n", xs_strerror (errno));
+        return 1;
+    }
+    //  Sockets closed in one round may not be deallocated yet when the next
+    //  round starts, thus the limit has to accommodate two batches.
+    int max_sockets = 2 * connection_count + 16;
+    rc = xs_setctxopt (ctx, XS_MAX_SOCKETS, &max_sockets,
+        sizeof (max_sockets));
+    if (rc == 0)
+        rc = xs_setctxopt (ctx, XS_IO_THREADS, &io_threads,
+            sizeof (io_threads));
+    if (rc != 0) {
+        printf ("error in xs_setctxopt: %s\n", xs_strerror (errno));
+        return 1;
+    }
+
+    listener = storm ? NULL : bind_listener (address, connection_count);
+
+    setup_time = 0;
+    teardown_time = 0;
+    rss_start = resident_memory ();
+    rss_first = 0;
+
+    for (round = 0; round != round_count; round++) {
+
+        //  Open the whole batch of connections. Each peer queues a message
+        //  carrying its index so that the time to the first message can be
+        //  measured per connection.
+        start = perf_now_ns ();
+        for (i = 0; i != connection_count; i++) {
+            peers [i] = open_socket (XS_PUSH);
+            set_option (peers [i], XS_LINGER, 0);
+            rc = xs_connect (peers [i], address);
+            if (rc == -1) {
+                printf ("error in xs_connect: %s\n", xs_strerror (errno));
+                return 1;
+            }
+            connected [i] = perf_now_ns ();
+            rc = xs_send (peers [i], &i, sizeof (i), XS_DONTWAIT);
+            if (rc != (int) sizeof (i)) {
+                printf ("error in xs_send: %s\n", xs_strerror (errno));
+                return 1;
+            }
+        }
+
+        //  In storm mode the listener shows up only once all the peers are
+        //  already trying to connect. Connection time is measured from
+        //  the moment of the bind.
+        if (storm) {
+            listener = bind_listener (address, connection_count);
+            start = perf_now_ns ();
+            for (i = 0; i != connection_count; i++)
+                connected [i] = start;
+        }
+
+        for (i = 0; i != connection_count; i++) {
+            int index;
+            rc = xs_recv (listener, &index, sizeof (index), 0);
+            if (rc != (int) sizeof (index) || index < 0 ||
+                  index >= connection_count) {
+                printf ("error in xs_recv: %s\n", xs_strerror (errno));
+                return 1;
+            }
+            histogram_record (ttfm, perf_now_ns () - connected [index]);
+        }
+        end = perf_now_ns ();
+        setup_time += end - start;
+
+        //  Tear the connections down.
+        start = perf_now_ns ();
+        for (i = 0; i != connection_count; i++)
+            close_socket (peers [i]);
+        if (storm) {
+            close_socket (listener);
+            listener = NULL;
+        }
+        end = perf_now_ns ();
+        teardown_time += end - start;
+
+        //  Listener is closed asynchronously. Give it time to release
+        //  the address before it is bound anew in the next round.
+        if (storm)
+            xs_poll (NULL, 0, 100);
+
+        if (round == 0)
+            rss_first = resident_memory ();
+    }
+    rss = resident_memory ();
+
+    if (listener)
+        close_socket (listener);
+    rc = xs_term (ctx);
+    if (rc != 0) {
+        printf ("error in xs_term: %s\n", xs_strerror (errno));
+        return 1;
+    }
+
+    uint64_t total = (uint64_t) connection_count * round_count;
+    printf ("mode: %s\n", storm ? "storm" : "churn");
+    printf ("connection count: %d\n", connection_count);
+    printf ("round count: %d\n", round_count);
+    printf ("io threads: %d\n", io_threads);
+    printf ("connects per second: %.0f\n",
+        (double) total * 1000000000 / (setup_time ? setup_time : 1));
+    printf ("closes per second: %.0f\n",
+        (double) total * 1000000000 / (teardown_time ? teardown_time : 1));
+    printf ("mean time to first message [us]: %.3f\n",
+        histogram_mean (ttfm) / 1000);
+    histogram_print (ttfm, "time to first message");
+    if (rss_start) {
+        printf ("resident memory at start [kB]: %llu\n",
+            (unsigned long long) (rss_start / 1024));
+        printf ("resident memory after first round [kB]: %llu\n",
+            (unsigned long long) (rss_first / 1024));
+        printf ("resident memory at end [kB]: %llu\n",
+            (unsigned long long) (rss / 1024));
+        printf ("growth after first round per connection [B]: %.1f\n",
+            rss > rss_first ?
+            (double) (rss - rss_first) / (total - connection_count + 1) : 0.0);
+    }
+
+    free (ttfm);
+    free (connected);
+    free (peers);
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __XS_PERF_HISTOGRAM_HPP_INCLUDED__
+#define __XS_PERF_HISTOGRAM_HPP_INCLUDED__
+
+//  High-resolution clocks and log-linear (HDR-style) histogram shared by
+//  the performance tools. Values are recorded in nanoseconds. Each power
+//  of two is split into 64 linear sub-buckets, so any recorded value is
+//  reported with relative error below 1/64 while the whole 64-bit range
+//  fits into a few thousand counters.
+
+#include "../src/platform.hpp"
+#include "../src/stdint.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined XS_HAVE_WINDOWS
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <time.h>
+#endif
+
+enum
+{
+    histogram_sub_bits = 7,
+    histogram_sub_count = 1 << histogram_sub_bits,
+    histogram_half_count = histogram_sub_count / 2,
+    histogram_buckets = (64 - histogram_sub_bits + 1) * histogram_half_count +
+        histogram_half_count
+};
+
+typedef struct
+{
+    uint64_t counts [histogram_buckets];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+    double sum_sq;
+} histogram_t;
+
+//  Returns monotonic time in nanoseconds.
+static inline uint64_t perf_now_ns ()
+{
+#if defined XS_HAVE_WINDOWS
+    LARGE_INTEGER ticks_per_second;
+    LARGE_INTEGER tick;
+    QueryPerformanceFrequency (&ticks_per_second);
+    QueryPerformanceCounter (&tick);
+    return (uint64_t) ((double) tick.QuadPart * 1000000000 /
+        (double) ticks_per_second.QuadPart);
+#elif defined HAVE_CLOCK_GETTIME && defined CLOCK_MONOTONIC
+    struct timespec tv;
+    clock_gettime (CLOCK_MONOTONIC, &tv);
+    return tv.tv_sec * (uint64_t) 1000000000 + tv.tv_nsec;
+#elif defined HAVE_GETHRTIME
+    return gethrtime ();
+#else
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return tv.tv_sec * (uint64_t) 1000000000 + tv.tv_usec * 1000;
+#endif
+}
+
+//  Returns CPU time consumed by the calling thread in nanoseconds or zero
+//  if it can't be measured on this platform.
+static inline uint64_t perf_thread_cpu_ns ()
+{
+#if defined XS_HAVE_WINDOWS
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes (GetCurrentThread (), &creation, &exit, &kernel,
+          &user))
+        return 0;
+    uint64_t k = ((uint64_t) kernel.dwHighDateTime << 32) |
+        kernel.dwLowDateTime;
+    uint64_t u = ((uint64_t) user.dwHighDateTime << 32) | user.dwLowDateTime;
+    return (k + u) * 100;
+#elif defined HAVE_CLOCK_GETTIME && defined CLOCK_THREAD_CPUTIME_ID
+    struct timespec tv;
+    if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &tv) != 0)
+        return 0;
+    return tv.tv_sec * (uint64_t) 1000000000 + tv.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+static inline void histogram_init (histogram_t *h_)
+{
+    memset (h_, 0, sizeof (histogram_t));
+    h_->min = (uint64_t) -1;
+}
+
+//  Values below 'histogram_sub_count' have buckets of their own. Above that
+//  the value is shifted so that its top 'histogram_sub_bits' bits are kept.
+static inline int histogram_index (uint64_t value_)
+{
+    if (value_ < histogram_sub_count)
+        return (int) value_;
+    int shift = 0;
+    while ((value_ >> shift) >= histogram_sub_count)
+        ++shift;
+    return shift * histogram_half_count + (int) (value_ >> shift);
+}
+
+//  Returns the highest value that falls into the bucket.
+static inline uint64_t histogram_value (int index_)
+{
+    if (index_ < histogram_sub_count)
+        return index_;
+    int shift = index_ / histogram_half_count - 1;
+    uint64_t sub = index_ - shift * histogram_half_count;
+    return ((sub + 1) << shift) - 1;
+}
+
+static inline void histogram_record (histogram_t *h_, uint64_t value_)
+{
+    h_->counts [histogram_index (value_)]++;
+    h_->total++;
+    if (value_ < h_->min)
+        h_->min = value_;
+    if (value_ > h_->max)
+        h_->max = value_;
+    h_->sum += (double) value_;
+    h_->sum_sq += (double) value_ * (double) value_;
+}
+
+//  Returns the value at the specified percentile (0-100).
+static inline uint64_t histogram_percentile (histogram_t *h_,
+    double percentile_)
+{
+    if (!h_->total)
+        return 0;
+    uint64_t target = (uint64_t) ceil (percentile_ / 100 * h_->total);
+    if (target < 1)
+        target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i != histogram_buckets; i++) {
+        seen += h_->counts [i];
+        if (seen >= target) {
+            uint64_t value = histogram_value (i);
+            return value > h_->max ? h_->max : value;
+        }
+    }
+    return h_->max;
+}
+
+static inline double histogram_mean (histogram_t *h_)
+{
+    return h_->total ? h_->sum / h_->total : 0;
+}
+
+static inline double histogram_stddev (histogram_t *h_)
+{
+    if (!h_->total)
+        return 0;
+    double mean = histogram_mean (h_);
+    double variance = h_->sum_sq / h_->total - mean * mean;
+    return variance > 0 ? sqrt (variance) : 0;
+}
+
+//  Writes the percentile distribution in the format used by HdrHistogram
+//  (.hgrm), so that it can be plotted and compared by the usual tools.
+//  Percentile steps are halved each time the remaining distance to 100%
+//  halves; 'ticks_' is the number of steps per halving. Values are
+//  written in microseconds.
+static inline void histogram_write (histogram_t *h_, FILE *out_, int ticks_)
+{
+    fprintf (out_, "%12s %14s %10s %14s\n\n", "Value", "Percentile",
+        "TotalCount", "1/(1-Percentile)");
+
+    double next = 0;
+    uint64_t seen = 0;
+    for (int i = 0; h_->total && i != histogram_buckets; i++) {
+        if (!h_->counts [i])
+            continue;
+        seen += h_->counts [i];
+        uint64_t value = histogram_value (i);
+        if (value > h_->max)
+            value = h_->max;
+        double percentile = 100.0 * seen / h_->total;
+        if (seen == h_->total) {
+            fprintf (out_, "%12.3f %14.12f %10lu\n", value / 1000.0, 1.0,
+                (unsigned long) seen);
+            break;
+        }
+        if (percentile < next)
+            continue;
+        fprintf (out_, "%12.3f %14.12f %10lu %14.2f\n", value / 1000.0,
+            percentile / 100, (unsigned long) seen,
+            100 / (100 - percentile));
+        while (next <= percentile) {
+            double halvings = floor (log (100 / (100 - next)) / log (2.0)) + 1;
+            next += 100 / (pow (2.0, halvings) * ticks_);
+        }
+    }
+
+    fprintf (out_, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n",
+        histogram_mean (h_) / 1000, histogram_stddev (h_) / 1000);
+    fprintf (out_, "#[Max     = %12.3f, Total count    = %12lu]\n",
+        h_->max / 1000.0, (unsigned long) h_->total);
+    fprintf (out_, "#[Buckets = %12d, SubBuckets     = %12d]\n",
+        64 - histogram_sub_bits + 1, histogram_sub_count);
+}
+
+//  Prints the summary of the distribution to the standard output.
+static inline void histogram_print (histogram_t *h_, const char *name_)
+{
+    static const double percentiles [] = {50, 90, 99, 99.9, 99.99};
+
+    printf ("%s percentiles [us]:\n", name_);
+    printf ("  %-8s %12.3f\n", "min", h_->total ? h_->min / 1000.0 : 0.0);
+    for (size_t i = 0; i != sizeof (percentiles) / sizeof (percentiles [0]);
+          i++) {
+        char label [16];
+        sprintf (label, "%g%%", percentiles [i]);
+        printf ("  %-8s %12.3f\n", label,
+            histogram_percentile (h_, percentiles [i]) / 1000.0);
+    }
+    printf ("  %-8s %12.3f\n", "max", h_->max / 1000.0);
+}
+
+//  Saves the full distribution into the file. Returns -1 on failure.
+static inline int histogram_save (histogram_t *h_, const char *filename_)
+{
+    FILE *out = fopen (filename_, "w");
+    if (!out)
+        return -1;
+    histogram_write (h_, out, 5);
+    return fclose (out) == 0 ? 0 : -1;
+}
+
+#endif
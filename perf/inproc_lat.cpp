@@ -25,6 +25,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "histogram.hpp"
+
 #include "../src/platform.hpp"
 
 #if defined XS_HAVE_WINDOWS
@@ -36,6 +38,7 @@
 
 static size_t message_size;
 static int roundtrip_count;
+static histogram_t histogram;
 
 #if defined XS_HAVE_WINDOWS
 static unsigned int __stdcall worker (void *ctx_)
@@ -113,14 +116,18 @@ int main (int argc, char *argv [])
     void *watch;
     unsigned long elapsed;
     double latency;
+    const char *histogram_file;
+    uint64_t start;
 
-    if (argc != 3) {
-        printf ("usage: inproc_lat <message-size> <roundtrip-count>\n");
+    if (argc != 3 && argc != 4) {
+        printf ("usage: inproc_lat <message-size> <roundtrip-count> "
+            "[histogram-file]\n");
         return 1;
     }
 
     message_size = atoi (argv [1]);
     roundtrip_count = atoi (argv [2]);
+    histogram_file = argc == 4 ? argv [3] : NULL;
 
     ctx = xs_init ();
     if (!ctx) {
@@ -165,9 +172,12 @@ int main (int argc, char *argv [])
     printf ("message size: %d [B]\n", (int) message_size);
     printf ("roundtrip count: %d\n", (int) roundtrip_count);
 
+    histogram_init (&histogram);
+
     watch = xs_stopwatch_start ();
 
     for (i = 0; i != roundtrip_count; i++) {
+        start = perf_now_ns ();
         rc = xs_sendmsg (s, &msg, 0);
         if (rc < 0) {
             printf ("error in xs_sendmsg: %s\n", xs_strerror (errno));
@@ -182,6 +192,7 @@ int main (int argc, char *argv [])
             printf ("message of incorrect size received\n");
             return -1;
         }
+        histogram_record (&histogram, perf_now_ns () - start);
     }
 
     elapsed = xs_stopwatch_stop (watch);
@@ -215,6 +226,17 @@ int main (int argc, char *argv [])
 
     printf ("average latency: %.3f [us]\n", (double) latency);
 
+    //  Unlike the average above, the distribution is of whole roundtrips.
+    histogram_write (&histogram, stdout, 1);
+    histogram_print (&histogram, "roundtrip latency");
+    if (histogram_file) {
+        rc = histogram_save (&histogram, histogram_file);
+        if (rc != 0) {
+            printf ("error writing %s\n", histogram_file);
+            return -1;
+        }
+    }
+
     rc = xs_close (s);
     if (rc != 0) {
         printf ("error in xs_close: %s\n", xs_strerror (errno));
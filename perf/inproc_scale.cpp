@@ -0,0 +1,457 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+//  Measures how inproc messaging scales with the number of application
+//  threads. M producer threads send messages to N consumer threads through
+//  one of the following topologies:
+//
+//  pipeline: each producer (PUSH) connects to each of the consumers (PULL),
+//            messages are load-balanced among the consumers.
+//  broker:   producers (DEALER) connect to a ROUTER, broker thread forwards
+//            the messages to a DEALER which load-balances them among
+//            the consumers (DEALER).
+//
+//  Throughput of each thread and the aggregate throughput are reported.
+
+#include "../include/xs/xs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "histogram.hpp"
+#include "../src/atomic_counter.hpp"
+
+#if defined XS_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined XS_HAVE_WINDOWS
+typedef HANDLE thread_handle_t;
+#define THREAD_RESULT unsigned int __stdcall
+#define THREAD_RETURN return 0
+#else
+typedef pthread_t thread_handle_t;
+#define THREAD_RESULT void *
+#define THREAD_RETURN return NULL
+#endif
+
+typedef struct
+{
+    int id;
+    void *socket;
+    thread_handle_t handle;
+    volatile uint64_t count;
+    uint64_t start;
+    uint64_t end;
+
+    //  Avoid false sharing of the counters among the threads.
+    char padding [64];
+} worker_t;
+
+static void *ctx;
+static bool broker;
+static int producer_count;
+static int consumer_count;
+static size_t message_size;
+static int message_count;
+static worker_t *producers;
+static worker_t *consumers;
+static worker_t forwarder;
+static xs::atomic_counter_t ready;
+static xs::atomic_counter_t go;
+static xs::atomic_counter_t done;
+
+static void start_thread (worker_t *worker_, THREAD_RESULT (*fn_) (void*))
+{
+#if defined XS_HAVE_WINDOWS
+    worker_->handle = (HANDLE) _beginthreadex (NULL, 0, fn_, worker_, 0,
+        NULL);
+    if (worker_->handle == 0) {
+        printf ("error in _beginthreadex\n");
+        exit (1);
+    }
+#else
+    int rc = pthread_create (&worker_->handle, NULL, fn_, worker_);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", xs_strerror (rc));
+        exit (1);
+    }
+#endif
+}
+
+static void join_thread (worker_t *worker_)
+{
+#if defined XS_HAVE_WINDOWS
+    DWORD rc = WaitForSingleObject (worker_->handle, INFINITE);
+    if (rc == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        exit (1);
+    }
+    BOOL rc2 = CloseHandle (worker_->handle);
+    if (rc2 == 0) {
+        printf ("error in CloseHandle\n");
+        exit (1);
+    }
+#else
+    int rc = pthread_join (worker_->handle, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", xs_strerror (rc));
+        exit (1);
+    }
+#endif
+}
+
+static void *open_socket (int type_)
+{
+    void *s = xs_socket (ctx, type_);
+    if (!s) {
+        printf ("error in xs_socket: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+    return s;
+}
+
+static void close_socket (void *s_)
+{
+    int rc = xs_close (s_);
+    if (rc != 0) {
+        printf ("error in xs_close: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+}
+
+//  Consumers and broker wake up periodically to check whether the test
+//  is over.
+static void set_timeout (void *s_)
+{
+    int timeout = 100;
+    int rc = xs_setsockopt (s_, XS_RCVTIMEO, &timeout, sizeof (timeout));
+    if (rc != 0) {
+        printf ("error in xs_setsockopt: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+}
+
+static THREAD_RESULT producer (void *arg_)
+{
+    worker_t *self = (worker_t*) arg_;
+    char endpoint [64];
+    char *buf;
+    int rc;
+    int i;
+
+    buf = (char*) calloc (1, message_size + 1);
+    if (!buf) {
+        printf ("out of memory\n");
+        exit (1);
+    }
+
+    self->socket = open_socket (broker ? XS_DEALER : XS_PUSH);
+    for (i = 0; i != (broker ? 1 : consumer_count); i++) {
+        if (broker)
+            strcpy (endpoint, "inproc://scale_front");
+        else
+            sprintf (endpoint, "inproc://scale_%d", i);
+        rc = xs_connect (self->socket, endpoint);
+        if (rc == -1) {
+            printf ("error in xs_connect: %s\n", xs_strerror (errno));
+            exit (1);
+        }
+    }
+
+    //  Wait till all the producers are connected.
+    ready.add (1);
+    while (!go.get ())
+        xs_poll (NULL, 0, 1);
+
+    self->start = perf_now_ns ();
+    for (i = 0; i != message_count; i++) {
+        rc = xs_send (self->socket, buf, message_size, 0);
+        if (rc < 0) {
+            printf ("error in xs_send: %s\n", xs_strerror (errno));
+            exit (1);
+        }
+        self->count++;
+    }
+    self->end = perf_now_ns ();
+
+    close_socket (self->socket);
+    free (buf);
+    THREAD_RETURN;
+}
+
+static THREAD_RESULT consumer (void *arg_)
+{
+    worker_t *self = (worker_t*) arg_;
+    char *buf;
+    int rc;
+
+    buf = (char*) malloc (message_size + 1);
+    if (!buf) {
+        printf ("out of memory\n");
+        exit (1);
+    }
+
+    set_timeout (self->socket);
+    while (true) {
+        rc = xs_recv (self->socket, buf, message_size + 1, 0);
+        if (rc < 0 && errno == EAGAIN) {
+            if (done.get ())
+                break;
+            continue;
+        }
+        if (rc != (int) message_size) {
+            printf ("error in xs_recv: %s\n", xs_strerror (errno));
+            exit (1);
+        }
+        self->end = perf_now_ns ();
+        if (!self->count)
+            self->start = self->end;
+        self->count++;
+    }
+
+    close_socket (self->socket);
+    free (buf);
+    THREAD_RETURN;
+}
+
+//  Forwards messages from ROUTER to DEALER, dropping the identities.
+static THREAD_RESULT forward (void *arg_)
+{
+    worker_t *self = (worker_t*) arg_;
+    void *front = ((void**) self->socket) [0];
+    void *back = ((void**) self->socket) [1];
+    xs_msg_t msg;
+    int more;
+    size_t more_size;
+    bool identity;
+    int rc;
+
+    rc = xs_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in xs_msg_init: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    set_timeout (front);
+    identity = true;
+    while (true) {
+        rc = xs_recvmsg (front, &msg, 0);
+        if (rc < 0 && errno == EAGAIN) {
+            if (done.get ())
+                break;
+            continue;
+        }
+        if (rc < 0) {
+            printf ("error in xs_recvmsg: %s\n", xs_strerror (errno));
+            exit (1);
+        }
+        more_size = sizeof (more);
+        rc = xs_getsockopt (front, XS_RCVMORE, &more, &more_size);
+        if (rc != 0) {
+            printf ("error in xs_getsockopt: %s\n", xs_strerror (errno));
+            exit (1);
+        }
+        if (identity) {
+            identity = !more;
+            continue;
+        }
+        identity = !more;
+        rc = xs_sendmsg (back, &msg, more ? XS_SNDMORE : 0);
+        if (rc < 0) {
+            printf ("error in xs_sendmsg: %s\n", xs_strerror (errno));
+            exit (1);
+        }
+        if (!more) {
+            self->end = perf_now_ns ();
+            if (!self->count)
+                self->start = self->end;
+            self->count++;
+        }
+    }
+
+    rc = xs_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in xs_msg_close: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+    close_socket (front);
+    close_socket (back);
+    THREAD_RETURN;
+}
+
+static double rate (worker_t *worker_)
+{
+    uint64_t elapsed = worker_->end - worker_->start;
+    if (!elapsed)
+        elapsed = 1;
+    return (double) worker_->count * 1000000000 / elapsed;
+}
+
+int main (int argc, char *argv [])
+{
+    void *sockets [2];
+    char endpoint [64];
+    uint64_t total;
+    uint64_t received;
+    uint64_t start;
+    uint64_t end;
+    int rc;
+    int i;
+
+    if (argc != 6) {
+        printf ("usage: inproc_scale pipeline|broker <producer-count> "
+            "<consumer-count> <message-size> <messages-per-producer>\n");
+        return 1;
+    }
+    if (strcmp (argv [1], "broker") == 0)
+        broker = true;
+    else if (strcmp (argv [1], "pipeline") != 0) {
+        printf ("unknown topology: %s\n", argv [1]);
+        return 1;
+    }
+    producer_count = atoi (argv [2]);
+    consumer_count = atoi (argv [3]);
+    message_size = atoi (argv [4]);
+    message_count = atoi (argv [5]);
+    if (producer_count <= 0 || consumer_count <= 0 || message_count <= 0) {
+        printf ("thread and message counts must be positive\n");
+        return 1;
+    }
+
+    producers = (worker_t*) calloc (producer_count, sizeof (worker_t));
+    consumers = (worker_t*) calloc (consumer_count, sizeof (worker_t));
+    if (!producers || !consumers) {
+        printf ("out of memory\n");
+        return -1;
+    }
+
+    ctx = xs_init ();
+    if (!ctx) {
+        printf ("error in xs_init: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    //  Inproc endpoints have to be bound before the peers connect.
+    if (broker) {
+        sockets [0] = open_socket (XS_ROUTER);
+        rc = xs_bind (sockets [0], "inproc://scale_front");
+        if (rc == -1) {
+            printf ("error in xs_bind: %s\n", xs_strerror (errno));
+            return -1;
+        }
+        sockets [1] = open_socket (XS_DEALER);
+        rc = xs_bind (sockets [1], "inproc://scale_back");
+        if (rc == -1) {
+            printf ("error in xs_bind: %s\n", xs_strerror (errno));
+            return -1;
+        }
+        forwarder.socket = sockets;
+    }
+    for (i = 0; i != consumer_count; i++) {
+        consumers [i].id = i;
+        if (broker) {
+            consumers [i].socket = open_socket (XS_DEALER);
+            rc = xs_connect (consumers [i].socket, "inproc://scale_back");
+        }
+        else {
+            consumers [i].socket = open_socket (XS_PULL);
+            sprintf (endpoint, "inproc://scale_%d", i);
+            rc = xs_bind (consumers [i].socket, endpoint);
+        }
+        if (rc == -1) {
+            printf ("error in xs_bind/xs_connect: %s\n",
+                xs_strerror (errno));
+            return -1;
+        }
+    }
+
+    for (i = 0; i != consumer_count; i++)
+        start_thread (&consumers [i], consumer);
+    if (broker)
+        start_thread (&forwarder, forward);
+    for (i = 0; i != producer_count; i++) {
+        producers [i].id = i;
+        start_thread (&producers [i], producer);
+    }
+
+    //  Start all the producers at the same time.
+    while (ready.get () != (xs::atomic_counter_t::integer_t) producer_count)
+        xs_poll (NULL, 0, 1);
+    start = perf_now_ns ();
+    go.set (1);
+
+    //  Wait till all the messages are received.
+    total = (uint64_t) producer_count * message_count;
+    while (true) {
+        received = 0;
+        for (i = 0; i != consumer_count; i++)
+            received += consumers [i].count;
+        if (received == total)
+            break;
+        xs_poll (NULL, 0, 10);
+    }
+    done.set (1);
+
+    for (i = 0; i != producer_count; i++)
+        join_thread (&producers [i]);
+    for (i = 0; i != consumer_count; i++)
+        join_thread (&consumers [i]);
+    if (broker)
+        join_thread (&forwarder);
+
+    end = start;
+    for (i = 0; i != consumer_count; i++)
+        if (consumers [i].count && consumers [i].end > end)
+            end = consumers [i].end;
+    if (end == start)
+        end = start + 1;
+
+    printf ("topology: %s\n", broker ? "broker" : "pipeline");
+    printf ("producer count: %d\n", producer_count);
+    printf ("consumer count: %d\n", consumer_count);
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("messages per producer: %d\n", message_count);
+    for (i = 0; i != producer_count; i++)
+        printf ("producer %d: %d [msg/s]\n", i, (int) rate (&producers [i]));
+    for (i = 0; i != consumer_count; i++)
+        printf ("consumer %d: %lu messages, %d [msg/s]\n", i,
+            (unsigned long) consumers [i].count, (int) rate (&consumers [i]));
+    if (broker)
+        printf ("broker: %d [msg/s]\n", (int) rate (&forwarder));
+    printf ("aggregate throughput: %d [msg/s]\n",
+        (int) ((double) total * 1000000000 / (end - start)));
+
+    rc = xs_term (ctx);
+    if (rc != 0) {
+        printf ("error in xs_term: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    free (consumers);
+    free (producers);
+
+    return 0;
+}
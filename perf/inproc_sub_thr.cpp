@@ -0,0 +1,329 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/xs/xs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/platform.hpp"
+
+#if defined XS_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Length of the topic at the beginning of each message, e.g. "T000042".
+#define TOPIC_SIZE 7
+
+static int message_count;
+static size_t message_size;
+static int subscription_count;
+
+#if defined XS_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *ctx_)
+#else
+static void *worker (void *ctx_)
+#endif
+{
+    void *s;
+    int rc;
+    int i;
+    int hwm;
+    char topic [16];
+    xs_msg_t msg;
+
+    s = xs_socket (ctx_, XS_XPUB);
+    if (!s) {
+        printf ("error in xs_socket: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    hwm = 0;
+    rc = xs_setsockopt (s, XS_SNDHWM, &hwm, sizeof (hwm));
+    if (rc == -1) {
+        printf ("error in xs_setsockopt: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    rc = xs_connect (s, "inproc://sub_thr_test");
+    if (rc == -1) {
+        printf ("error in xs_connect: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    //  Wait for the subscription to arrive so that no messages are lost.
+    //  The subscriber aggregates all its subscriptions into a single one.
+    rc = xs_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in xs_msg_init: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+    rc = xs_recvmsg (s, &msg, 0);
+    if (rc < 0) {
+        printf ("error in xs_recvmsg: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+    rc = xs_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in xs_msg_close: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    //  Cycle through twice as many topics as there are subscriptions so that
+    //  every other message is dropped by the subscriber.
+    for (i = 0; i != message_count; i++) {
+
+        rc = xs_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in xs_msg_init_size: %s\n", xs_strerror (errno));
+            exit (1);
+        }
+#if defined XS_MAKE_VALGRIND_HAPPY
+        memset (xs_msg_data (&msg), 0, message_size);
+#endif
+        sprintf (topic, "T%06d", i % (subscription_count * 2));
+        memcpy (xs_msg_data (&msg), topic, TOPIC_SIZE);
+
+        rc = xs_sendmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in xs_sendmsg: %s\n", xs_strerror (errno));
+            exit (1);
+        }
+        rc = xs_msg_close (&msg);
+        if (rc != 0) {
+            printf ("error in xs_msg_close: %s\n", xs_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = xs_close (s);
+    if (rc != 0) {
+        printf ("error in xs_close: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+#if defined XS_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int main (int argc, char *argv [])
+{
+#if defined XS_HAVE_WINDOWS
+    HANDLE local_thread;
+#else
+    pthread_t local_thread;
+#endif
+    void *ctx;
+    void *s;
+    int rc;
+    int i;
+    int hwm;
+    int aggregate;
+    int expected_count;
+    char topic [16];
+    xs_msg_t msg;
+    void *watch;
+    unsigned long elapsed;
+    unsigned long throughput;
+    unsigned long delivered;
+
+    if (argc != 4) {
+        printf ("usage: inproc_sub_thr <message-size> <message-count> "
+            "<subscription-count>\n");
+        return 1;
+    }
+
+    message_size = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+    subscription_count = atoi (argv [3]);
+
+    if (message_size < TOPIC_SIZE) {
+        printf ("message size must be at least %d bytes\n", TOPIC_SIZE);
+        return 1;
+    }
+    if (subscription_count < 1 || subscription_count > 100000) {
+        printf ("subscription count must be between 1 and 100000\n");
+        return 1;
+    }
+
+    //  Number of messages whose topic falls into the subscribed range.
+    expected_count = message_count / (subscription_count * 2) *
+        subscription_count;
+    if (message_count % (subscription_count * 2) < subscription_count)
+        expected_count += message_count % (subscription_count * 2);
+    else
+        expected_count += subscription_count;
+    if (expected_count < 2) {
+        printf ("message count too low\n");
+        return 1;
+    }
+
+    ctx = xs_init ();
+    if (!ctx) {
+        printf ("error in xs_init: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    s = xs_socket (ctx, XS_SUB);
+    if (!s) {
+        printf ("error in xs_socket: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    hwm = 0;
+    rc = xs_setsockopt (s, XS_RCVHWM, &hwm, sizeof (hwm));
+    if (rc == -1) {
+        printf ("error in xs_setsockopt: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    //  Forward a single empty subscription upstream. That way the publisher
+    //  sends every message and all the filtering happens in the subscriber.
+    aggregate = 0;
+    rc = xs_setsockopt (s, XS_FILTER_AGGREGATE, &aggregate,
+        sizeof (aggregate));
+    if (rc == -1) {
+        printf ("error in xs_setsockopt: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    for (i = 0; i != subscription_count; i++) {
+        sprintf (topic, "T%06d", i);
+        rc = xs_setsockopt (s, XS_SUBSCRIBE, topic, TOPIC_SIZE);
+        if (rc == -1) {
+            printf ("error in xs_setsockopt: %s\n", xs_strerror (errno));
+            return -1;
+        }
+    }
+
+    rc = xs_bind (s, "inproc://sub_thr_test");
+    if (rc == -1) {
+        printf ("error in xs_bind: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+#if defined XS_HAVE_WINDOWS
+    local_thread = (HANDLE) _beginthreadex (NULL, 0,
+        worker, ctx, 0 , NULL);
+    if (local_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        return -1;
+    }
+#else
+    rc = pthread_create (&local_thread, NULL, worker, ctx);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", xs_strerror (rc));
+        return -1;
+    }
+#endif
+
+    rc = xs_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in xs_msg_init: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", (int) message_count);
+    printf ("subscription count: %d\n", (int) subscription_count);
+
+    rc = xs_recvmsg (s, &msg, 0);
+    if (rc < 0) {
+        printf ("error in xs_recvmsg: %s\n", xs_strerror (errno));
+        return -1;
+    }
+    if (xs_msg_size (&msg) != message_size) {
+        printf ("message of incorrect size received\n");
+        return -1;
+    }
+
+    watch = xs_stopwatch_start ();
+
+    for (i = 0; i != expected_count - 1; i++) {
+        rc = xs_recvmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in xs_recvmsg: %s\n", xs_strerror (errno));
+            return -1;
+        }
+        if (xs_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            return -1;
+        }
+    }
+
+    elapsed = xs_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = xs_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in xs_msg_close: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+#if defined XS_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (local_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        return -1;
+    }
+    BOOL rc3 = CloseHandle (local_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        return -1;
+    }
+#else
+    rc = pthread_join (local_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", xs_strerror (rc));
+        return -1;
+    }
+#endif
+
+    rc = xs_close (s);
+    if (rc != 0) {
+        printf ("error in xs_close: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    rc = xs_term (ctx);
+    if (rc != 0) {
+        printf ("error in xs_term: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    //  Messages processed include the ones dropped by the filter.
+    throughput = (unsigned long)
+        ((double) message_count / (double) elapsed * 1000000);
+    delivered = (unsigned long)
+        ((double) expected_count / (double) elapsed * 1000000);
+
+    printf ("mean throughput: %d [msg/s]\n", (int) throughput);
+    printf ("mean delivered throughput: %d [msg/s]\n", (int) delivered);
+
+    return 0;
+}
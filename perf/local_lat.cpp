@@ -30,18 +30,20 @@ int main (int argc, char *argv [])
     size_t message_size;
     void *ctx;
     void *s;
+    int pattern_version;
     int rc;
     int i;
     xs_msg_t msg;
 
-    if (argc != 4) {
+    if (argc != 4 && argc != 5) {
         printf ("usage: local_lat <bind-to> <message-size> "
-            "<roundtrip-count>\n");
+            "<roundtrip-count> [pattern-version]\n");
         return 1;
     }
     bind_to = argv [1];
     message_size = atoi (argv [2]);
     roundtrip_count = atoi (argv [3]);
+    pattern_version = argc == 5 ? atoi (argv [4]) : 0;
 
     ctx = xs_init ();
     if (!ctx) {
@@ -55,6 +57,17 @@ int main (int argc, char *argv [])
         return -1;
     }
 
+    //  Use the non-default version of the request/reply pattern, e.g. 4 for
+    //  the envelope packed into the body. Both ends must use the same one.
+    if (pattern_version) {
+        rc = xs_setsockopt (s, XS_PATTERN_VERSION, &pattern_version,
+            sizeof (pattern_version));
+        if (rc == -1) {
+            printf ("error in xs_setsockopt: %s\n", xs_strerror (errno));
+            return -1;
+        }
+    }
+
     rc = xs_bind (s, bind_to);
     if (rc == -1) {
         printf ("error in xs_bind: %s\n", xs_strerror (errno));
@@ -0,0 +1,241 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+//  Microbenchmark of the lock-free pipes used to pass messages between
+//  threads. It compares ypipe_t (linked list of chunks) with yring_t
+//  (preallocated ring) under the same conditions a message pipe with
+//  finite HWM works in: the writer is allowed to have at most HWM items
+//  in flight and the reader reports the items it has consumed every HWM/2
+//  items. Both threads busy-wait (yielding the CPU in between attempts),
+//  so the results are meaningful only on a multi-core box.
+
+#include "../include/xs/xs.h"
+#include "../src/ypipe.hpp"
+#include "../src/yring.hpp"
+#include "../src/atomic_counter.hpp"
+#include "../src/platform.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined XS_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+typedef xs::ypipe_base_t <xs_msg_t> pipe_type;
+typedef xs::ypipe_t <xs_msg_t, 256> ypipe_type;
+typedef xs::yring_t <xs_msg_t> yring_type;
+
+static pipe_type *pipe;
+static int message_count;
+static int hwm;
+static int flush_batch;
+static xs::atomic_counter_t consumed;
+
+static void yield ()
+{
+#if defined XS_HAVE_WINDOWS
+    SwitchToThread ();
+#else
+    sched_yield ();
+#endif
+}
+
+//  The pipes have no virtual functions. Call the actual implementation
+//  the same way message pipes do.
+
+static void pipe_write (const xs_msg_t &msg_)
+{
+    if (!pipe->ring)
+        ((ypipe_type*) pipe)->write (msg_, false);
+    else
+        ((yring_type*) pipe)->write (msg_, false);
+}
+
+static void pipe_flush ()
+{
+    if (!pipe->ring)
+        ((ypipe_type*) pipe)->flush ();
+    else
+        ((yring_type*) pipe)->flush ();
+}
+
+static bool pipe_read (xs_msg_t *msg_)
+{
+    if (!pipe->ring)
+        return ((ypipe_type*) pipe)->read (msg_);
+    return ((yring_type*) pipe)->read (msg_);
+}
+
+static void pipe_delete ()
+{
+    if (!pipe->ring)
+        delete (ypipe_type*) pipe;
+    else
+        delete (yring_type*) pipe;
+}
+
+#if defined XS_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *arg_)
+#else
+static void *worker (void *arg_)
+#endif
+{
+    int i;
+    xs_msg_t msg;
+
+    memset (&msg, 0, sizeof (msg));
+    for (i = 0; i != message_count; i++) {
+
+        //  Wait while HWM is reached. Messages written so far have to be
+        //  flushed first, otherwise the reader would never get to them.
+        if ((xs::atomic_counter_t::integer_t) i - consumed.get () >=
+              (xs::atomic_counter_t::integer_t) hwm) {
+            pipe_flush ();
+            while ((xs::atomic_counter_t::integer_t) i - consumed.get () >=
+                  (xs::atomic_counter_t::integer_t) hwm)
+                yield ();
+        }
+
+        pipe_write (msg);
+        if ((i + 1) % flush_batch == 0)
+            pipe_flush ();
+    }
+    pipe_flush ();
+
+#if defined XS_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int main (int argc, char *argv [])
+{
+#if defined XS_HAVE_WINDOWS
+    HANDLE local_thread;
+#else
+    pthread_t local_thread;
+#endif
+    int rc;
+    int i;
+    int lwm;
+    int unreported;
+    xs_msg_t msg;
+    void *watch;
+    unsigned long elapsed;
+    unsigned long throughput;
+
+    if (argc != 4 && argc != 5) {
+        printf ("usage: pipe_thr ypipe|yring <hwm> <message-count> "
+            "[<flush-batch>]\n");
+        return 1;
+    }
+
+    hwm = atoi (argv [2]);
+    message_count = atoi (argv [3]);
+    flush_batch = argc == 5 ? atoi (argv [4]) : 1;
+    if (hwm <= 0 || message_count <= 0 || flush_batch <= 0) {
+        printf ("hwm, message count and flush batch must be positive\n");
+        return 1;
+    }
+    if (flush_batch > hwm)
+        flush_batch = hwm;
+    lwm = (hwm + 1) / 2;
+
+    if (strcmp (argv [1], "ypipe") == 0)
+        pipe = new ypipe_type ();
+    else if (strcmp (argv [1], "yring") == 0)
+        pipe = new yring_type (((size_t) hwm + 2) * 8 / 7 + 1);
+    else {
+        printf ("unknown pipe type: %s\n", argv [1]);
+        return 1;
+    }
+
+    printf ("pipe type: %s\n", argv [1]);
+    printf ("hwm: %d\n", hwm);
+    printf ("message count: %d\n", message_count);
+    printf ("flush batch: %d\n", flush_batch);
+
+    watch = xs_stopwatch_start ();
+
+#if defined XS_HAVE_WINDOWS
+    local_thread = (HANDLE) _beginthreadex (NULL, 0,
+        worker, NULL, 0 , NULL);
+    if (local_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        return -1;
+    }
+#else
+    rc = pthread_create (&local_thread, NULL, worker, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", xs_strerror (rc));
+        return -1;
+    }
+#endif
+
+    unreported = 0;
+    for (i = 0; i != message_count; i++) {
+        while (!pipe_read (&msg))
+            yield ();
+        if (++unreported == lwm) {
+            consumed.add (unreported);
+            unreported = 0;
+        }
+    }
+
+    elapsed = xs_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+#if defined XS_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (local_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        return -1;
+    }
+    BOOL rc3 = CloseHandle (local_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        return -1;
+    }
+#else
+    rc = pthread_join (local_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", xs_strerror (rc));
+        return -1;
+    }
+#endif
+
+    pipe_delete ();
+
+    throughput = (unsigned long)
+        ((double) message_count / (double) elapsed * 1000000);
+
+    printf ("mean throughput: %d [msg/s]\n", (int) throughput);
+
+    return 0;
+}
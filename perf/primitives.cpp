@@ -0,0 +1,403 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+//  Benchmarks of the core primitives in isolation from the socket layer:
+//  lock-free pipes, queue, mailbox, message and array. Each benchmark is
+//  run once to warm up and then the specified number of times. Time per
+//  operation (minimum, median and maximum over the runs) is reported in
+//  nanoseconds and, if the CPU has a time stamp counter, in cycles.
+//  The primitives are not exported from the shared library, so their
+//  sources are compiled directly into the tool.
+
+#include "../src/ypipe.hpp"
+#include "../src/yring.hpp"
+#include "../src/yqueue.hpp"
+#include "../src/mailbox.hpp"
+#include "../src/command.hpp"
+#include "../src/msg.hpp"
+#include "../src/array.hpp"
+#include "../src/thread.hpp"
+#include "../src/clock.hpp"
+#include "../src/config.hpp"
+#include "../src/err.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "histogram.hpp"
+
+#if defined XS_HAVE_WINDOWS
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+typedef void (bench_fn) (int count_);
+
+typedef struct
+{
+    const char *name;
+    bench_fn *fn;
+    int count;
+} bench_t;
+
+static void yield ()
+{
+#if defined XS_HAVE_WINDOWS
+    SwitchToThread ();
+#else
+    sched_yield ();
+#endif
+}
+
+//  Single-threaded pipe benchmarks. Each operation is a write, flush and
+//  read of a single message, either one at a time or in batches.
+
+template <typename P> static void pipe_single (P *pipe_, int count_,
+    int batch_)
+{
+    xs::msg_t msg;
+    int rc = msg.init ();
+    errno_assert (rc == 0);
+    for (int i = 0; i < count_; i += batch_) {
+        for (int j = 0; j != batch_; j++)
+            pipe_->write (msg, false);
+        pipe_->flush ();
+        for (int j = 0; j != batch_; j++) {
+            bool ok = pipe_->read (&msg);
+            xs_assert (ok);
+        }
+    }
+}
+
+static void ypipe_single (int count_)
+{
+    xs::ypipe_t <xs::msg_t, xs::message_pipe_granularity> pipe;
+    pipe_single (&pipe, count_, 1);
+}
+
+static void ypipe_batch (int count_)
+{
+    xs::ypipe_t <xs::msg_t, xs::message_pipe_granularity> pipe;
+    pipe_single (&pipe, count_, 100);
+}
+
+static void yring_single (int count_)
+{
+    xs::yring_t <xs::msg_t> pipe (xs::message_ring_max_size);
+    pipe_single (&pipe, count_, 1);
+}
+
+static void yring_batch (int count_)
+{
+    xs::yring_t <xs::msg_t> pipe (xs::message_ring_max_size);
+    pipe_single (&pipe, count_, 100);
+}
+
+//  Cross-thread pipe benchmarks. Writer thread flushes each message, reader
+//  polls the pipe. As in the real pipe, writer is allowed to get at most
+//  'pipe_hwm' messages ahead of the reader.
+
+enum { pipe_hwm = 1000 };
+
+template <typename P> struct pipe_ctx_t
+{
+    P *pipe;
+    int count;
+    xs::atomic_counter_t consumed;
+};
+
+template <typename P> static void pipe_writer (void *arg_)
+{
+    pipe_ctx_t <P> *ctx = (pipe_ctx_t <P>*) arg_;
+    xs::msg_t msg;
+    int rc = msg.init ();
+    errno_assert (rc == 0);
+    for (int i = 0; i != ctx->count; i++) {
+        while ((xs::atomic_counter_t::integer_t) i - ctx->consumed.get () >=
+              pipe_hwm)
+            yield ();
+        ctx->pipe->write (msg, false);
+        ctx->pipe->flush ();
+    }
+}
+
+template <typename P> static void pipe_cross (P *pipe_, int count_)
+{
+    pipe_ctx_t <P> ctx;
+    ctx.pipe = pipe_;
+    ctx.count = count_;
+
+    xs::thread_t writer;
+    xs::thread_start (&writer, pipe_writer <P>, &ctx);
+
+    xs::msg_t msg;
+    for (int i = 0; i != count_; i++) {
+        while (!pipe_->read (&msg))
+            yield ();
+        if ((i + 1) % (pipe_hwm / 2) == 0)
+            ctx.consumed.add (pipe_hwm / 2);
+    }
+
+    xs::thread_stop (&writer);
+}
+
+static void ypipe_cross (int count_)
+{
+    xs::ypipe_t <xs::msg_t, xs::message_pipe_granularity> pipe;
+    pipe_cross (&pipe, count_);
+}
+
+static void yring_cross (int count_)
+{
+    xs::yring_t <xs::msg_t> pipe (xs::message_ring_max_size);
+    pipe_cross (&pipe, count_);
+}
+
+//  Each operation is a push and pop of a single item, done in batches.
+
+static void yqueue_push_pop (int count_)
+{
+    xs::yqueue_t <xs::msg_t, xs::message_pipe_granularity> queue;
+    xs::msg_t msg;
+    int rc = msg.init ();
+    errno_assert (rc == 0);
+    for (int i = 0; i < count_; i += 100) {
+        for (int j = 0; j != 100; j++) {
+            queue.push ();
+            queue.back () = msg;
+        }
+        for (int j = 0; j != 100; j++) {
+            msg = queue.front ();
+            queue.pop ();
+        }
+    }
+}
+
+//  Mailbox benchmarks. Each operation is a command sent by one of the
+//  producer threads and received by the consumer.
+
+typedef struct
+{
+    xs::mailbox_t *mailbox;
+    int count;
+} mailbox_ctx_t;
+
+static void mailbox_producer (void *arg_)
+{
+    mailbox_ctx_t *ctx = (mailbox_ctx_t*) arg_;
+    xs::command_t cmd;
+    memset (&cmd, 0, sizeof (cmd));
+    cmd.type = xs::command_t::activate_read;
+    for (int i = 0; i != ctx->count; i++)
+        xs::mailbox_send (ctx->mailbox, cmd);
+}
+
+static void mailbox_producers (int count_, int producers_)
+{
+    xs::mailbox_t mailbox;
+    int rc = xs::mailbox_init (&mailbox);
+    errno_assert (rc == 0);
+
+    mailbox_ctx_t ctx;
+    ctx.mailbox = &mailbox;
+    ctx.count = count_ / producers_;
+
+    xs::thread_t threads [4];
+    xs_assert (producers_ <= 4);
+    for (int i = 0; i != producers_; i++)
+        xs::thread_start (&threads [i], mailbox_producer, &ctx);
+
+    xs::command_t cmd;
+    for (int i = 0; i != ctx.count * producers_; i++) {
+        rc = xs::mailbox_recv (&mailbox, &cmd, -1);
+        errno_assert (rc == 0);
+    }
+
+    for (int i = 0; i != producers_; i++)
+        xs::thread_stop (&threads [i]);
+    xs::mailbox_close (&mailbox);
+}
+
+static void mailbox_1 (int count_)
+{
+    mailbox_producers (count_, 1);
+}
+
+static void mailbox_2 (int count_)
+{
+    mailbox_producers (count_, 2);
+}
+
+static void mailbox_4 (int count_)
+{
+    mailbox_producers (count_, 4);
+}
+
+//  Message benchmarks. Each operation is either initialisation and
+//  destruction of a message or copying of a message and destroying
+//  the copy, which amounts to reference count increment and decrement.
+
+static void msg_init_close (int count_, size_t size_)
+{
+    xs::msg_t msg;
+    for (int i = 0; i != count_; i++) {
+        int rc = msg.init_size (size_);
+        errno_assert (rc == 0);
+        rc = msg.close ();
+        errno_assert (rc == 0);
+    }
+}
+
+static void msg_vsm (int count_)
+{
+    msg_init_close (count_, 16);
+}
+
+static void msg_lmsg (int count_)
+{
+    msg_init_close (count_, 1024);
+}
+
+static void msg_copy (int count_)
+{
+    xs::msg_t msg;
+    int rc = msg.init_size (1024);
+    errno_assert (rc == 0);
+    xs::msg_t copy;
+    rc = copy.init ();
+    errno_assert (rc == 0);
+    for (int i = 0; i != count_; i++) {
+        rc = copy.copy (msg);
+        errno_assert (rc == 0);
+        rc = copy.close ();
+        errno_assert (rc == 0);
+        rc = copy.init ();
+        errno_assert (rc == 0);
+    }
+    rc = copy.close ();
+    errno_assert (rc == 0);
+    rc = msg.close ();
+    errno_assert (rc == 0);
+}
+
+//  Array benchmark. Each operation is an insertion of an item into
+//  an array of 100 items and its removal.
+
+class item_t : public xs::array_item_t <>
+{
+};
+
+static void array_push_erase (int count_)
+{
+    item_t items [101];
+    xs::array_t <item_t> array;
+    for (int i = 0; i != 100; i++)
+        array.push_back (&items [i]);
+    for (int i = 0; i != count_; i++) {
+        array.push_back (&items [100]);
+        array.swap (array.index (&items [100]), i % 100);
+        array.erase (&items [100]);
+    }
+    array.clear ();
+}
+
+static const bench_t benchmarks [] = {
+    {"ypipe_single", ypipe_single, 10000000},
+    {"ypipe_batch", ypipe_batch, 10000000},
+    {"ypipe_cross", ypipe_cross, 1000000},
+    {"yring_single", yring_single, 10000000},
+    {"yring_batch", yring_batch, 10000000},
+    {"yring_cross", yring_cross, 1000000},
+    {"yqueue_push_pop", yqueue_push_pop, 10000000},
+    {"mailbox_1", mailbox_1, 1000000},
+    {"mailbox_2", mailbox_2, 1000000},
+    {"mailbox_4", mailbox_4, 1000000},
+    {"msg_vsm", msg_vsm, 10000000},
+    {"msg_lmsg", msg_lmsg, 1000000},
+    {"msg_copy", msg_copy, 10000000},
+    {"array_push_erase", array_push_erase, 10000000}
+};
+
+int main (int argc, char *argv [])
+{
+    const char *prefix;
+    int repetitions;
+    double *ns;
+    double *cycles;
+
+    if (argc > 3) {
+        printf ("usage: primitives [<benchmark-prefix>] [<repetitions>]\n");
+        return 1;
+    }
+    prefix = argc >= 2 ? argv [1] : "";
+    repetitions = argc == 3 ? atoi (argv [2]) : 5;
+    if (repetitions <= 0) {
+        printf ("repetitions must be positive\n");
+        return 1;
+    }
+
+    ns = (double*) malloc (repetitions * sizeof (double));
+    cycles = (double*) malloc (repetitions * sizeof (double));
+    if (!ns || !cycles) {
+        printf ("out of memory\n");
+        return -1;
+    }
+
+    printf ("%-18s %10s %12s %12s %12s %14s\n", "benchmark", "count",
+        "min [ns]", "median [ns]", "max [ns]", "median [cycles]");
+
+    for (size_t i = 0; i != sizeof (benchmarks) / sizeof (benchmarks [0]);
+          i++) {
+        const bench_t *bench = &benchmarks [i];
+        if (strncmp (bench->name, prefix, strlen (prefix)) != 0)
+            continue;
+
+        //  Warm-up run.
+        bench->fn (bench->count / 10);
+
+        for (int j = 0; j != repetitions; j++) {
+            uint64_t start = perf_now_ns ();
+            uint64_t start_tsc = xs::clock_t::rdtsc ();
+            bench->fn (bench->count);
+            uint64_t end_tsc = xs::clock_t::rdtsc ();
+            uint64_t end = perf_now_ns ();
+            ns [j] = (double) (end - start) / bench->count;
+            cycles [j] = (double) (end_tsc - start_tsc) / bench->count;
+        }
+        std::sort (ns, ns + repetitions);
+        std::sort (cycles, cycles + repetitions);
+
+        printf ("%-18s %10d %12.2f %12.2f %12.2f", bench->name, bench->count,
+            ns [0], ns [repetitions / 2], ns [repetitions - 1]);
+        if (cycles [repetitions / 2] > 0)
+            printf (" %14.1f\n", cycles [repetitions / 2]);
+        else
+            printf (" %14s\n", "n/a");
+    }
+
+    free (cycles);
+    free (ns);
+
+    return 0;
+}
@@ -0,0 +1,559 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+//  Measures how publishing scales with the number of subscribers, the number
+//  of subscriptions and the filter type. One publisher (XPUB) sends messages
+//  to N subscribers (SUB), each running in its own thread and connected via
+//  the specified transport. Topics of the published messages are drawn
+//  either uniformly or from a Zipf-like distribution. The publisher's
+//  send rate and CPU time, aggregate delivery rate and, for each subscriber,
+//  the number of delivered messages and delivery lag are reported.
+
+#include "../include/xs/xs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "histogram.hpp"
+
+#if defined XS_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Topics are fixed width so that a subscription for one topic is never
+//  a prefix of another one. Topic of the end-of-test message sent to each
+//  subscriber has the same format.
+#define TOPIC_SIZE 8
+#define TOPIC_FORMAT "T.%06d"
+#define END_FORMAT "E.%06d"
+
+//  Size of the precomputed sequence of topics to publish.
+#define SEQUENCE_SIZE 65536
+
+typedef struct
+{
+    int id;
+    uint64_t received;
+    uint64_t lag_p50;
+    uint64_t lag_p99;
+    uint64_t lag_max;
+    uint64_t last;
+} sub_stats_t;
+
+static void *ctx;
+static const char *address;
+static int subscriber_count;
+static int subscription_count;
+static int topic_count;
+static size_t message_size;
+static int message_count;
+static int filter;
+
+#if defined XS_HAVE_WINDOWS
+static unsigned int __stdcall subscriber (void *arg_)
+#else
+static void *subscriber (void *arg_)
+#endif
+{
+    int id = (int) (size_t) arg_;
+    void *s;
+    void *done;
+    int rc;
+    int i;
+    char topic [16];
+    xs_msg_t msg;
+    uint64_t stamp;
+    uint64_t now;
+    histogram_t *lags;
+    sub_stats_t stats;
+
+    lags = (histogram_t*) malloc (sizeof (histogram_t));
+    if (!lags) {
+        printf ("out of memory\n");
+        exit (1);
+    }
+    histogram_init (lags);
+    memset (&stats, 0, sizeof (stats));
+    stats.id = id;
+
+    s = xs_socket (ctx, XS_SUB);
+    if (!s) {
+        printf ("error in xs_socket: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    rc = xs_setsockopt (s, XS_FILTER, &filter, sizeof (filter));
+    if (rc == -1) {
+        printf ("error in xs_setsockopt: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    rc = xs_connect (s, address);
+    if (rc == -1) {
+        printf ("error in xs_connect: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    //  Subscribe for a contiguous range of topics, different for each
+    //  subscriber. The subscription for the end-of-test message goes last
+    //  so that once the publisher gets it, it knows all the subscriptions
+    //  from this subscriber are in place.
+    for (i = 0; i != subscription_count; i++) {
+        sprintf (topic, TOPIC_FORMAT,
+            (id * subscription_count + i) % topic_count);
+        rc = xs_setsockopt (s, XS_SUBSCRIBE, topic, TOPIC_SIZE);
+        if (rc == -1) {
+            printf ("error in xs_setsockopt: %s\n", xs_strerror (errno));
+            exit (1);
+        }
+    }
+    sprintf (topic, END_FORMAT, id);
+    rc = xs_setsockopt (s, XS_SUBSCRIBE, topic, TOPIC_SIZE);
+    if (rc == -1) {
+        printf ("error in xs_setsockopt: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    rc = xs_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in xs_msg_init: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    while (true) {
+        rc = xs_recvmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in xs_recvmsg: %s\n", xs_strerror (errno));
+            exit (1);
+        }
+        now = perf_now_ns ();
+        if (*(char*) xs_msg_data (&msg) == 'E')
+            break;
+        if (xs_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            exit (1);
+        }
+        memcpy (&stamp, (char*) xs_msg_data (&msg) + TOPIC_SIZE,
+            sizeof (stamp));
+        histogram_record (lags, now - stamp);
+        stats.received++;
+        stats.last = now;
+    }
+
+    rc = xs_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in xs_msg_close: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    rc = xs_close (s);
+    if (rc != 0) {
+        printf ("error in xs_close: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+    //  Report the results to the publisher.
+    stats.lag_p50 = histogram_percentile (lags, 50);
+    stats.lag_p99 = histogram_percentile (lags, 99);
+    stats.lag_max = lags->max;
+    free (lags);
+
+    done = xs_socket (ctx, XS_PUSH);
+    if (!done) {
+        printf ("error in xs_socket: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+    rc = xs_connect (done, "inproc://pubsub_done");
+    if (rc == -1) {
+        printf ("error in xs_connect: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+    rc = xs_send (done, &stats, sizeof (stats), 0);
+    if (rc < 0) {
+        printf ("error in xs_send: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+    rc = xs_close (done);
+    if (rc != 0) {
+        printf ("error in xs_close: %s\n", xs_strerror (errno));
+        exit (1);
+    }
+
+#if defined XS_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+//  Fills in the sequence of topic numbers to publish.
+static void generate_sequence (int *sequence_, bool zipf_)
+{
+    double *cumulative;
+    double total;
+    double r;
+    unsigned int seed;
+    int lo;
+    int hi;
+    int i;
+
+    cumulative = (double*) malloc (topic_count * sizeof (double));
+    if (!cumulative) {
+        printf ("out of memory\n");
+        exit (1);
+    }
+    total = 0;
+    for (i = 0; i != topic_count; i++) {
+        total += zipf_ ? 1.0 / (i + 1) : 1.0;
+        cumulative [i] = total;
+    }
+
+    seed = 1;
+    for (i = 0; i != SEQUENCE_SIZE; i++) {
+        seed = seed * 1103515245 + 12345;
+        r = (double) (seed >> 8) / (1 << 24) * total;
+        lo = 0;
+        hi = topic_count - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (cumulative [mid] <= r)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        sequence_ [i] = lo;
+    }
+
+    free (cumulative);
+}
+
+int main (int argc, char *argv [])
+{
+#if defined XS_HAVE_WINDOWS
+    HANDLE *threads;
+#else
+    pthread_t *threads;
+#endif
+    void *pub;
+    void *done;
+    int rc;
+    int i;
+    int j;
+    bool zipf;
+    int *sequence;
+    char (*topics) [16];
+    uint64_t *sent;
+    sub_stats_t *stats;
+    bool *finished;
+    int finished_count;
+    int ready;
+    char buf [256];
+    uint64_t stamp;
+    uint64_t start;
+    uint64_t end;
+    uint64_t cpu_start;
+    uint64_t cpu_end;
+    uint64_t last;
+    uint64_t expected;
+    uint64_t total_received;
+    uint64_t total_expected;
+    xs_pollitem_t item;
+
+    if (argc < 7 || argc > 9) {
+        printf ("usage: pubsub_thr <address> <subscriber-count> "
+            "<subscriptions-per-subscriber> <topic-count> <message-size> "
+            "<message-count> [uniform|zipf] [prefix|topic|exact]\n");
+        return 1;
+    }
+    address = argv [1];
+    subscriber_count = atoi (argv [2]);
+    subscription_count = atoi (argv [3]);
+    topic_count = atoi (argv [4]);
+    message_size = atoi (argv [5]);
+    message_count = atoi (argv [6]);
+    zipf = argc >= 8 && strcmp (argv [7], "zipf") == 0;
+    if (argc >= 8 && !zipf && strcmp (argv [7], "uniform") != 0) {
+        printf ("unknown topic distribution: %s\n", argv [7]);
+        return 1;
+    }
+    filter = XS_FILTER_PREFIX;
+    if (argc == 9) {
+        if (strcmp (argv [8], "topic") == 0)
+            filter = XS_FILTER_TOPIC;
+        else if (strcmp (argv [8], "exact") == 0)
+            filter = XS_FILTER_EXACT;
+        else if (strcmp (argv [8], "prefix") != 0) {
+            printf ("unknown filter: %s\n", argv [8]);
+            return 1;
+        }
+    }
+    if (subscriber_count <= 0 || subscriber_count > 1000000 ||
+          subscription_count <= 0 || topic_count <= 0 ||
+          topic_count > 1000000 || message_count <= 0) {
+        printf ("invalid arguments\n");
+        return 1;
+    }
+    if (message_size < TOPIC_SIZE + sizeof (uint64_t) ||
+          message_size > sizeof (buf)) {
+        printf ("message size must be between %d and %d bytes\n",
+            (int) (TOPIC_SIZE + sizeof (uint64_t)), (int) sizeof (buf));
+        return 1;
+    }
+    if (subscription_count > topic_count)
+        subscription_count = topic_count;
+
+    //  Prepare everything that can be computed upfront, so that it doesn't
+    //  distort the publisher's CPU usage.
+    sequence = (int*) malloc (SEQUENCE_SIZE * sizeof (int));
+    topics = (char (*) [16]) malloc (topic_count * 16);
+    sent = (uint64_t*) calloc (topic_count, sizeof (uint64_t));
+    stats = (sub_stats_t*) calloc (subscriber_count, sizeof (sub_stats_t));
+    finished = (bool*) calloc (subscriber_count, sizeof (bool));
+#if defined XS_HAVE_WINDOWS
+    threads = (HANDLE*) malloc (subscriber_count * sizeof (HANDLE));
+#else
+    threads = (pthread_t*) malloc (subscriber_count * sizeof (pthread_t));
+#endif
+    if (!sequence || !topics || !sent || !stats || !finished || !threads) {
+        printf ("out of memory\n");
+        return -1;
+    }
+    generate_sequence (sequence, zipf);
+    for (i = 0; i != topic_count; i++)
+        sprintf (topics [i], TOPIC_FORMAT, i);
+    memset (buf, 0, sizeof (buf));
+
+    ctx = xs_init ();
+    if (!ctx) {
+        printf ("error in xs_init: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    pub = xs_socket (ctx, XS_XPUB);
+    if (!pub) {
+        printf ("error in xs_socket: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    rc = xs_bind (pub, address);
+    if (rc == -1) {
+        printf ("error in xs_bind: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    done = xs_socket (ctx, XS_PULL);
+    if (!done) {
+        printf ("error in xs_socket: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    rc = xs_bind (done, "inproc://pubsub_done");
+    if (rc == -1) {
+        printf ("error in xs_bind: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    for (i = 0; i != subscriber_count; i++) {
+#if defined XS_HAVE_WINDOWS
+        threads [i] = (HANDLE) _beginthreadex (NULL, 0,
+            subscriber, (void*) (size_t) i, 0 , NULL);
+        if (threads [i] == 0) {
+            printf ("error in _beginthreadex\n");
+            return -1;
+        }
+#else
+        rc = pthread_create (&threads [i], NULL, subscriber,
+            (void*) (size_t) i);
+        if (rc != 0) {
+            printf ("error in pthread_create: %s\n", xs_strerror (rc));
+            return -1;
+        }
+#endif
+    }
+
+    //  Wait till all the subscriptions are in place. Each subscriber has
+    //  a unique end-of-test subscription, which is sent last.
+    ready = 0;
+    while (ready != subscriber_count) {
+        rc = xs_recv (pub, buf, sizeof (buf), 0);
+        if (rc < 0) {
+            printf ("error in xs_recv: %s\n", xs_strerror (errno));
+            return -1;
+        }
+        if (rc >= 4 + TOPIC_SIZE && buf [1] == 1 && buf [4] == 'E')
+            ready++;
+    }
+
+    printf ("address: %s\n", address);
+    printf ("subscriber count: %d\n", subscriber_count);
+    printf ("subscriptions per subscriber: %d\n", subscription_count);
+    printf ("topic count: %d (%s)\n", topic_count, zipf ? "zipf" : "uniform");
+    printf ("filter: %s\n", filter == XS_FILTER_PREFIX ? "prefix" :
+        filter == XS_FILTER_TOPIC ? "topic" : "exact");
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", (int) message_count);
+
+    memset (buf, 0, sizeof (buf));
+    cpu_start = perf_thread_cpu_ns ();
+    start = perf_now_ns ();
+
+    for (i = 0; i != message_count; i++) {
+        j = sequence [i % SEQUENCE_SIZE];
+        memcpy (buf, topics [j], TOPIC_SIZE);
+        stamp = perf_now_ns ();
+        memcpy (buf + TOPIC_SIZE, &stamp, sizeof (stamp));
+        rc = xs_send (pub, buf, message_size, 0);
+        if (rc < 0) {
+            printf ("error in xs_send: %s\n", xs_strerror (errno));
+            return -1;
+        }
+        sent [j]++;
+    }
+
+    end = perf_now_ns ();
+    cpu_end = perf_thread_cpu_ns ();
+
+    //  Tell subscribers the test is over. Messages are dropped when
+    //  subscribers can't keep up, so the end-of-test messages are resent
+    //  till all the subscribers report back.
+    item.socket = done;
+    item.events = XS_POLLIN;
+    finished_count = 0;
+    while (finished_count != subscriber_count) {
+        for (i = 0; i != subscriber_count; i++) {
+            if (finished [i])
+                continue;
+            sprintf (buf, END_FORMAT, i);
+            rc = xs_send (pub, buf, TOPIC_SIZE, 0);
+            if (rc < 0) {
+                printf ("error in xs_send: %s\n", xs_strerror (errno));
+                return -1;
+            }
+        }
+        rc = xs_poll (&item, 1, 100);
+        if (rc < 0) {
+            printf ("error in xs_poll: %s\n", xs_strerror (errno));
+            return -1;
+        }
+        while (true) {
+            sub_stats_t result;
+            rc = xs_recv (done, &result, sizeof (result), XS_DONTWAIT);
+            if (rc < 0 && errno == EAGAIN)
+                break;
+            if (rc != sizeof (result)) {
+                printf ("error in xs_recv: %s\n", xs_strerror (errno));
+                return -1;
+            }
+            stats [result.id] = result;
+            finished [result.id] = true;
+            finished_count++;
+        }
+    }
+
+    for (i = 0; i != subscriber_count; i++) {
+#if defined XS_HAVE_WINDOWS
+        DWORD rc2 = WaitForSingleObject (threads [i], INFINITE);
+        if (rc2 == WAIT_FAILED) {
+            printf ("error in WaitForSingleObject\n");
+            return -1;
+        }
+        BOOL rc3 = CloseHandle (threads [i]);
+        if (rc3 == 0) {
+            printf ("error in CloseHandle\n");
+            return -1;
+        }
+#else
+        rc = pthread_join (threads [i], NULL);
+        if (rc != 0) {
+            printf ("error in pthread_join: %s\n", xs_strerror (rc));
+            return -1;
+        }
+#endif
+    }
+
+    //  Per-subscriber results. Expected number of messages is the number
+    //  of messages published with any of the subscriber's topics.
+    printf ("%10s %12s %12s %14s %14s %14s\n", "subscriber", "received",
+        "expected", "lag p50 [us]", "lag p99 [us]", "lag max [us]");
+    total_received = 0;
+    total_expected = 0;
+    last = start;
+    for (i = 0; i != subscriber_count; i++) {
+        expected = 0;
+        for (j = 0; j != subscription_count; j++)
+            expected += sent [(i * subscription_count + j) % topic_count];
+        printf ("%10d %12lu %12lu %14.3f %14.3f %14.3f\n", i,
+            (unsigned long) stats [i].received, (unsigned long) expected,
+            stats [i].lag_p50 / 1000.0, stats [i].lag_p99 / 1000.0,
+            stats [i].lag_max / 1000.0);
+        total_received += stats [i].received;
+        total_expected += expected;
+        if (stats [i].received && stats [i].last > last)
+            last = stats [i].last;
+    }
+
+    if (end == start)
+        end = start + 1;
+    if (last == start)
+        last = start + 1;
+    printf ("publisher throughput: %d [msg/s]\n",
+        (int) ((double) message_count * 1000000000 / (end - start)));
+    if (cpu_end > cpu_start)
+        printf ("publisher cpu: %.1f [ns/msg]\n",
+            (double) (cpu_end - cpu_start) / message_count);
+    else
+        printf ("publisher cpu: n/a\n");
+    printf ("delivered: %lu of %lu\n", (unsigned long) total_received,
+        (unsigned long) total_expected);
+    printf ("aggregate throughput: %d [msg/s]\n",
+        (int) ((double) total_received * 1000000000 / (last - start)));
+
+    rc = xs_close (done);
+    if (rc != 0) {
+        printf ("error in xs_close: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    rc = xs_close (pub);
+    if (rc != 0) {
+        printf ("error in xs_close: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    rc = xs_term (ctx);
+    if (rc != 0) {
+        printf ("error in xs_term: %s\n", xs_strerror (errno));
+        return -1;
+    }
+
+    free (threads);
+    free (finished);
+    free (stats);
+    free (sent);
+    free (topics);
+    free (sequence);
+
+    return 0;
+}
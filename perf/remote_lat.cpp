@@ -24,6 +24,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "histogram.hpp"
+
+static histogram_t histogram;
+
 int main (int argc, char *argv [])
 {
     const char *connect_to;
@@ -31,21 +35,26 @@ int main (int argc, char *argv [])
     size_t message_size;
     void *ctx;
     void *s;
+    int pattern_version;
     int rc;
     int i;
     xs_msg_t msg;
     void *watch;
     unsigned long elapsed;
     double latency;
+    const char *histogram_file;
+    uint64_t start;
 
-    if (argc != 4) {
+    if (argc < 4 || argc > 6) {
         printf ("usage: remote_lat <connect-to> <message-size> "
-            "<roundtrip-count>\n");
+            "<roundtrip-count> [pattern-version] [histogram-file]\n");
         return 1;
     }
     connect_to = argv [1];
     message_size = atoi (argv [2]);
     roundtrip_count = atoi (argv [3]);
+    pattern_version = argc >= 5 ? atoi (argv [4]) : 0;
+    histogram_file = argc == 6 ? argv [5] : NULL;
 
     ctx = xs_init ();
     if (!ctx) {
@@ -59,6 +68,17 @@ int main (int argc, char *argv [])
         return -1;
     }
 
+    //  Use the non-default version of the request/reply pattern, e.g. 4 for
+    //  the envelope packed into the body. Both ends must use the same one.
+    if (pattern_version) {
+        rc = xs_setsockopt (s, XS_PATTERN_VERSION, &pattern_version,
+            sizeof (pattern_version));
+        if (rc == -1) {
+            printf ("error in xs_setsockopt: %s\n", xs_strerror (errno));
+            return -1;
+        }
+    }
+
     rc = xs_connect (s, connect_to);
     if (rc == -1) {
         printf ("error in xs_connect: %s\n", xs_strerror (errno));
@@ -72,9 +92,12 @@ int main (int argc, char *argv [])
     }
     memset (xs_msg_data (&msg), 0, message_size);
 
+    histogram_init (&histogram);
+
     watch = xs_stopwatch_start ();
 
     for (i = 0; i != roundtrip_count; i++) {
+        start = perf_now_ns ();
         rc = xs_sendmsg (s, &msg, 0);
         if (rc < 0) {
             printf ("error in xs_sendmsg: %s\n", xs_strerror (errno));
@@ -89,6 +112,7 @@ int main (int argc, char *argv [])
             printf ("message of incorrect size received\n");
             return -1;
         }
+        histogram_record (&histogram, perf_now_ns () - start);
     }
 
     elapsed = xs_stopwatch_stop (watch);
@@ -105,6 +129,17 @@ int main (int argc, char *argv [])
     printf ("roundtrip count: %d\n", (int) roundtrip_count);
     printf ("average latency: %.3f [us]\n", (double) latency);
 
+    //  Unlike the average above, the distribution is of whole roundtrips.
+    histogram_write (&histogram, stdout, 1);
+    histogram_print (&histogram, "roundtrip latency");
+    if (histogram_file) {
+        rc = histogram_save (&histogram, histogram_file);
+        if (rc != 0) {
+            printf ("error writing %s\n", histogram_file);
+            return -1;
+        }
+    }
+
     rc = xs_close (s);
     if (rc != 0) {
         printf ("error in xs_close: %s\n", xs_strerror (errno));
@@ -22,6 +22,7 @@
 #include "platform.hpp"
 #include "likely.hpp"
 #include "config.hpp"
+#include "mutex.hpp"
 #include "err.hpp"
 
 #include <stddef.h>
@@ -38,6 +39,192 @@
 #include <time.h>
 #endif
 
+//  TSC-based clock is available on x86 only.
+#if (defined _MSC_VER && (defined _M_IX86 || defined _M_X64)) || \
+    (defined __GNUC__ && (defined __i386__ || defined __x86_64__))
+#define XS_HAVE_TSC_CLOCK
+#if defined _MSC_VER
+#define XS_COMPILER_BARRIER() _ReadWriteBarrier ()
+#else
+#include <cpuid.h>
+#define XS_COMPILER_BARRIER() __asm__ volatile ("" : : : "memory")
+#endif
+#endif
+
+#if defined XS_HAVE_TSC_CLOCK
+
+//  State of the TSC-based clock. The time is 'tsc_base_ns' plus the number
+//  of ticks since 'tsc_base_tsc' multiplied by 'tsc_mult', which is length
+//  of a tick in nanoseconds as a 32.32 fixed point number. The state is
+//  modified only while holding 'tsc_sync'. Readers don't lock, instead they
+//  retry if 'tsc_seq' is odd (modification is in progress) or if it have
+//  changed while they were reading the state.
+static volatile bool tsc_enabled = false;
+static volatile uint32_t tsc_seq = 0;
+static uint64_t tsc_base_tsc;
+static uint64_t tsc_base_ns;
+static uint64_t tsc_mult;
+static uint64_t tsc_resync_ticks;
+
+//  The point of calibration. Used to compute precise length of a tick
+//  over the whole lifetime of the process.
+static uint64_t tsc_origin_tsc;
+static uint64_t tsc_origin_ns;
+
+static bool tsc_calibrated = false;
+static xs::mutex_t tsc_sync;
+
+//  Returns true if the CPU guarantees TSC to run at constant rate
+//  irrespective of power management.
+static bool tsc_invariant ()
+{
+    unsigned int regs [4];
+#if defined _MSC_VER
+    __cpuid ((int*) regs, 0x80000000);
+    if (regs [0] < 0x80000007)
+        return false;
+    __cpuid ((int*) regs, 0x80000007);
+#else
+    if (!__get_cpuid (0x80000000, &regs [0], &regs [1], &regs [2], &regs [3])
+          || regs [0] < 0x80000007)
+        return false;
+    __get_cpuid (0x80000007, &regs [0], &regs [1], &regs [2], &regs [3]);
+#endif
+    return (regs [3] & (1 << 8)) != 0;
+}
+
+//  Gets TSC and system time at the same moment. The most precise of several
+//  attempts is used. Fails if the thread was interrupted all the time.
+static bool tsc_sample (uint64_t *tsc_, uint64_t *ns_)
+{
+    uint64_t best = xs::clock_precision / 10;
+    bool sampled = false;
+    for (int i = 0; i != 5; i++) {
+        uint64_t before = xs::clock_t::rdtsc ();
+        uint64_t ns = xs::clock_t::system_ns ();
+        uint64_t after = xs::clock_t::rdtsc ();
+        if (after < before || after - before >= best)
+            continue;
+        best = after - before;
+        *tsc_ = before + best / 2;
+        *ns_ = ns;
+        sampled = true;
+    }
+    return sampled;
+}
+
+static uint64_t tsc_convert (uint64_t tsc_, uint64_t base_tsc_,
+    uint64_t base_ns_, uint64_t mult_)
+{
+    //  TSCs of different cores may be slightly off.
+    if (tsc_ <= base_tsc_)
+        return base_ns_;
+
+    //  Multiply in two steps to avoid overflow.
+    uint64_t ticks = tsc_ - base_tsc_;
+    return base_ns_ + (ticks >> 32) * mult_ +
+        (((ticks & 0xffffffff) * mult_) >> 32);
+}
+
+//  Modifies the state of the clock. Must be called with 'tsc_sync' locked.
+static void tsc_set (uint64_t base_tsc_, uint64_t base_ns_, uint64_t mult_)
+{
+    tsc_seq = tsc_seq + 1;
+    XS_COMPILER_BARRIER ();
+    tsc_base_tsc = base_tsc_;
+    tsc_base_ns = base_ns_;
+    tsc_mult = mult_;
+    XS_COMPILER_BARRIER ();
+    tsc_seq = tsc_seq + 1;
+}
+
+//  Re-aligns the clock with the system clock. Returns false if the TSC
+//  is found to be unreliable and the clock was switched off.
+static bool tsc_resync (uint64_t *ns_)
+{
+    tsc_sync.lock ();
+
+    if (!tsc_enabled) {
+        tsc_sync.unlock ();
+        return false;
+    }
+
+    uint64_t tsc;
+    uint64_t sys;
+    bool sampled = tsc_sample (&tsc, &sys);
+    if (!sampled)
+        tsc = xs::clock_t::rdtsc ();
+    uint64_t ns = tsc_convert (tsc, tsc_base_tsc, tsc_base_ns, tsc_mult);
+
+    //  Another thread may have resynchronised the clock in the meantime.
+    //  If the sample is imprecise, try next time.
+    if (!sampled || tsc < tsc_base_tsc ||
+          tsc - tsc_base_tsc < tsc_resync_ticks) {
+        tsc_sync.unlock ();
+        *ns_ = ns;
+        return true;
+    }
+
+    //  If the clock have drifted too far from the system clock, TSC is not
+    //  reliable (it may not be synchronised between the cores, the machine
+    //  may have been migrated etc.) Fall back to the system clock.
+    uint64_t elapsed = ns - tsc_base_ns;
+    uint64_t drift = sys > ns ? sys - ns : ns - sys;
+    if (drift > 10000 + elapsed / 1000000 * xs::tsc_max_drift) {
+        tsc_enabled = false;
+        tsc_sync.unlock ();
+        return false;
+    }
+
+    //  Measure the length of the tick over the whole lifetime of the
+    //  process to get the best precision possible.
+    double mult = (double) (sys - tsc_origin_ns) /
+        (tsc - tsc_origin_tsc) * 4294967296.0;
+
+    //  The time already returned to the callers can be anywhere up to the
+    //  end of the last interval. Never go back in time. If the clock was
+    //  ahead of the system clock, slow it down so that it gets in sync by
+    //  the end of the next interval.
+    uint64_t last = tsc_convert (tsc_base_tsc + tsc_resync_ticks,
+        tsc_base_tsc, tsc_base_ns, tsc_mult);
+    if (sys < last) {
+        ns = last;
+        mult -= (double) (last - sys) * 4294967296.0 / tsc_resync_ticks;
+    }
+    else
+        ns = sys;
+
+    tsc_set (tsc, ns, (uint64_t) mult);
+    tsc_sync.unlock ();
+    *ns_ = ns;
+    return true;
+}
+
+//  Converts current TSC to time. Returns false if the TSC-based clock was
+//  switched off.
+static bool tsc_now (uint64_t *ns_)
+{
+    while (true) {
+        uint32_t seq = tsc_seq;
+        XS_COMPILER_BARRIER ();
+        if (unlikely (seq & 1))
+            continue;
+        uint64_t base_tsc = tsc_base_tsc;
+        uint64_t base_ns = tsc_base_ns;
+        uint64_t mult = tsc_mult;
+        uint64_t tsc = xs::clock_t::rdtsc ();
+        XS_COMPILER_BARRIER ();
+        if (unlikely (tsc_seq != seq))
+            continue;
+        if (unlikely (tsc > base_tsc && tsc - base_tsc >= tsc_resync_ticks))
+            return tsc_resync (ns_);
+        *ns_ = tsc_convert (tsc, base_tsc, base_ns, mult);
+        return true;
+    }
+}
+
+#endif
+
 xs::clock_t::clock_t () :
     last_tsc (rdtsc ()),
     last_time (now_us () / 1000)
@@ -50,6 +237,26 @@ xs::clock_t::~clock_t ()
 
 uint64_t xs::clock_t::now_us ()
 {
+#if defined XS_HAVE_TSC_CLOCK
+    uint64_t ns;
+    if (tsc_enabled && likely (tsc_now (&ns)))
+        return ns / 1000;
+#endif
+    return system_us ();
+}
+
+uint64_t xs::clock_t::now_ns ()
+{
+#if defined XS_HAVE_TSC_CLOCK
+    uint64_t ns;
+    if (tsc_enabled && likely (tsc_now (&ns)))
+        return ns;
+#endif
+    return system_ns ();
+}
+
+uint64_t xs::clock_t::system_us ()
+{
 #if defined XS_HAVE_WINDOWS
 
     //  Get the high resolution counter's accuracy.
@@ -88,6 +295,95 @@ uint64_t xs::clock_t::now_us ()
 #endif
 }
 
+uint64_t xs::clock_t::system_ns ()
+{
+#if defined HAVE_CLOCK_GETTIME && defined CLOCK_MONOTONIC && \
+    !defined XS_HAVE_WINDOWS
+
+    struct timespec tv;
+    int rc = clock_gettime (CLOCK_MONOTONIC, &tv);
+    errno_assert (rc == 0);
+    return (tv.tv_sec * (uint64_t) 1000000000 + tv.tv_nsec);
+
+#elif defined HAVE_GETHRTIME && !defined XS_HAVE_WINDOWS
+
+    return gethrtime ();
+
+#else
+
+    return system_us () * 1000;
+
+#endif
+}
+
+bool xs::clock_t::use_tsc ()
+{
+#if defined XS_HAVE_TSC_CLOCK
+    tsc_sync.lock ();
+
+    //  Calibration is done only once. If it fails or if the TSC turns out
+    //  to be unreliable later on, the system clock is used from then on.
+    if (tsc_calibrated) {
+        bool enabled = tsc_enabled;
+        tsc_sync.unlock ();
+        return enabled;
+    }
+    tsc_calibrated = true;
+
+    if (!rdtsc () || !tsc_invariant ()) {
+        tsc_sync.unlock ();
+        return false;
+    }
+
+    //  Measure the TSC frequency. Give up if we are interrupted all the time.
+    uint64_t tsc0;
+    uint64_t ns0;
+    uint64_t tsc1;
+    uint64_t ns1;
+    uint64_t calibration = tsc_calibration_time * (uint64_t) 1000000;
+    bool sampled = tsc_sample (&tsc0, &ns0);
+    while (sampled) {
+        if (tsc_sample (&tsc1, &ns1) && ns1 - ns0 >= calibration)
+            break;
+        if (system_ns () - ns0 >= 10 * calibration)
+            sampled = false;
+    }
+    if (!sampled || tsc1 <= tsc0) {
+        tsc_sync.unlock ();
+        return false;
+    }
+
+    //  The conversion assumes that the tick is shorter than a nanosecond,
+    //  i.e. that the TSC frequency is above 1GHz.
+    double mult = (double) (ns1 - ns0) / (tsc1 - tsc0) * 4294967296.0;
+    if (mult >= 4294967296.0) {
+        tsc_sync.unlock ();
+        return false;
+    }
+
+    tsc_origin_tsc = tsc0;
+    tsc_origin_ns = ns0;
+    tsc_resync_ticks = (uint64_t) (tsc_resync_interval * 1000000.0 *
+        4294967296.0 / mult);
+    tsc_set (tsc1, ns1, (uint64_t) mult);
+    XS_COMPILER_BARRIER ();
+    tsc_enabled = true;
+    tsc_sync.unlock ();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool xs::clock_t::tsc_in_use ()
+{
+#if defined XS_HAVE_TSC_CLOCK
+    return tsc_enabled;
+#else
+    return false;
+#endif
+}
+
 uint64_t xs::clock_t::now_ms ()
 {
     uint64_t tsc = rdtsc ();
@@ -39,6 +39,26 @@ namespace xs
         //  High precision timestamp.
         static uint64_t now_us ();
 
+        //  High precision timestamp in nanoseconds. On platforms without
+        //  nanosecond clock the resolution is the same as that of now_us.
+        static uint64_t now_ns ();
+
+        //  Same as above, however, the time is always obtained from the OS,
+        //  even if the TSC-based clock is in use.
+        static uint64_t system_us ();
+        static uint64_t system_ns ();
+
+        //  Switches the high precision timestamps of the whole process to
+        //  converting TSC to time directly rather than asking the OS. TSC
+        //  frequency is calibrated against the system clock the first time
+        //  the function is called. Returns false if TSC is not available or
+        //  its frequency is not guaranteed to be constant.
+        static bool use_tsc ();
+
+        //  Returns true if the TSC-based clock is in use. It may be switched
+        //  off at any time if the TSC turns out to be unreliable.
+        static bool tsc_in_use ();
+
         //  Low precision timestamp. In tight loops generating it can be
         //  10 to 100 times faster than the high precision timestamp.
         uint64_t now_ms ();
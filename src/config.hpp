@@ -34,6 +34,11 @@ namespace xs
         //  memory allocation by approximately 99.6%
         message_pipe_granularity = 256,
 
+        //  Maximal initial size of the preallocated ring of a message pipe
+        //  with finite HWM (in messages). Rings for higher HWMs grow on
+        //  demand instead of being allocated at full size upfront.
+        message_ring_max_size = 1024,
+
         //  Commands in pipe per allocation event.
         command_pipe_granularity = 16,
 
@@ -57,6 +62,17 @@ namespace xs
         //  unnecessary network stack traversals.
         out_batch_size = 8192,
 
+        //  Maximal size of the request/reply envelope that can be packed
+        //  into the first part of the message body, including the size
+        //  bytes of the labels. The envelope is stored in a buffer of this
+        //  size so that no allocation is needed when packing it.
+        envelope_max_size = 4096,
+
+        //  Maximal number of message parts the session with offloaded
+        //  filtering reads from the pipe in advance in order to match them
+        //  against the subscriptions in a single call.
+        offload_batch_size = 64,
+
         //  Maximal delta between high and low watermark.
         max_wm_delta = 1024,
 
@@ -76,6 +92,23 @@ namespace xs
         //  possible latencies.
         clock_precision = 1000000,
 
+        //  Time spent calibrating the TSC-based clock against the system
+        //  clock, in milliseconds.
+        tsc_calibration_time = 10,
+
+        //  Interval between resynchronisations of the TSC-based clock with
+        //  the system clock, in milliseconds.
+        tsc_resync_interval = 100,
+
+        //  Maximal drift of the TSC-based clock from the system clock in
+        //  parts per million. If the drift is larger, the TSC is deemed
+        //  unreliable and the system clock is used instead.
+        tsc_max_drift = 1000,
+
+        //  Maximal size of the per-thread trace buffer, in events. Each event
+        //  takes 32 bytes on 64-bit platforms.
+        max_trace_size = 1048576,
+
         //  Maximum transport data unit size for PGM (TPDU).
         pgm_max_tpdu = 1500,
 
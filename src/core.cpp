@@ -49,6 +49,18 @@ int xs::core_t::filter_matching (void *subscriber_)
     return -1;
 }
 
+int xs::core_t::filter_matching_batch (int index_, void **subscribers_,
+    int count_)
+{
+    //  By default, report the subscribers one by one.
+    for (int i = 0; i != count_; i++) {
+        int rc = filter_matching (subscribers_ [i]);
+        if (rc != 0)
+            return rc;
+    }
+    return 0;
+}
+
 int xs_filter_subscribed (void *core_,
     const unsigned char *data_, size_t size_)
 {
@@ -66,3 +78,9 @@ int xs_filter_matching (void *core_, void *subscriber_)
     return ((xs::core_t*) core_)->filter_matching (subscriber_);
 }
 
+int xs_filter_matching_batch (void *core_, int index_, void **subscribers_,
+    int count_)
+{
+    return ((xs::core_t*) core_)->filter_matching_batch (index_, subscribers_,
+        count_);
+}
@@ -41,6 +41,8 @@ namespace xs
         virtual int filter_unsubscribed (const unsigned char *data_,
             size_t size_);
         virtual int filter_matching (void *subscriber_);
+        virtual int filter_matching_batch (int index_, void **subscribers_,
+            int count_);
 
     private:
 
@@ -47,6 +47,7 @@
 #endif
 
 #include <new>
+#include <algorithm>
 #include <string.h>
 
 #include "ctx.hpp"
@@ -55,8 +56,10 @@
 #include "pipe.hpp"
 #include "err.hpp"
 #include "msg.hpp"
+#include "clock.hpp"
 #include "prefix_filter.hpp"
 #include "topic_filter.hpp"
+#include "exact_filter.hpp"
 
 xs::ctx_t::ctx_t () :
     tag (0xbadcafe0),
@@ -66,7 +69,8 @@ xs::ctx_t::ctx_t () :
     slot_count (0),
     slots (NULL),
     max_sockets (512),
-    io_thread_count (1)
+    io_thread_count (1),
+    io_stats (false)
 {
     int rc = mailbox_init (&term_mailbox);
     errno_assert (rc == 0);
@@ -76,6 +80,8 @@ xs::ctx_t::ctx_t () :
     errno_assert (rc == 0);
     rc = plug (topic_filter);
     errno_assert (rc == 0);
+    rc = plug (exact_filter);
+    errno_assert (rc == 0);
 
     //  Now plug in all the extensions found in plugin directory.
 
@@ -305,7 +311,9 @@ int xs::ctx_t::plug (const void *ext_)
 
     //  The extension is a message filter plug-in.
     xs_filter_t *filter = (xs_filter_t*) ext_;
-    if (filter->type == XS_PLUGIN_FILTER && filter->version == 1) {
+    //  Versions 1 and 2 of the filter interface are supported.
+    if (filter->type == XS_PLUGIN_FILTER &&
+          (filter->version == 1 || filter->version == 2)) {
        opt_sync.lock ();
        filters [filter->id (NULL)] = filter;
        opt_sync.unlock ();
@@ -341,6 +349,50 @@ int xs::ctx_t::setctxopt (int option_, const void *optval_, size_t optvallen_)
         break;
     case XS_PLUGIN:
         return plug (optval_);
+    case XS_IO_STATS:
+        if (optvallen_ != sizeof (int) || *((int*) optval_) < 0 ||
+              *((int*) optval_) > 1) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        //  The I/O threads are instrumented when they are launched, i.e. when
+        //  the first socket is created. Later changes would have no effect.
+        slot_sync.lock ();
+        if (!starting) {
+            slot_sync.unlock ();
+            errno = EINVAL;
+            return -1;
+        }
+        opt_sync.lock ();
+        io_stats = *((int*) optval_) ? true : false;
+        opt_sync.unlock ();
+        slot_sync.unlock ();
+        break;
+    case XS_CLOCK:
+        if (optvallen_ != sizeof (int) || (*((int*) optval_) !=
+              XS_CLOCK_SYSTEM && *((int*) optval_) != XS_CLOCK_TSC)) {
+            errno = EINVAL;
+            return -1;
+        }
+        //  The clock is shared by the whole process, so switching it on takes
+        //  effect immediately. Calibration busy-waits for several
+        //  milliseconds, thus it's done here in the caller's thread rather
+        //  than while the socket creation lock is held.
+        if (*((int*) optval_) == XS_CLOCK_TSC) {
+            if (!clock_t::use_tsc ()) {
+                errno = ENOTSUP;
+                return -1;
+            }
+            break;
+        }
+
+        //  Once the TSC-based clock is in use, there's no way back.
+        if (clock_t::tsc_in_use ()) {
+            errno = ENOTSUP;
+            return -1;
+        }
+        break;
     default:
         errno = EINVAL;
         return -1;
@@ -348,6 +400,58 @@ int xs::ctx_t::setctxopt (int option_, const void *optval_, size_t optvallen_)
     return 0;
 }
 
+int xs::ctx_t::getctxopt (int option_, void *optval_, size_t *optvallen_)
+{
+    switch (option_) {
+    case XS_MAX_SOCKETS:
+    case XS_IO_THREADS:
+    case XS_IO_STATS:
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        opt_sync.lock ();
+        if (option_ == XS_MAX_SOCKETS)
+            *((int*) optval_) = max_sockets;
+        else if (option_ == XS_IO_THREADS)
+            *((int*) optval_) = io_thread_count;
+        else
+            *((int*) optval_) = io_stats ? 1 : 0;
+        opt_sync.unlock ();
+        *optvallen_ = sizeof (int);
+        return 0;
+    case XS_CLOCK:
+
+        //  Report the clock actually in use. TSC-based clock is shared by
+        //  the whole process and it may have been switched off.
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) =
+            clock_t::tsc_in_use () ? XS_CLOCK_TSC : XS_CLOCK_SYSTEM;
+        *optvallen_ = sizeof (int);
+        return 0;
+    case XS_IO_THREAD_STATS:
+        {
+            //  Fill in as many I/O threads as fit into the supplied buffer.
+            //  Before the first socket is created there are no I/O threads.
+            slot_sync.lock ();
+            size_t count = std::min ((size_t) io_threads.size (),
+                *optvallen_ / sizeof (xs_io_stats_t));
+            xs_io_stats_t *stats = (xs_io_stats_t*) optval_;
+            for (size_t i = 0; i != count; i++)
+                io_threads [i]->get_stats (&stats [i]);
+            slot_sync.unlock ();
+            *optvallen_ = count * sizeof (xs_io_stats_t);
+            return 0;
+        }
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
 xs::socket_base_t *xs::ctx_t::create_socket (int type_)
 {
     slot_sync.lock ();
@@ -360,6 +464,7 @@ xs::socket_base_t *xs::ctx_t::create_socket (int type_)
         opt_sync.lock ();
         int maxs = max_sockets;
         int ios = io_thread_count;
+        bool instrument = io_stats;
         opt_sync.unlock ();
         slot_count = maxs + ios + 2;
         slots = (mailbox_t**) malloc (sizeof (mailbox_t*) * slot_count);
@@ -379,6 +484,8 @@ xs::socket_base_t *xs::ctx_t::create_socket (int type_)
             io_thread_t *io_thread = io_thread_t::create (this, i);
             errno_assert (io_thread);
             io_threads.push_back (io_thread);
+            if (instrument)
+                io_thread->instrument ();
             slots [i] = io_thread->get_mailbox ();
             io_thread->start ();
         }
@@ -74,6 +74,9 @@ namespace xs
         //  Set context option.
         int setctxopt (int option_, const void *optval_, size_t optvallen_);
 
+        //  Get context option.
+        int getctxopt (int option_, void *optval_, size_t *optvallen_);
+
         //  Create and destroy a socket.
         xs::socket_base_t *create_socket (int type_);
         void destroy_socket (xs::socket_base_t *socket_);
@@ -166,6 +169,9 @@ namespace xs
         //  Number of I/O threads to launch.
         int io_thread_count;
 
+        //  If true, I/O threads collect statistics about their event loops.
+        bool io_stats;
+
         //  Synchronisation of access to context options.
         mutex_t opt_sync;
 
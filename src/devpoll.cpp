@@ -174,6 +174,7 @@ void xs::devpoll_t::loop ()
         if (n == -1 && errno == EINTR)
             continue;
         errno_assert (n != -1);
+        woken_up (n);
 
         for (int i = 0; i < n; i ++) {
 
@@ -181,15 +182,15 @@ void xs::devpoll_t::loop ()
             if (!fd_ptr->valid || !fd_ptr->accepted)
                 continue;
             if (ev_buf [i].revents & (POLLERR | POLLHUP))
-                fd_ptr->reactor->in_event (ev_buf [i].fd);
+                dispatch_in_event (fd_ptr->reactor, ev_buf [i].fd);
             if (!fd_ptr->valid || !fd_ptr->accepted)
                 continue;
             if (ev_buf [i].revents & POLLOUT)
-                fd_ptr->reactor->out_event (ev_buf [i].fd);
+                dispatch_out_event (fd_ptr->reactor, ev_buf [i].fd);
             if (!fd_ptr->valid || !fd_ptr->accepted)
                 continue;
             if (ev_buf [i].revents & POLLIN)
-                fd_ptr->reactor->in_event (ev_buf [i].fd);
+                dispatch_in_event (fd_ptr->reactor, ev_buf [i].fd);
         }
     }
 }
@@ -29,7 +29,8 @@ xs::dist_t::dist_t () :
     matching (0),
     active (0),
     eligible (0),
-    more (false)
+    more (false),
+    drops (0)
 {
 }
 
@@ -62,9 +63,12 @@ void xs::dist_t::match (pipe_t *pipe_)
     if (pipes.index (pipe_) < matching)
         return;
 
-    //  If the pipe isn't eligible, ignore it.
-    if (pipes.index (pipe_) >= eligible)
+    //  If the pipe isn't eligible, ignore it. Such pipe has reached the high
+    //  watermark, thus the message is dropped as far as it is concerned.
+    if (pipes.index (pipe_) >= eligible) {
+        drops++;
         return;
+    }
 
     //  Mark the pipe as matching.
     pipes.swap (pipes.index (pipe_), matching);
@@ -125,6 +129,10 @@ void xs::dist_t::activated (pipe_t *pipe_)
 
 int xs::dist_t::send_to_all (msg_t *msg_, int flags_)
 {
+    //  Pipes that have reached the high watermark miss the message.
+    if (!more)
+        drops += pipes.size () - eligible;
+
     matching = active;
     return send_to_matching (msg_, flags_);
 }
@@ -193,6 +201,18 @@ bool xs::dist_t::has_out ()
     return true;
 }
 
+int xs::dist_t::delivered ()
+{
+    //  Pipes that have refused the message were already moved past
+    //  the matching boundary by the write function.
+    return (int) matching;
+}
+
+uint64_t xs::dist_t::dropped ()
+{
+    return drops;
+}
+
 bool xs::dist_t::write (pipe_t *pipe_, msg_t *msg_)
 {
     if (!pipe_->write (msg_)) {
@@ -202,6 +222,7 @@ bool xs::dist_t::write (pipe_t *pipe_, msg_t *msg_)
         active--;
         pipes.swap (active, eligible - 1);
         eligible--;
+        drops++;
         return false;
     }
     if (!(msg_->flags () & msg_t::more))
@@ -25,6 +25,7 @@
 
 #include "array.hpp"
 #include "pipe.hpp"
+#include "stdint.hpp"
 
 namespace xs
 {
@@ -65,6 +66,13 @@ namespace xs
 
         bool has_out ();
 
+        //  Returns the number of pipes the last message was written to.
+        int delivered ();
+
+        //  Returns the number of messages dropped so far because
+        //  the pipes have reached the high watermark.
+        uint64_t dropped ();
+
     private:
 
         //  Write the message to the pipe. Make the pipe inactive if writing
@@ -96,6 +104,10 @@ namespace xs
         //  True if last we are in the middle of a multipart message.
         bool more;
 
+        //  Number of messages that haven't been written to a pipe because
+        //  it has reached the high watermark.
+        uint64_t drops;
+
         dist_t (const dist_t&);
         const dist_t &operator = (const dist_t&);
     };
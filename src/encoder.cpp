@@ -89,13 +89,15 @@ bool xs::encoder_t::message_ready ()
     //  message size. In both cases 'flags' field follows.
     if (size < 255) {
         tmpbuf [0] = (unsigned char) size;
-        tmpbuf [1] = (in_progress.flags () & ~msg_t::shared);
+        tmpbuf [1] = (in_progress.flags () &
+            ~(msg_t::shared | msg_t::stamped));
         next_step (tmpbuf, 2, &encoder_t::size_ready, false);
     }
     else {
         tmpbuf [0] = 0xff;
         put_uint64 (tmpbuf + 1, size);
-        tmpbuf [9] = (in_progress.flags () & ~msg_t::shared);
+        tmpbuf [9] = (in_progress.flags () &
+            ~(msg_t::shared | msg_t::stamped));
         next_step (tmpbuf, 10, &encoder_t::size_ready, false);
     }
     return true;
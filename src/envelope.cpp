@@ -0,0 +1,271 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <string.h>
+
+#include "envelope.hpp"
+#include "config.hpp"
+#include "likely.hpp"
+#include "err.hpp"
+#include "fq.hpp"
+
+//  Flags stored in the first byte of the packed message part.
+enum
+{
+    envelope_bottom = 1,
+    envelope_detached = 2
+};
+
+xs::envelope_packer_t::envelope_packer_t () :
+    begins (true),
+    labels (0),
+    envelope_size (0),
+    bottom (false)
+{
+}
+
+xs::envelope_packer_t::~envelope_packer_t ()
+{
+}
+
+int xs::envelope_packer_t::store (msg_t *msg_)
+{
+    //  Everything up to and including the bottom delimiter is the envelope.
+    //  A message part without 'more' flag is always a part of the body.
+    if (!begins || bottom || !(msg_->flags () & msg_t::more))
+        return 0;
+
+    //  Labels are limited in size and count by the wire format.
+    size_t size = msg_->size ();
+    if (size > 0xff || labels == 0xff ||
+          envelope_size + 1 + size > envelope_max_size) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (size == 0)
+        bottom = true;
+    else {
+        envelope [envelope_size] = (unsigned char) size;
+        memcpy (envelope + envelope_size + 1, msg_->data (), size);
+        envelope_size += 1 + size;
+        labels++;
+    }
+
+    int rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init ();
+    errno_assert (rc == 0);
+    return 1;
+}
+
+bool xs::envelope_packer_t::pending ()
+{
+    return begins;
+}
+
+bool xs::envelope_packer_t::pack (msg_t *msg_, msg_t *packed_)
+{
+    //  Copying the body is cheaper than passing it as a separate message
+    //  part only as long as the packed part remains a very small message.
+    //  Larger bodies are moved to the pipe as they are.
+    size_t size = 2 + envelope_size;
+    bool packs = size + msg_->size () <= msg_t::max_vsm_size;
+
+    int rc = packed_->init_size (size + (packs ? msg_->size () : 0));
+    errno_assert (rc == 0);
+    unsigned char *data = (unsigned char*) packed_->data ();
+    data [0] = (bottom ? envelope_bottom : 0) |
+        (packs ? 0 : envelope_detached);
+    data [1] = (unsigned char) labels;
+    memcpy (data + 2, envelope, envelope_size);
+
+    if (packs) {
+        memcpy (data + size, msg_->data (), msg_->size ());
+        packed_->set_flags (msg_->flags () & msg_t::more);
+    }
+    else
+        packed_->set_flags (msg_t::more);
+
+    return packs;
+}
+
+bool xs::envelope_packer_t::empty ()
+{
+    return begins && !labels && !bottom;
+}
+
+void xs::envelope_packer_t::sent (bool more_)
+{
+    labels = 0;
+    envelope_size = 0;
+    bottom = false;
+    begins = !more_;
+}
+
+void xs::envelope_packer_t::reset ()
+{
+    labels = 0;
+    envelope_size = 0;
+    bottom = false;
+    begins = true;
+}
+
+xs::envelope_unpacker_t::envelope_unpacker_t () :
+    pos (0),
+    labels (0),
+    bottom (false),
+    body (false),
+    pipe (NULL),
+    more (false)
+{
+    int rc = packed.init ();
+    errno_assert (rc == 0);
+}
+
+xs::envelope_unpacker_t::~envelope_unpacker_t ()
+{
+    int rc = packed.close ();
+    errno_assert (rc == 0);
+}
+
+int xs::envelope_unpacker_t::recvpipe (fq_t *fq_, msg_t *msg_, int flags_,
+    pipe_t **pipe_)
+{
+    //  Return the rest of the message that was already unpacked.
+    if (labels || bottom || body) {
+        next (msg_);
+        if (pipe_)
+            *pipe_ = pipe;
+        return 0;
+    }
+
+    while (true) {
+
+        int rc = fq_->recvpipe (msg_, flags_, &pipe);
+        if (rc != 0)
+            return rc;
+        if (pipe_)
+            *pipe_ = pipe;
+
+        //  Identities and the parts following the packed part are passed
+        //  to the caller as they are.
+        if (msg_->flags () & msg_t::identity)
+            return 0;
+        if (more) {
+            more = msg_->flags () & msg_t::more ? true : false;
+            return 0;
+        }
+
+        //  If there's no envelope and the body was not packed, the body
+        //  follows as the next message part.
+        if (likely (unpack (msg_))) {
+            if (labels || bottom || body) {
+                next (msg_);
+                return 0;
+            }
+            rc = packed.close ();
+            errno_assert (rc == 0);
+            rc = packed.init ();
+            errno_assert (rc == 0);
+            continue;
+        }
+
+        //  Drop the malformed message.
+        while (msg_->flags () & msg_t::more) {
+            rc = fq_->recvpipe (msg_, flags_, NULL);
+            errno_assert (rc == 0);
+        }
+        rc = msg_->close ();
+        errno_assert (rc == 0);
+        rc = msg_->init ();
+        errno_assert (rc == 0);
+    }
+}
+
+bool xs::envelope_unpacker_t::unpack (msg_t *msg_)
+{
+    unsigned char *data = (unsigned char*) msg_->data ();
+    size_t size = msg_->size ();
+
+    //  Check whether the packed part is well-formed.
+    if (size < 2 || data [0] & ~(envelope_bottom | envelope_detached))
+        return false;
+    size_t end = 2;
+    for (int i = 0; i != data [1]; i++) {
+        if (end >= size || data [end] == 0 || end + 1 + data [end] > size)
+            return false;
+        end += 1 + data [end];
+    }
+    if (data [0] & envelope_detached) {
+        if (end != size || !(msg_->flags () & msg_t::more))
+            return false;
+    }
+
+    pos = 2;
+    labels = data [1];
+    bottom = data [0] & envelope_bottom ? true : false;
+    body = data [0] & envelope_detached ? false : true;
+    more = msg_->flags () & msg_t::more ? true : false;
+    int rc = packed.move (*msg_);
+    errno_assert (rc == 0);
+    return true;
+}
+
+void xs::envelope_unpacker_t::next (msg_t *msg_)
+{
+    unsigned char *data = (unsigned char*) packed.data ();
+
+    int rc = msg_->close ();
+    errno_assert (rc == 0);
+
+    if (labels) {
+        rc = msg_->init_size (data [pos]);
+        errno_assert (rc == 0);
+        memcpy (msg_->data (), data + pos + 1, data [pos]);
+        msg_->set_flags (msg_t::more);
+        pos += 1 + data [pos];
+        labels--;
+    }
+    else if (bottom) {
+        rc = msg_->init ();
+        errno_assert (rc == 0);
+        msg_->set_flags (msg_t::more);
+        bottom = false;
+    }
+    else {
+        xs_assert (body);
+        rc = msg_->init_size (packed.size () - pos);
+        errno_assert (rc == 0);
+        memcpy (msg_->data (), data + pos, packed.size () - pos);
+        if (more)
+            msg_->set_flags (msg_t::more);
+        body = false;
+    }
+
+    //  Once everything is returned, release the packed part.
+    if (!labels && !bottom && !body) {
+        rc = packed.close ();
+        errno_assert (rc == 0);
+        rc = packed.init ();
+        errno_assert (rc == 0);
+    }
+}
@@ -0,0 +1,147 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __XS_ENVELOPE_HPP_INCLUDED__
+#define __XS_ENVELOPE_HPP_INCLUDED__
+
+#include <stddef.h>
+
+#include "config.hpp"
+#include "msg.hpp"
+
+namespace xs
+{
+
+    class fq_t;
+    class pipe_t;
+
+    //  Version 4 of the request/reply pattern doesn't pass the envelope
+    //  (the labels and the bottom delimiter preceding the body) as separate
+    //  message parts. Instead, it is packed into the first part of the body.
+    //  The packed part looks like this:
+    //
+    //      flags (1 byte) | label count (1 byte) |
+    //      (label size (1 byte) | label data)* | body
+    //
+    //  The first part of the body is copied to the packed part only if both
+    //  fit into a very small message. Otherwise it follows the packed part
+    //  as a separate message part.
+
+    class envelope_packer_t
+    {
+    public:
+
+        envelope_packer_t ();
+        ~envelope_packer_t ();
+
+        //  Stores the outbound message part in the envelope if it is a part
+        //  of it and empties it. Returns 1 if the part was stored, 0 if it
+        //  is a part of the body and -1 if it can't be stored.
+        int store (msg_t *msg_);
+
+        //  Returns true if the envelope has to be sent with the message part
+        //  refused by 'store'.
+        bool pending ();
+
+        //  Fills in 'packed_' with the envelope and, if possible, with the
+        //  content of 'msg_'. Returns true if 'msg_' was packed, false if
+        //  it has to be sent after the packed part.
+        bool pack (msg_t *msg_, msg_t *packed_);
+
+        //  Returns true if no part of the current message was stored or
+        //  sent so far.
+        bool empty ();
+
+        //  Must be called once a part of the body was sent.
+        void sent (bool more_);
+
+        //  Drops the envelope stored so far. Must be called if the message
+        //  can't be sent so that the envelope doesn't precede the next one.
+        void reset ();
+
+    private:
+
+        //  True if we are at the beginning of the message.
+        bool begins;
+
+        //  Number of labels stored so far.
+        int labels;
+
+        //  Labels stored so far, each preceded by its size, as they appear
+        //  in the packed part.
+        unsigned char envelope [envelope_max_size];
+        size_t envelope_size;
+
+        //  True if the bottom delimiter was already stored.
+        bool bottom;
+
+        envelope_packer_t (const envelope_packer_t&);
+        const envelope_packer_t &operator = (const envelope_packer_t&);
+    };
+
+    class envelope_unpacker_t
+    {
+    public:
+
+        envelope_unpacker_t ();
+        ~envelope_unpacker_t ();
+
+        //  Receives a message part from the fair-queuer, returning the
+        //  envelope and the body of the packed messages as separate parts.
+        //  Malformed messages are dropped.
+        int recvpipe (fq_t *fq_, msg_t *msg_, int flags_, pipe_t **pipe_);
+
+    private:
+
+        //  Parses the packed message part. Returns false if it's malformed.
+        bool unpack (msg_t *msg_);
+
+        //  Fills in 'msg_' with the next part of the unpacked message.
+        void next (msg_t *msg_);
+
+        //  Packed message part being unpacked.
+        msg_t packed;
+
+        //  Position of the next label in the packed part.
+        size_t pos;
+
+        //  Number of labels not yet returned.
+        int labels;
+
+        //  True if the bottom delimiter is yet to be returned.
+        bool bottom;
+
+        //  True if the body packed inline is yet to be returned.
+        bool body;
+
+        //  Pipe the packed part was read from.
+        pipe_t *pipe;
+
+        //  True if there are more parts of the current message in the pipe.
+        bool more;
+
+        envelope_unpacker_t (const envelope_unpacker_t&);
+        const envelope_unpacker_t &operator = (const envelope_unpacker_t&);
+    };
+
+}
+
+#endif
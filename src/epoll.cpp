@@ -144,6 +144,7 @@ void xs::epoll_t::loop ()
         if (n == -1 && errno == EINTR)
             continue;
         errno_assert (n != -1);
+        woken_up (n);
 
         for (int i = 0; i < n; i ++) {
             poll_entry_t *pe = ((poll_entry_t*) ev_buf [i].data.ptr);
@@ -151,15 +152,15 @@ void xs::epoll_t::loop ()
             if (pe->fd == retired_fd)
                 continue;
             if (ev_buf [i].events & (EPOLLERR | EPOLLHUP))
-                pe->events->in_event (pe->fd);
+                dispatch_in_event (pe->events, pe->fd);
             if (pe->fd == retired_fd)
                continue;
             if (ev_buf [i].events & EPOLLOUT)
-                pe->events->out_event (pe->fd);
+                dispatch_out_event (pe->events, pe->fd);
             if (pe->fd == retired_fd)
                 continue;
             if (ev_buf [i].events & EPOLLIN)
-                pe->events->in_event (pe->fd);
+                dispatch_in_event (pe->events, pe->fd);
         }
 
         //  Destroy retired event sources.
@@ -55,6 +55,8 @@ const char *xs::errno_to_string (int errno_)
         return "The protocol is not compatible with the socket type";
     case ETERM:
         return "Context was terminated";
+    case EQUORUM:
+        return "Survey quorum was reached";
     default:
 #if defined _MSC_VER
 #pragma warning (push)
@@ -0,0 +1,410 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <new>
+#include <map>
+#include <vector>
+#include <string.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "../include/xs/xs.h"
+
+#include "exact_filter.hpp"
+#include "stdint.hpp"
+#include "blob.hpp"
+#include "err.hpp"
+
+//  Subscriptions are stored in an open-addressing hash table with linear
+//  probing. The message matches a subscription if its leading bytes are
+//  exactly equal to it. The table is probed once for each distinct length of
+//  the subscriptions in place, ie. once per message if all the subscriptions
+//  are fixed-length keys.
+
+typedef std::map <void*, int> subscribers_t;
+
+struct exf_slot_t
+{
+    unsigned char *key;
+    size_t size;
+    uint32_t hash;
+
+    //  Pointer to particular subscriber associated with the reference count.
+    //  NULL means that the slot is empty.
+    subscribers_t *subscribers;
+};
+
+struct exf_t
+{
+    exf_slot_t *slots;
+
+    //  Number of slots. Always a power of two.
+    size_t capacity;
+
+    //  Number of slots in use.
+    size_t count;
+
+    //  Distinct lengths of the keys in the table, each associated with
+    //  the number of keys of that length.
+    typedef std::map <size_t, int> lengths_t;
+    lengths_t lengths;
+};
+
+//  Initial number of slots in the table.
+enum {exf_min_capacity = 16};
+
+//  Maximal number of subscribers reported to the core in a single call.
+enum {exf_batch_size = 64};
+
+static uint32_t exf_hash (const unsigned char *data_, size_t size_)
+{
+    //  FNV-1a.
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i != size_; i++) {
+        hash ^= data_ [i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void exf_init (exf_t *self_, size_t capacity_)
+{
+    self_->slots = (exf_slot_t*) calloc (capacity_, sizeof (exf_slot_t));
+    alloc_assert (self_->slots);
+    self_->capacity = capacity_;
+    self_->count = 0;
+}
+
+static void exf_close (exf_t *self_)
+{
+    for (size_t i = 0; i != self_->capacity; i++) {
+        if (self_->slots [i].subscribers) {
+            free (self_->slots [i].key);
+            delete self_->slots [i].subscribers;
+        }
+    }
+    free (self_->slots);
+    self_->slots = NULL;
+    self_->capacity = 0;
+    self_->count = 0;
+    self_->lengths.clear ();
+}
+
+//  Returns index of the slot holding the key or of the empty slot where
+//  the key should be placed.
+static size_t exf_find (exf_t *self_, const unsigned char *key_, size_t size_,
+    uint32_t hash_)
+{
+    size_t mask = self_->capacity - 1;
+    size_t i = hash_ & mask;
+    while (true) {
+        exf_slot_t &slot = self_->slots [i];
+        if (!slot.subscribers)
+            return i;
+        if (slot.hash == hash_ && slot.size == size_ &&
+              memcmp (slot.key, key_, size_) == 0)
+            return i;
+        i = (i + 1) & mask;
+    }
+}
+
+static void exf_grow (exf_t *self_)
+{
+    exf_slot_t *old_slots = self_->slots;
+    size_t old_capacity = self_->capacity;
+    exf_t::lengths_t lengths;
+    lengths.swap (self_->lengths);
+
+    exf_init (self_, old_capacity * 2);
+    for (size_t i = 0; i != old_capacity; i++) {
+        if (old_slots [i].subscribers) {
+            size_t pos = exf_find (self_, old_slots [i].key,
+                old_slots [i].size, old_slots [i].hash);
+            self_->slots [pos] = old_slots [i];
+            self_->count++;
+        }
+    }
+    free (old_slots);
+    lengths.swap (self_->lengths);
+}
+
+static void exf_erase (exf_t *self_, size_t pos_)
+{
+    exf_slot_t &slot = self_->slots [pos_];
+    exf_t::lengths_t::iterator it = self_->lengths.find (slot.size);
+    xs_assert (it != self_->lengths.end ());
+    if (!--it->second)
+        self_->lengths.erase (it);
+    free (slot.key);
+    delete slot.subscribers;
+    self_->count--;
+
+    //  Shift the subsequent entries of the cluster backwards so that no
+    //  tombstones are needed.
+    size_t mask = self_->capacity - 1;
+    size_t i = pos_;
+    size_t j = pos_;
+    while (true) {
+        j = (j + 1) & mask;
+        if (!self_->slots [j].subscribers)
+            break;
+        size_t k = self_->slots [j].hash & mask;
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+            self_->slots [i] = self_->slots [j];
+            i = j;
+        }
+    }
+    self_->slots [i].key = NULL;
+    self_->slots [i].size = 0;
+    self_->slots [i].hash = 0;
+    self_->slots [i].subscribers = NULL;
+}
+
+//  Returns true if the key was not subscribed to before.
+static bool exf_add (exf_t *self_, const unsigned char *key_, size_t size_,
+    void *subscriber_)
+{
+    uint32_t hash = exf_hash (key_, size_);
+    size_t pos = exf_find (self_, key_, size_, hash);
+    bool result = false;
+    if (!self_->slots [pos].subscribers) {
+
+        //  Keep the load factor below 3/4.
+        if ((self_->count + 1) * 4 > self_->capacity * 3) {
+            exf_grow (self_);
+            pos = exf_find (self_, key_, size_, hash);
+        }
+
+        exf_slot_t &slot = self_->slots [pos];
+        slot.key = (unsigned char*) malloc (size_ ? size_ : 1);
+        alloc_assert (slot.key);
+        memcpy (slot.key, key_, size_);
+        slot.size = size_;
+        slot.hash = hash;
+        slot.subscribers = new (std::nothrow) subscribers_t;
+        alloc_assert (slot.subscribers);
+        self_->count++;
+        self_->lengths [size_]++;
+        result = true;
+    }
+
+    subscribers_t::iterator it = self_->slots [pos].subscribers->insert (
+        subscribers_t::value_type (subscriber_, 0)).first;
+    ++it->second;
+    return result;
+}
+
+//  Returns true if there are no more subscribers for the key.
+static bool exf_rm (exf_t *self_, const unsigned char *key_, size_t size_,
+    void *subscriber_)
+{
+    size_t pos = exf_find (self_, key_, size_, exf_hash (key_, size_));
+    exf_slot_t &slot = self_->slots [pos];
+    if (!slot.subscribers)
+        return false;
+
+    subscribers_t::iterator it = slot.subscribers->find (subscriber_);
+    if (it == slot.subscribers->end ())
+        return false;
+    xs_assert (it->second);
+    if (--it->second)
+        return false;
+    slot.subscribers->erase (it);
+    if (!slot.subscribers->empty ())
+        return false;
+
+    exf_erase (self_, pos);
+    return true;
+}
+
+//  Returns the slot of the subscription matching the leading bytes of
+//  the message, starting with subscriptions of length 'from_'. Returns NULL
+//  if there's no such subscription. Length of the matching subscription is
+//  stored in 'from_'.
+static exf_slot_t *exf_match (exf_t *self_, const unsigned char *data_,
+    size_t size_, size_t *from_)
+{
+    for (exf_t::lengths_t::iterator it = self_->lengths.lower_bound (*from_);
+          it != self_->lengths.end () && it->first <= size_; ++it) {
+        size_t pos = exf_find (self_, data_, it->first,
+            exf_hash (data_, it->first));
+        if (self_->slots [pos].subscribers) {
+            *from_ = it->first;
+            return &self_->slots [pos];
+        }
+    }
+    return NULL;
+}
+
+//  Implementation of the public filter interface.
+
+static int id (void *core_)
+{
+    return XS_FILTER_EXACT;
+}
+
+static void *pf_create (void *core_)
+{
+    exf_t *pf = new (std::nothrow) exf_t;
+    alloc_assert (pf);
+    exf_init (pf, exf_min_capacity);
+    return (void*) pf;
+}
+
+static void pf_destroy (void *core_, void *pf_)
+{
+    xs_assert (pf_);
+    exf_close ((exf_t*) pf_);
+    delete (exf_t*) pf_;
+}
+
+static int pf_subscribe (void *core_, void *pf_, void *subscriber_,
+    const unsigned char *data_, size_t size_)
+{
+    return exf_add ((exf_t*) pf_, data_, size_, subscriber_) ? 1 : 0;
+}
+
+static int pf_unsubscribe (void *core_, void *pf_, void *subscriber_,
+    const unsigned char *data_, size_t size_)
+{
+    return exf_rm ((exf_t*) pf_, data_, size_, subscriber_) ? 1 : 0;
+}
+
+static void pf_unsubscribe_all (void *core_, void *pf_, void *subscriber_)
+{
+    exf_t *self = (exf_t*) pf_;
+
+    //  Remove the subscriber from all the keys. Keys that are left with no
+    //  subscribers are collected first, as erasing them reorders the table.
+    std::vector <xs::blob_t> unused;
+    for (size_t i = 0; i != self->capacity; i++) {
+        exf_slot_t &slot = self->slots [i];
+        if (!slot.subscribers)
+            continue;
+        subscribers_t::iterator it = slot.subscribers->find (subscriber_);
+        if (it == slot.subscribers->end ())
+            continue;
+        slot.subscribers->erase (it);
+        if (slot.subscribers->empty ())
+            unused.push_back (xs::blob_t (slot.key, slot.size));
+    }
+
+    for (size_t i = 0; i != unused.size (); i++) {
+        const unsigned char *key = unused [i].data ();
+        size_t size = unused [i].size ();
+        size_t pos = exf_find (self, key, size, exf_hash (key, size));
+        xs_assert (self->slots [pos].subscribers);
+        exf_erase (self, pos);
+        int rc = xs_filter_unsubscribed (core_, key, size);
+        errno_assert (rc == 0);
+    }
+}
+
+static void pf_match_batch (void *core_, void *pf_, int count_,
+    const unsigned char **data_, const size_t *size_)
+{
+    //  Matching subscribers are reported in dense chunks rather than
+    //  one by one.
+    void *buff [exf_batch_size];
+    for (int i = 0; i != count_; i++) {
+        size_t from = 0;
+        while (true) {
+            exf_slot_t *slot = exf_match ((exf_t*) pf_, data_ [i], size_ [i],
+                &from);
+            if (!slot)
+                break;
+            int n = 0;
+            for (subscribers_t::iterator it = slot->subscribers->begin ();
+                  it != slot->subscribers->end (); ++it) {
+                buff [n++] = it->first;
+                if (n == exf_batch_size) {
+                    int rc = xs_filter_matching_batch (core_, i, buff, n);
+                    errno_assert (rc == 0);
+                    n = 0;
+                }
+            }
+            if (n) {
+                int rc = xs_filter_matching_batch (core_, i, buff, n);
+                errno_assert (rc == 0);
+            }
+            from++;
+        }
+    }
+}
+
+static void pf_match (void *core_, void *pf_,
+    const unsigned char *data_, size_t size_)
+{
+    pf_match_batch (core_, pf_, 1, &data_, &size_);
+}
+
+static void *sf_create (void *core_)
+{
+    return pf_create (core_);
+}
+
+static void sf_destroy (void *core_, void *sf_)
+{
+    pf_destroy (core_, sf_);
+}
+
+static int sf_subscribe (void *core_, void *sf_,
+    const unsigned char *data_, size_t size_)
+{
+    if (exf_add ((exf_t*) sf_, data_, size_, NULL))
+        return xs_filter_subscribed (core_, data_, size_);
+    return 0;
+}
+
+static int sf_unsubscribe (void *core_, void *sf_,
+    const unsigned char *data_, size_t size_)
+{
+    if (exf_rm ((exf_t*) sf_, data_, size_, NULL))
+        return xs_filter_unsubscribed (core_, data_, size_);
+    return 0;
+}
+
+static int sf_match (void *core_, void *sf_,
+    const unsigned char *data_, size_t size_)
+{
+    size_t from = 0;
+    return exf_match ((exf_t*) sf_, data_, size_, &from) ? 1 : 0;
+}
+
+static xs_filter_t exf_filter = {
+    XS_PLUGIN_FILTER,
+    2,
+    id,
+    pf_create,
+    pf_destroy,
+    pf_subscribe,
+    pf_unsubscribe,
+    pf_unsubscribe_all,
+    pf_match,
+    sf_create,
+    sf_destroy,
+    sf_subscribe,
+    sf_unsubscribe,
+    sf_match,
+    pf_match_batch
+};
+
+void *xs::exact_filter = (void*) &exf_filter;
+
@@ -20,47 +20,75 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <new>
+
 #include "fq.hpp"
 #include "pipe.hpp"
 #include "err.hpp"
 #include "msg.hpp"
 
 xs::fq_t::fq_t () :
-    active (0),
-    current (0),
+    last (NULL),
     more (false)
 {
 }
 
 xs::fq_t::~fq_t ()
 {
-    xs_assert (pipes.empty ());
+    for (classes_t::iterator it = classes.begin (); it != classes.end ();
+          ++it) {
+        xs_assert ((*it)->pipes.empty ());
+        delete *it;
+    }
+}
+
+xs::fq_t::class_t *xs::fq_t::find (int priority_)
+{
+    //  There are very few distinct priorities in practice so linear search
+    //  is fast enough.
+    classes_t::iterator it = classes.begin ();
+    while (it != classes.end () && (*it)->priority > priority_)
+        ++it;
+    if (it != classes.end () && (*it)->priority == priority_)
+        return *it;
+
+    class_t *c = new (std::nothrow) class_t;
+    alloc_assert (c);
+    c->priority = priority_;
+    c->active = 0;
+    c->current = 0;
+    classes.insert (it, c);
+    return c;
 }
 
 void xs::fq_t::attach (pipe_t *pipe_)
 {
-    pipes.push_back (pipe_);
-    pipes.swap (active, pipes.size () - 1);
-    active++;
+    class_t *c = find (pipe_->get_priority ());
+    c->pipes.push_back (pipe_);
+    c->pipes.swap (c->active, c->pipes.size () - 1);
+    c->active++;
 }
 
 void xs::fq_t::terminated (pipe_t *pipe_)
 {
+    class_t *c = find (pipe_->get_priority ());
+
     //  Remove the pipe from the list; adjust number of active pipes
     //  accordingly.
-    if (pipes.index (pipe_) < active) {
-        active--;
-        if (current == active)
-            current = 0;
+    if (c->pipes.index (pipe_) < c->active) {
+        c->active--;
+        if (c->current == c->active)
+            c->current = 0;
     }
-    pipes.erase (pipe_);
+    c->pipes.erase (pipe_);
 }
 
 void xs::fq_t::activated (pipe_t *pipe_)
 {
     //  Move the pipe to the list of active pipes.
-    pipes.swap (pipes.index (pipe_), active);
-    active++;
+    class_t *c = find (pipe_->get_priority ());
+    c->pipes.swap (c->pipes.index (pipe_), c->active);
+    c->active++;
 }
 
 int xs::fq_t::recv (msg_t *msg_, int flags_)
@@ -74,38 +102,45 @@ int xs::fq_t::recvpipe (msg_t *msg_, int flags_, pipe_t **pipe_)
     int rc = msg_->close ();
     errno_assert (rc == 0);
 
-    //  Round-robin over the pipes to get the next message.
-    for (pipes_t::size_type count = active; count != 0; count--) {
-
-        //  Try to fetch new message. If we've already read part of the message
-        //  subsequent part should be immediately available.
-        bool fetched = pipes [current]->read (msg_);
-
-        //  Check the atomicity of the message. If we've already received the
-        //  first part of the message we should get the remaining parts
-        //  without blocking.
-        xs_assert (!(more && !fetched));
-
-        //  Note that when message is not fetched, current pipe is deactivated
-        //  and replaced by another active pipe. Thus we don't have to increase
-        //  the 'current' pointer.
-        if (fetched) {
-            if (pipe_)
-                *pipe_ = pipes [current];
-            more =
-                msg_->flags () & msg_t::more ? true : false;
-            if (!more) {
-                current++;
-                if (current >= active)
-                    current = 0;
+    //  Try the classes starting with the highest priority. If we are in the
+    //  middle of a multipart message, stick with the class it is read from.
+    for (classes_t::size_type i = 0; i != classes.size (); i++) {
+        class_t *c = more ? last : classes [i];
+
+        //  Round-robin over the pipes to get the next message.
+        for (pipes_t::size_type count = c->active; count != 0; count--) {
+
+            //  Try to fetch new message. If we've already read part of the
+            //  message subsequent part should be immediately available.
+            bool fetched = c->pipes [c->current]->read (msg_);
+
+            //  Check the atomicity of the message. If we've already received
+            //  the first part of the message we should get the remaining parts
+            //  without blocking.
+            xs_assert (!(more && !fetched));
+
+            //  Note that when message is not fetched, current pipe is
+            //  deactivated and replaced by another active pipe. Thus we don't
+            //  have to increase the 'current' pointer.
+            if (fetched) {
+                if (pipe_)
+                    *pipe_ = c->pipes [c->current];
+                last = c;
+                more =
+                    msg_->flags () & msg_t::more ? true : false;
+                if (!more) {
+                    c->current++;
+                    if (c->current >= c->active)
+                        c->current = 0;
+                }
+                return 0;
+            }
+            else {
+                c->active--;
+                c->pipes.swap (c->current, c->active);
+                if (c->current == c->active)
+                    c->current = 0;
             }
-            return 0;
-        }
-        else {
-            active--;
-            pipes.swap (current, active);
-            if (current == active)
-                current = 0;
         }
     }
 
@@ -127,15 +162,18 @@ bool xs::fq_t::has_in ()
     //  queueing algorithm. If there are no messages available current will
     //  get back to its original value. Otherwise it'll point to the first
     //  pipe holding messages, skipping only pipes with no messages available.
-    for (pipes_t::size_type count = active; count != 0; count--) {
-        if (pipes [current]->check_read ())
-            return true;
-
-        //  Deactivate the pipe.
-        active--;
-        pipes.swap (current, active);
-        if (current == active)
-            current = 0;
+    for (classes_t::size_type i = 0; i != classes.size (); i++) {
+        class_t *c = classes [i];
+        for (pipes_t::size_type count = c->active; count != 0; count--) {
+            if (c->pipes [c->current]->check_read ())
+                return true;
+
+            //  Deactivate the pipe.
+            c->active--;
+            c->pipes.swap (c->current, c->active);
+            if (c->current == c->active)
+                c->current = 0;
+        }
     }
 
     return false;
@@ -22,6 +22,8 @@
 #ifndef __XS_FQ_HPP_INCLUDED__
 #define __XS_FQ_HPP_INCLUDED__
 
+#include <vector>
+
 #include "array.hpp"
 #include "pipe.hpp"
 #include "msg.hpp"
@@ -31,7 +33,8 @@ namespace xs
 
     //  Class manages a set of inbound pipes. On receive it performs fair
     //  queueing so that senders gone berserk won't cause denial of
-    //  service for decent senders.
+    //  service for decent senders. Pipes with higher priority are always
+    //  served first; pipes with the same priority are served in turns.
 
     class fq_t
     {
@@ -52,14 +55,31 @@ namespace xs
 
         //  Inbound pipes.
         typedef array_t <pipe_t, 1> pipes_t;
-        pipes_t pipes;
 
-        //  Number of active pipes. All the active pipes are located at the
-        //  beginning of the pipes array.
-        pipes_t::size_type active;
+        //  Set of pipes with the same priority.
+        struct class_t
+        {
+            int priority;
+
+            pipes_t pipes;
+
+            //  Number of active pipes. All the active pipes are located at
+            //  the beginning of the pipes array.
+            pipes_t::size_type active;
+
+            //  Index of the next bound pipe to read a message from.
+            pipes_t::size_type current;
+        };
+
+        //  Returns the class of pipes with the specified priority.
+        class_t *find (int priority_);
+
+        //  Priority classes ordered from the highest priority to the lowest.
+        typedef std::vector <class_t*> classes_t;
+        classes_t classes;
 
-        //  Index of the next bound pipe to read a message from.
-        pipes_t::size_type current;
+        //  Class the last message part was read from.
+        class_t *last;
 
         //  If true, part of a multipart message was already received, but
         //  there are following parts still waiting in the current pipe.
@@ -18,7 +18,10 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
+
 #include "io_thread.hpp"
+#include "trace.hpp"
 #include "err.hpp"
 
 #include "polling.hpp"
@@ -47,8 +50,12 @@ xs::io_thread_t *xs::io_thread_t::create (xs::ctx_t *ctx_, uint32_t tid_)
 }
 
 xs::io_thread_t::io_thread_t (xs::ctx_t *ctx_, uint32_t tid_) :
-    object_t (ctx_, tid_)
+    object_t (ctx_, tid_),
+    instrumented (false)
 {
+    memset (&stats, 0, sizeof (stats));
+    memset (&published, 0, sizeof (published));
+
     int rc = mailbox_init (&mailbox);
     errno_assert (rc == 0);
 }
@@ -87,6 +94,55 @@ int xs::io_thread_t::get_load ()
     return load.get ();
 }
 
+void xs::io_thread_t::instrument ()
+{
+    instrumented = true;
+}
+
+void xs::io_thread_t::get_stats (xs_io_stats_t *stats_)
+{
+    stats_sync.lock ();
+    *stats_ = published;
+    stats_sync.unlock ();
+    stats_->load = get_load ();
+}
+
+void xs::io_thread_t::publish_stats ()
+{
+    stats_sync.lock ();
+    published = stats;
+    stats_sync.unlock ();
+}
+
+void xs::io_thread_t::timed_in_event (i_poll_events *sink_, fd_t fd_)
+{
+    uint64_t start = clock_t::now_ns ();
+    sink_->in_event (fd_);
+    uint64_t elapsed = clock_t::now_ns () - start;
+
+    //  Mailbox of the I/O thread is accounted for separately, the commands
+    //  are counted by in_event itself.
+    if (sink_ == this) {
+        stats.command_ns += elapsed;
+        return;
+    }
+    stats.in_events++;
+    stats.in_event_ns += elapsed;
+    if (elapsed > stats.max_handler_ns)
+        stats.max_handler_ns = elapsed;
+}
+
+void xs::io_thread_t::timed_out_event (i_poll_events *sink_, fd_t fd_)
+{
+    uint64_t start = clock_t::now_ns ();
+    sink_->out_event (fd_);
+    uint64_t elapsed = clock_t::now_ns () - start;
+    stats.out_events++;
+    stats.out_event_ns += elapsed;
+    if (elapsed > stats.max_handler_ns)
+        stats.max_handler_ns = elapsed;
+}
+
 void xs::io_thread_t::adjust_load (int amount_)
 {
     if (amount_ > 0)
@@ -114,13 +170,14 @@ void xs::io_thread_t::rm_timer (handle_t handle_)
 uint64_t xs::io_thread_t::execute_timers ()
 {
     //  Fast track.
-    if (timers.empty ())
+    if (timers.empty () && likely (!instrumented))
         return 0;
 
     //  Get the current time.
     uint64_t current = clock.now_ms ();
 
     //   Execute the timers that are already due.
+    uint64_t timeout = 0;
     timers_t::iterator it = timers.begin ();
     while (it != timers.end ()) {
 
@@ -128,11 +185,28 @@ uint64_t xs::io_thread_t::execute_timers ()
         //  all the following items (multimap is sorted). Thus we can stop
         //  checking the subsequent timers and return the time to wait for
         //  the next timer (at least 1ms).
-        if (it->first > current)
-            return it->first - current;
+        if (it->first > current) {
+            timeout = it->first - current;
+            break;
+        }
 
         //  Trigger the timer.
-        it->second.sink->timer_event ((handle_t) &it->second);
+        XS_TRACE (timer, it->second.sink, current - it->first);
+        if (likely (!instrumented))
+            it->second.sink->timer_event ((handle_t) &it->second);
+        else {
+            uint64_t lag = current - it->first;
+            stats.timer_lag_ms += lag;
+            if (lag > stats.max_timer_lag_ms)
+                stats.max_timer_lag_ms = lag;
+            uint64_t start = clock_t::now_ns ();
+            it->second.sink->timer_event ((handle_t) &it->second);
+            uint64_t elapsed = clock_t::now_ns () - start;
+            stats.timer_events++;
+            stats.timer_event_ns += elapsed;
+            if (elapsed > stats.max_handler_ns)
+                stats.max_handler_ns = elapsed;
+        }
 
         //  Remove it from the list of active timers.
         timers_t::iterator o = it;
@@ -140,8 +214,12 @@ uint64_t xs::io_thread_t::execute_timers ()
         timers.erase (o);
     }
 
-    //  There are no more timers.
-    return 0;
+    //  The thread is about to wait for new events. This is the right time
+    //  to make the statistics of the last batch available.
+    if (unlikely (instrumented))
+        publish_stats ();
+
+    return timeout;
 }
 
 void xs::io_thread_t::in_event (fd_t fd_)
@@ -162,6 +240,8 @@ void xs::io_thread_t::in_event (fd_t fd_)
 
         //  Process the command.
         cmd.destination->process_command (cmd);
+        if (unlikely (instrumented))
+            stats.commands++;
     }
 }
 
@@ -23,8 +23,12 @@
 
 #include <map>
 
+#include "../include/xs/xs.h"
+
 #include "fd.hpp"
 #include "clock.hpp"
+#include "mutex.hpp"
+#include "likely.hpp"
 #include "object.hpp"
 #include "mailbox.hpp"
 #include "atomic_counter.hpp"
@@ -67,6 +71,14 @@ namespace xs
         //  invoked from a different thread!
         int get_load ();
 
+        //  Enables collection of the statistics about the event loop. Must be
+        //  called before the thread is started.
+        void instrument ();
+
+        //  Returns snapshot of the statistics. Note that this function can be
+        //  invoked from a different thread!
+        void get_stats (xs_io_stats_t *stats_);
+
         void start ();
         void stop ();
 
@@ -105,8 +117,44 @@ namespace xs
         //  to wait to match the next timer or 0 meaning "no timers".
         uint64_t execute_timers ();
 
+        //  Called by individual io_thread implementations each time they
+        //  wake up with the number of file descriptors that have events.
+        inline void woken_up (int events_)
+        {
+            if (unlikely (instrumented)) {
+                stats.wakeups++;
+                stats.events += events_;
+                if ((uint64_t) events_ > stats.max_batch)
+                    stats.max_batch = events_;
+            }
+        }
+
+        //  Individual io_thread implementations dispatch the events to
+        //  the sinks using these functions.
+        inline void dispatch_in_event (i_poll_events *sink_, fd_t fd_)
+        {
+            if (likely (!instrumented))
+                sink_->in_event (fd_);
+            else
+                timed_in_event (sink_, fd_);
+        }
+        inline void dispatch_out_event (i_poll_events *sink_, fd_t fd_)
+        {
+            if (likely (!instrumented))
+                sink_->out_event (fd_);
+            else
+                timed_out_event (sink_, fd_);
+        }
+
     private:
 
+        //  Dispatch the event and account for the time spent in the handler.
+        void timed_in_event (i_poll_events *sink_, fd_t fd_);
+        void timed_out_event (i_poll_events *sink_, fd_t fd_);
+
+        //  Makes the statistics collected so far available to get_stats.
+        void publish_stats ();
+
         void process_stop ();
 
         //  Clock instance private to this I/O thread.
@@ -131,6 +179,15 @@ namespace xs
         //  Handle associated with mailbox' file descriptor.
         handle_t mailbox_handle;
 
+        //  If true, statistics about the event loop are collected.
+        bool instrumented;
+
+        //  Statistics updated by the I/O thread itself and the copy of them
+        //  made available to other threads.
+        xs_io_stats_t stats;
+        xs_io_stats_t published;
+        mutex_t stats_sync;
+
         io_thread_t (const io_thread_t&);
         const io_thread_t &operator = (const io_thread_t&);
     };
@@ -168,6 +168,7 @@ void xs::kqueue_t::loop ()
         if (n == -1 && errno == EINTR)
             continue;
         errno_assert (n != -1);
+        woken_up (n);
 
         for (int i = 0; i < n; i ++) {
             poll_entry_t *pe = (poll_entry_t*) ev_buf [i].udata;
@@ -175,15 +176,15 @@ void xs::kqueue_t::loop ()
             if (pe->fd == retired_fd)
                 continue;
             if (ev_buf [i].flags & EV_EOF)
-                pe->reactor->in_event (pe->fd);
+                dispatch_in_event (pe->reactor, pe->fd);
             if (pe->fd == retired_fd)
                 continue;
             if (ev_buf [i].filter == EVFILT_WRITE)
-                pe->reactor->out_event (pe->fd);
+                dispatch_out_event (pe->reactor, pe->fd);
             if (pe->fd == retired_fd)
                 continue;
             if (ev_buf [i].filter == EVFILT_READ)
-                pe->reactor->in_event (pe->fd);
+                dispatch_in_event (pe->reactor, pe->fd);
         }
 
         //  Destroy retired event sources.
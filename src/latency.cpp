@@ -0,0 +1,84 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <string.h>
+
+#include "latency.hpp"
+#include "err.hpp"
+
+xs::latency_t::latency_t ()
+{
+    reset ();
+}
+
+xs::latency_t::~latency_t ()
+{
+}
+
+void xs::latency_t::record (int hop_, uint64_t ns_)
+{
+    xs_assert (hop_ >= 0 && hop_ < XS_HOPS);
+
+    //  Find the bucket, i.e. the position of the highest bit set.
+    int bucket = 0;
+    for (uint64_t v = ns_ >> 1; v && bucket != XS_LATENCY_BUCKETS - 1;
+          v >>= 1)
+        bucket++;
+
+    xs_latency_stats_t &hop = hops [hop_];
+    hop.count++;
+    hop.sum_ns += ns_;
+    if (ns_ > hop.max_ns)
+        hop.max_ns = ns_;
+    hop.buckets [bucket]++;
+    samples++;
+}
+
+bool xs::latency_t::empty ()
+{
+    return samples == 0;
+}
+
+void xs::latency_t::add (const latency_t &other_)
+{
+    for (int i = 0; i != XS_HOPS; i++) {
+        xs_latency_stats_t &hop = hops [i];
+        const xs_latency_stats_t &other = other_.hops [i];
+        hop.count += other.count;
+        hop.sum_ns += other.sum_ns;
+        if (other.max_ns > hop.max_ns)
+            hop.max_ns = other.max_ns;
+        for (int j = 0; j != XS_LATENCY_BUCKETS; j++)
+            hop.buckets [j] += other.buckets [j];
+    }
+    samples += other_.samples;
+}
+
+void xs::latency_t::reset ()
+{
+    memset (hops, 0, sizeof hops);
+    samples = 0;
+}
+
+void xs::latency_t::get (xs_latency_stats_t *stats_)
+{
+    memcpy (stats_, hops, sizeof hops);
+}
@@ -0,0 +1,73 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __XS_LATENCY_HPP_INCLUDED__
+#define __XS_LATENCY_HPP_INCLUDED__
+
+#include "../include/xs/xs.h"
+
+#include "stdint.hpp"
+
+namespace xs
+{
+
+    //  Histograms of the time messages spend at individual hops of the
+    //  pipeline. The object is not synchronised. Each thread records the
+    //  samples into its own instance and the instances are merged using
+    //  add function under the owner's lock.
+
+    class latency_t
+    {
+    public:
+
+        latency_t ();
+        ~latency_t ();
+
+        //  Records a sample of 'ns_' nanoseconds spent at hop 'hop_'.
+        void record (int hop_, uint64_t ns_);
+
+        //  Returns true if there are no samples recorded.
+        bool empty ();
+
+        //  Adds the samples recorded by 'other_' to this object.
+        void add (const latency_t &other_);
+
+        //  Drops all the samples recorded so far.
+        void reset ();
+
+        //  Copies the histograms of all the hops into 'stats_' array,
+        //  which must have room for XS_HOPS items.
+        void get (xs_latency_stats_t *stats_);
+
+    private:
+
+        xs_latency_stats_t hops [XS_HOPS];
+
+        //  Number of samples recorded at all the hops.
+        uint64_t samples;
+
+        latency_t (const latency_t&);
+        const latency_t &operator = (const latency_t&);
+    };
+
+}
+
+#endif
@@ -20,16 +20,21 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "../include/xs/xs.h"
+
 #include "lb.hpp"
 #include "pipe.hpp"
 #include "err.hpp"
 #include "msg.hpp"
+#include "random.hpp"
 
 xs::lb_t::lb_t () :
     active (0),
     current (0),
     more (false),
-    dropping (false)
+    dropping (false),
+    strategy (XS_LB_ROUND_ROBIN),
+    drops (0)
 {
 }
 
@@ -51,8 +56,10 @@ void xs::lb_t::terminated (pipe_t *pipe_)
 
     //  If we are in the middle of multipart message and current pipe
     //  have disconnected, we have to drop the remainder of the message.
-    if (index == current && more)
+    if (index == current && more) {
         dropping = true;
+        drops++;
+    }
 
     //  Remove the pipe from the list; adjust number of active pipes
     //  accordingly.
@@ -88,6 +95,10 @@ int xs::lb_t::send (msg_t *msg_, int flags_)
         return 0;
     }
 
+    //  At the beginning of the message, choose the pipe to send it to.
+    if (!more && active > 1 && strategy != XS_LB_ROUND_ROBIN)
+        choose ();
+
     while (active > 0) {
         if (pipes [current]->write (msg_)) {
             more = msg_->flags () & msg_t::more ? true : false;
@@ -122,6 +133,52 @@ int xs::lb_t::send (msg_t *msg_, int flags_)
     return 0;
 }
 
+int xs::lb_t::set_strategy (int strategy_)
+{
+    if (strategy_ != XS_LB_ROUND_ROBIN && strategy_ != XS_LB_LEAST_QUEUED &&
+          strategy_ != XS_LB_TWO_CHOICES) {
+        errno = EINVAL;
+        return -1;
+    }
+    strategy = strategy_;
+    return 0;
+}
+
+uint64_t xs::lb_t::dropped ()
+{
+    return drops;
+}
+
+void xs::lb_t::choose ()
+{
+    if (strategy == XS_LB_LEAST_QUEUED) {
+
+        //  Start the scan at the round-robin position so that the load
+        //  is spread evenly among the pipes with the same backlog.
+        pipes_t::size_type best = current;
+        uint64_t best_outstanding = pipes [current]->get_outstanding ();
+        for (pipes_t::size_type i = 1; i != active; i++) {
+            pipes_t::size_type index = (current + i) % active;
+            uint64_t outstanding = pipes [index]->get_outstanding ();
+            if (outstanding < best_outstanding) {
+                best = index;
+                best_outstanding = outstanding;
+            }
+        }
+        current = best;
+        return;
+    }
+
+    //  Pick two pipes at random and use the less loaded one.
+    xs_assert (strategy == XS_LB_TWO_CHOICES);
+    pipes_t::size_type first = generate_random () % active;
+    pipes_t::size_type second = generate_random () % (active - 1);
+    if (second >= first)
+        second++;
+    current = pipes [second]->get_outstanding () <
+        pipes [first]->get_outstanding () ? second : first;
+}
+
 bool xs::lb_t::has_out ()
 {
     //  If one part of the message was already written we can definitely
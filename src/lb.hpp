@@ -24,6 +24,7 @@
 
 #include "array.hpp"
 #include "pipe.hpp"
+#include "stdint.hpp"
 
 namespace xs
 {
@@ -45,8 +46,18 @@ namespace xs
         int send (msg_t *msg_, int flags_);
         bool has_out ();
 
+        //  Sets the strategy used to choose the pipe to send the next
+        //  message to. Returns -1 and EINVAL if the strategy is unknown.
+        int set_strategy (int strategy_);
+
+        //  Returns the number of messages dropped so far.
+        uint64_t dropped ();
+
     private:
 
+        //  Moves 'current' to the active pipe chosen by the strategy.
+        void choose ();
+
         //  List of outbound pipes.
         typedef array_t <pipe_t, 2> pipes_t;
         pipes_t pipes;
@@ -64,6 +75,13 @@ namespace xs
         //  True if we are dropping current message.
         bool dropping;
 
+        //  One of XS_LB_* strategies.
+        int strategy;
+
+        //  Number of messages dropped because their pipe have disconnected
+        //  in the middle of the message.
+        uint64_t drops;
+
         lb_t (const lb_t&);
         const lb_t &operator = (const lb_t&);
     };
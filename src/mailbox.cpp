@@ -20,6 +20,7 @@
 */
 
 #include "mailbox.hpp"
+#include "trace.hpp"
 #include "err.hpp"
 
 int xs::mailbox_init (mailbox_t *self_)
@@ -53,6 +54,7 @@ xs::fd_t xs::mailbox_fd (mailbox_t *self_)
 
 void xs::mailbox_send (mailbox_t *self_, const command_t &cmd_)
 {
+    XS_TRACE (command_send, cmd_.destination, cmd_.type);
     self_->sync.lock ();
     self_->cpipe.write (cmd_, false);
     bool ok = self_->cpipe.flush ();
@@ -66,8 +68,10 @@ int xs::mailbox_recv (mailbox_t *self_, command_t *cmd_, int timeout_)
     //  Try to get the command straight away.
     if (self_->active) {
         bool ok = self_->cpipe.read (cmd_);
-        if (ok)
+        if (ok) {
+            XS_TRACE (command_recv, cmd_->destination, cmd_->type);
             return 0;
+        }
 
         //  If there are no more commands available, switch into passive state.
         self_->active = false;
@@ -86,6 +90,7 @@ int xs::mailbox_recv (mailbox_t *self_, command_t *cmd_, int timeout_)
     //  Get a command.
     bool ok = self_->cpipe.read (cmd_);
     xs_assert (ok);
+    XS_TRACE (command_recv, cmd_->destination, cmd_->type);
     return 0;
 }
 
@@ -286,3 +286,50 @@ bool xs::msg_t::rm_refs (int refs_)
     return true;
 }
 
+bool xs::msg_t::stamp (uint64_t origin_, uint64_t now_)
+{
+    if (u.base.type == type_delimiter)
+        return false;
+
+    //  There's no room for the stamps in the tail of this very small
+    //  message. Moving it to the heap would distort the very latency we
+    //  are measuring, so leave it unstamped.
+    if (u.base.type == type_vsm && u.vsm.size > max_vsm_size - stamps_size)
+        return false;
+
+    unsigned char *s = stamps ();
+    if (!(u.base.flags & msg_t::stamped)) {
+        memcpy (s, &origin_, sizeof (uint64_t));
+        u.base.flags |= msg_t::stamped;
+    }
+    memcpy (s + sizeof (uint64_t), &now_, sizeof (uint64_t));
+    return true;
+}
+
+bool xs::msg_t::is_stamped ()
+{
+    return u.base.type != type_delimiter && (u.base.flags & msg_t::stamped);
+}
+
+uint64_t xs::msg_t::origin_stamp ()
+{
+    xs_assert (is_stamped ());
+    uint64_t stamp;
+    memcpy (&stamp, stamps (), sizeof (uint64_t));
+    return stamp;
+}
+
+uint64_t xs::msg_t::last_stamp ()
+{
+    xs_assert (is_stamped ());
+    uint64_t stamp;
+    memcpy (&stamp, stamps () + sizeof (uint64_t), sizeof (uint64_t));
+    return stamp;
+}
+
+unsigned char *xs::msg_t::stamps ()
+{
+    if (u.base.type == type_vsm)
+        return u.vsm.data + max_vsm_size - stamps_size;
+    return u.lmsg.stamps;
+}
@@ -26,6 +26,7 @@
 #include <stddef.h>
 
 #include "config.hpp"
+#include "stdint.hpp"
 #include "atomic_counter.hpp"
 
 //  Signature for free function to deallocate the message content.
@@ -50,10 +51,15 @@ namespace xs
         enum
         {
             more = 1,
+            stamped = 32,
             identity = 64,
             shared = 128
         };
 
+        //  Size in bytes of the largest message that is still copied around
+        //  rather than being reference-counted.
+        enum {max_vsm_size = 29};
+
         bool check ();
         int init ();
         int init_size (size_t size_);
@@ -79,11 +85,26 @@ namespace xs
         //  references drops to 0, the message is closed and false is returned.
         bool rm_refs (int refs_);
 
+        //  Latency stamps. A stamped message carries the time it entered
+        //  the pipeline (origin) and the time it passed the last hop.
+        //  If the message is not yet stamped both are set, otherwise only
+        //  the latter is updated. Large messages keep the stamps next to
+        //  the content pointer, very small messages in the unused tail of
+        //  the data buffer. Very small messages with no room left and
+        //  delimiters are not stamped, in which case false is returned.
+        //  The content of the message is left intact.
+        bool stamp (uint64_t origin_, uint64_t now_);
+        bool is_stamped ();
+        uint64_t origin_stamp ();
+        uint64_t last_stamp ();
+
     private:
 
-        //  Size in bytes of the largest message that is still copied around
-        //  rather than being reference-counted.
-        enum {max_vsm_size = 29};
+        //  Size of the latency stamps.
+        enum {stamps_size = 2 * sizeof (uint64_t)};
+
+        //  Returns pointer to the latency stamps of the message.
+        unsigned char *stamps ();
 
         //  Shared message buffer. Message data are either allocated in one
         //  continuous block along with this structure - thus avoiding one
@@ -129,7 +150,9 @@ namespace xs
             } vsm;
             struct {
                 content_t *content;
-                unsigned char unused [max_vsm_size + 1 - sizeof (content_t*)];
+                unsigned char stamps [stamps_size];
+                unsigned char unused [max_vsm_size + 1 -
+                    sizeof (content_t*) - stamps_size];
                 unsigned char type;
                 unsigned char flags;
             } lmsg;
@@ -65,7 +65,8 @@ void xs::object_t::process_command (command_t &cmd_)
         break;
 
     case command_t::activate_write:
-        process_activate_write (cmd_.args.activate_write.msgs_read);
+        process_activate_write (cmd_.args.activate_write.msgs_read,
+            cmd_.args.activate_write.bytes_read);
         break;
 
     case command_t::stop:
@@ -225,7 +226,7 @@ void xs::object_t::send_activate_read (pipe_t *destination_)
 }
 
 void xs::object_t::send_activate_write (pipe_t *destination_,
-    uint64_t msgs_read_)
+    uint64_t msgs_read_, uint64_t bytes_read_)
 {
     command_t cmd;
 #if defined XS_MAKE_VALGRIND_HAPPY
@@ -234,6 +235,7 @@ void xs::object_t::send_activate_write (pipe_t *destination_,
     cmd.destination = destination_;
     cmd.type = command_t::activate_write;
     cmd.args.activate_write.msgs_read = msgs_read_;
+    cmd.args.activate_write.bytes_read = bytes_read_;
     send_command (cmd);
 }
 
@@ -366,7 +368,8 @@ void xs::object_t::process_activate_read ()
     xs_assert (false);
 }
 
-void xs::object_t::process_activate_write (uint64_t msgs_read_)
+void xs::object_t::process_activate_write (uint64_t msgs_read_,
+    uint64_t bytes_read_)
 {
     xs_assert (false);
 }
@@ -80,7 +80,7 @@ namespace xs
              bool inc_seqnum_ = true);
         void send_activate_read (xs::pipe_t *destination_);
         void send_activate_write (xs::pipe_t *destination_,
-             uint64_t msgs_read_);
+             uint64_t msgs_read_, uint64_t bytes_read_);
         void send_hiccup (xs::pipe_t *destination_, void *pipe_);
         void send_pipe_term (xs::pipe_t *destination_);
         void send_pipe_term_ack (xs::pipe_t *destination_);
@@ -99,7 +99,8 @@ namespace xs
         virtual void process_attach (xs::i_engine *engine_);
         virtual void process_bind (xs::pipe_t *pipe_);
         virtual void process_activate_read ();
-        virtual void process_activate_write (uint64_t msgs_read_);
+        virtual void process_activate_write (uint64_t msgs_read_,
+            uint64_t bytes_read_);
         virtual void process_hiccup (void *pipe_);
         virtual void process_pipe_term ();
         virtual void process_pipe_term_ack ();
@@ -31,6 +31,8 @@
 xs::options_t::options_t () :
     sndhwm (1000),
     rcvhwm (1000),
+    sndhwm_bytes (0),
+    rcvhwm_bytes (0),
     affinity (0),
     identity_size (0),
     rate (100),
@@ -55,7 +57,15 @@ xs::options_t::options_t () :
     sp_role (-1),
     sp_complement (-1),
     filter (XS_FILTER_PREFIX),
+    filter_offload (false),
+    filter_aggregate (-1),
+    req_outstanding (1),
+    lb_strategy (XS_LB_ROUND_ROBIN),
+    rcvpriority (0),
     survey_timeout (-1),
+    survey_quorum (0),
+    latency (0),
+    pipe_ring (false),
     delay_on_close (true),
     delay_on_disconnect (true),
     send_identity (false),
@@ -85,6 +95,22 @@ int xs::options_t::setsockopt (int option_, const void *optval_,
         rcvhwm = *((int*) optval_);
         return 0;
 
+    case XS_SNDHWM_BYTES:
+        if (optvallen_ != sizeof (uint64_t)) {
+            errno = EINVAL;
+            return -1;
+        }
+        sndhwm_bytes = *((uint64_t*) optval_);
+        return 0;
+
+    case XS_RCVHWM_BYTES:
+        if (optvallen_ != sizeof (uint64_t)) {
+            errno = EINVAL;
+            return -1;
+        }
+        rcvhwm_bytes = *((uint64_t*) optval_);
+        return 0;
+
     case XS_AFFINITY:
         if (optvallen_ != sizeof (uint64_t)) {
             errno = EINVAL;
@@ -249,6 +275,52 @@ int xs::options_t::setsockopt (int option_, const void *optval_,
         filter = *((int*) optval_);
         return 0;
 
+    case XS_FILTER_OFFLOAD:
+        {
+            if (type != XS_PUB && type != XS_XPUB) {
+                errno = ENOTSUP;
+                return -1;
+            }
+            if (optvallen_ != sizeof (int)) {
+                errno = EINVAL;
+                return -1;
+            }
+            int val = *((int*) optval_);
+            if (val != 0 && val != 1) {
+                errno = EINVAL;
+                return -1;
+            }
+            filter_offload = val ? true : false;
+            return 0;
+        }
+
+    case XS_FILTER_AGGREGATE:
+
+        //  The option is handled by the subscriber sockets themselves.
+        errno = (type != XS_SUB && type != XS_XSUB) ? ENOTSUP : EINVAL;
+        return -1;
+
+    case XS_REQ_OUTSTANDING:
+
+        //  The option is handled by the REQ socket itself.
+        errno = type != XS_REQ ? ENOTSUP : EINVAL;
+        return -1;
+
+    case XS_RCVPRIORITY:
+        if (optvallen_ != sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        rcvpriority = *((int*) optval_);
+        return 0;
+
+    case XS_LB_STRATEGY:
+
+        //  The option is handled by the load-balancing sockets themselves.
+        errno = (type != XS_PUSH && type != XS_XREQ && type != XS_REQ) ?
+            ENOTSUP : EINVAL;
+        return -1;
+
     case XS_SERVICE_ID:
         {
             if (optvallen_ != sizeof (int)) {
@@ -276,6 +348,48 @@ int xs::options_t::setsockopt (int option_, const void *optval_,
         survey_timeout = *((int*) optval_);
         return 0;
 
+    case XS_SURVEY_QUORUM:
+        if (type != XS_SURVEYOR) {
+            errno = ENOTSUP;
+            return -1;
+        }
+        if (optvallen_ != sizeof (int) || *((int*) optval_) < -1) {
+            errno = EINVAL;
+            return -1;
+        }
+        survey_quorum = *((int*) optval_);
+        return 0;
+
+    case XS_LATENCY:
+        {
+            if (optvallen_ != sizeof (int)) {
+                errno = EINVAL;
+                return -1;
+            }
+            int val = *((int*) optval_);
+            if (val != 0 && val != 1) {
+                errno = EINVAL;
+                return -1;
+            }
+            latency = val;
+            return 0;
+        }
+
+    case XS_PIPE_RING:
+        {
+            if (optvallen_ != sizeof (int)) {
+                errno = EINVAL;
+                return -1;
+            }
+            int val = *((int*) optval_);
+            if (val != 0 && val != 1) {
+                errno = EINVAL;
+                return -1;
+            }
+            pipe_ring = val ? true : false;
+            return 0;
+        }
+
     }
 
     errno = EINVAL;
@@ -304,6 +418,24 @@ int xs::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
         *optvallen_ = sizeof (int);
         return 0;
 
+    case XS_SNDHWM_BYTES:
+        if (*optvallen_ < sizeof (uint64_t)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((uint64_t*) optval_) = sndhwm_bytes;
+        *optvallen_ = sizeof (uint64_t);
+        return 0;
+
+    case XS_RCVHWM_BYTES:
+        if (*optvallen_ < sizeof (uint64_t)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((uint64_t*) optval_) = rcvhwm_bytes;
+        *optvallen_ = sizeof (uint64_t);
+        return 0;
+
     case XS_AFFINITY:
         if (*optvallen_ < sizeof (uint64_t)) {
             errno = EINVAL;
@@ -484,6 +616,67 @@ int xs::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
         *optvallen_ = sizeof (int);
         return 0;
 
+    case XS_FILTER_OFFLOAD:
+        if (type != XS_PUB && type != XS_XPUB) {
+            errno = ENOTSUP;
+            return -1;
+        }
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) = filter_offload ? 1 : 0;
+        *optvallen_ = sizeof (int);
+        return 0;
+
+    case XS_FILTER_AGGREGATE:
+        if (type != XS_SUB && type != XS_XSUB) {
+            errno = ENOTSUP;
+            return -1;
+        }
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) = filter_aggregate;
+        *optvallen_ = sizeof (int);
+        return 0;
+
+    case XS_REQ_OUTSTANDING:
+        if (type != XS_REQ) {
+            errno = ENOTSUP;
+            return -1;
+        }
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) = req_outstanding;
+        *optvallen_ = sizeof (int);
+        return 0;
+
+    case XS_RCVPRIORITY:
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) = rcvpriority;
+        *optvallen_ = sizeof (int);
+        return 0;
+
+    case XS_LB_STRATEGY:
+        if (type != XS_PUSH && type != XS_XREQ && type != XS_REQ) {
+            errno = ENOTSUP;
+            return -1;
+        }
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) = lb_strategy;
+        *optvallen_ = sizeof (int);
+        return 0;
+
     case XS_SURVEY_TIMEOUT:
         if (type != XS_SURVEYOR) {
             errno = ENOTSUP;
@@ -497,6 +690,37 @@ int xs::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
         *optvallen_ = sizeof (int);
         return 0;
 
+    case XS_SURVEY_QUORUM:
+        if (type != XS_SURVEYOR) {
+            errno = ENOTSUP;
+            return -1;
+        }
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) = survey_quorum;
+        *optvallen_ = sizeof (int);
+        return 0;
+
+    case XS_LATENCY:
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) = latency;
+        *optvallen_ = sizeof (int);
+        return 0;
+
+    case XS_PIPE_RING:
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) = pipe_ring ? 1 : 0;
+        *optvallen_ = sizeof (int);
+        return 0;
+
     }
 
     errno = EINVAL;
@@ -40,6 +40,10 @@ namespace xs
         int sndhwm;
         int rcvhwm;
 
+        //  High watermarks in bytes. Zero means no limit.
+        uint64_t sndhwm_bytes;
+        uint64_t rcvhwm_bytes;
+
         //  I/O thread affinity.
         uint64_t affinity;
 
@@ -106,9 +110,41 @@ namespace xs
         //  Filter ID to be used with subscriptions and unsubscriptions.
         int filter;
 
+        //  If true, publisher-side matching of messages against the
+        //  subscriptions is done by the sessions in the I/O threads rather
+        //  than by the socket itself.
+        bool filter_offload;
+
+        //  Maximal length of prefix subscriptions forwarded upstream. Longer
+        //  subscriptions are replaced by their covering prefixes. -1 means
+        //  that subscriptions are forwarded unchanged.
+        int filter_aggregate;
+
+        //  Maximal number of requests a REQ socket can have in flight.
+        int req_outstanding;
+
+        //  Strategy used to choose the outbound pipe for the next message.
+        int lb_strategy;
+
+        //  Priority of the inbound messages from the subsequently created
+        //  connections. Higher priority messages are received first.
+        int rcvpriority;
+
         //  Timeout for the survey in milliseconds. -1 means infinite.
         int survey_timeout;
 
+        //  Number of responses after which the survey completes. 0 means
+        //  that the survey runs until it times out, -1 means that responses
+        //  from all the peers the survey was sent to are needed.
+        int survey_quorum;
+
+        //  If 1, messages are stamped with the time they pass individual
+        //  hops of the pipeline and the dwell times are collected.
+        int latency;
+
+        //  If true, pipes with finite HWM are backed by preallocated rings.
+        bool pipe_ring;
+
         //  If true, session reads all the pending messages from the pipe and
         //  sends them to the network when socket is closed.
         bool delay_on_close;
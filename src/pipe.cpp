@@ -21,27 +21,30 @@
 */
 
 #include <new>
+#include <algorithm>
 #include <stddef.h>
 
 #include "pipe.hpp"
+#include "trace.hpp"
 #include "err.hpp"
 
 int xs::pipepair (class object_t *parents_ [2], class pipe_t* pipes_ [2],
-    int hwms_ [2], bool delays_ [2], int sp_version_)
+    int hwms_ [2], uint64_t byte_hwms_ [2], bool delays_ [2], bool ring_,
+    int sp_version_)
 {
     //   Creates two pipe objects. These objects are connected by two ypipes,
     //   each to pass messages in one direction.
 
-    pipe_t::upipe_t *upipe1 = new (std::nothrow) pipe_t::upipe_t ();
-    alloc_assert (upipe1);
-    pipe_t::upipe_t *upipe2 = new (std::nothrow) pipe_t::upipe_t ();
-    alloc_assert (upipe2);
+    pipe_t::upipe_t *upipe1 = pipe_t::create_upipe (hwms_ [1], ring_);
+    pipe_t::upipe_t *upipe2 = pipe_t::create_upipe (hwms_ [0], ring_);
 
     pipes_ [0] = new (std::nothrow) pipe_t (parents_ [0], upipe1, upipe2,
-        hwms_ [1], hwms_ [0], delays_ [0], sp_version_);
+        hwms_ [1], hwms_ [0], byte_hwms_ [1], byte_hwms_ [0], delays_ [0],
+        sp_version_);
     alloc_assert (pipes_ [0]);
     pipes_ [1] = new (std::nothrow) pipe_t (parents_ [1], upipe2, upipe1,
-        hwms_ [0], hwms_ [1], delays_ [1], sp_version_);
+        hwms_ [0], hwms_ [1], byte_hwms_ [0], byte_hwms_ [1], delays_ [1],
+        sp_version_);
     alloc_assert (pipes_ [1]);
 
     pipes_ [0]->set_peer (pipes_ [1]);
@@ -50,23 +53,90 @@ int xs::pipepair (class object_t *parents_ [2], class pipe_t* pipes_ [2],
     return 0;
 }
 
+inline void xs::pipe_t::upipe_write (upipe_t *upipe_, const msg_t &msg_,
+    bool incomplete_)
+{
+    if (likely (!upipe_->ring))
+        ((ypipe_type*) upipe_)->write (msg_, incomplete_);
+    else
+        ((yring_type*) upipe_)->write (msg_, incomplete_);
+}
+
+inline bool xs::pipe_t::upipe_unwrite (upipe_t *upipe_, msg_t *msg_)
+{
+    if (likely (!upipe_->ring))
+        return ((ypipe_type*) upipe_)->unwrite (msg_);
+    return ((yring_type*) upipe_)->unwrite (msg_);
+}
+
+inline bool xs::pipe_t::upipe_flush (upipe_t *upipe_)
+{
+    if (likely (!upipe_->ring))
+        return ((ypipe_type*) upipe_)->flush ();
+    return ((yring_type*) upipe_)->flush ();
+}
+
+inline bool xs::pipe_t::upipe_check_read (upipe_t *upipe_)
+{
+    if (likely (!upipe_->ring))
+        return ((ypipe_type*) upipe_)->check_read ();
+    return ((yring_type*) upipe_)->check_read ();
+}
+
+inline bool xs::pipe_t::upipe_read (upipe_t *upipe_, msg_t *msg_)
+{
+    if (likely (!upipe_->ring))
+        return ((ypipe_type*) upipe_)->read (msg_);
+    return ((yring_type*) upipe_)->read (msg_);
+}
+
+inline bool xs::pipe_t::upipe_probe (upipe_t *upipe_, bool (*fn)(msg_t &))
+{
+    if (likely (!upipe_->ring))
+        return ((ypipe_type*) upipe_)->probe (fn);
+    return ((yring_type*) upipe_)->probe (fn);
+}
+
+inline void xs::pipe_t::upipe_delete (upipe_t *upipe_)
+{
+    if (likely (!upipe_->ring))
+        delete (ypipe_type*) upipe_;
+    else
+        delete (yring_type*) upipe_;
+}
+
 xs::pipe_t::pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
-      int inhwm_, int outhwm_, bool delay_, int sp_version_) :
+      int inhwm_, int outhwm_, uint64_t in_byte_hwm_, uint64_t out_byte_hwm_,
+      bool delay_, int sp_version_) :
     object_t (parent_),
     inpipe (inpipe_),
     outpipe (outpipe_),
     in_active (true),
     out_active (true),
     hwm (outhwm_),
+    inhwm (inhwm_),
     lwm (compute_lwm (inhwm_)),
     msgs_read (0),
     msgs_written (0),
     peers_msgs_read (0),
+    byte_hwm (out_byte_hwm_),
+    byte_lwm ((in_byte_hwm_ + 1) / 2),
+    bytes_read (0),
+    bytes_written (0),
+    bytes_reported (0),
+    peers_bytes_read (0),
+    out_more (false),
     peer (NULL),
     sink (NULL),
     state (active),
     delay (delay_),
-    sp_version (sp_version_)
+    sp_version (sp_version_),
+    filter_offload (false),
+    priority (0),
+    credit_flow (false),
+    credit_limit (0),
+    credit_connection (0),
+    msgs_granted (0)
 {
 }
 
@@ -98,22 +168,42 @@ xs::blob_t xs::pipe_t::get_identity ()
     return identity;
 }
 
+void xs::pipe_t::set_filter_offload ()
+{
+    filter_offload = true;
+}
+
+bool xs::pipe_t::get_filter_offload ()
+{
+    return filter_offload;
+}
+
+void xs::pipe_t::set_priority (int priority_)
+{
+    priority = priority_;
+}
+
+int xs::pipe_t::get_priority ()
+{
+    return priority;
+}
+
 bool xs::pipe_t::check_read ()
 {
     if (unlikely (!in_active || (state != active && state != pending)))
         return false;
 
     //  Check if there's an item in the pipe.
-    if (!inpipe->check_read ()) {
+    if (!upipe_check_read (inpipe)) {
         in_active = false;
         return false;
     }
 
     //  If the next item in the pipe is message delimiter,
     //  initiate termination process.
-    if (inpipe->probe (is_delimiter)) {
+    if (upipe_probe (inpipe, is_delimiter)) {
         msg_t msg;
-        bool ok = inpipe->read (&msg);
+        bool ok = upipe_read (inpipe, &msg);
         xs_assert (ok);
         delimit ();
         return false;
@@ -127,7 +217,7 @@ bool xs::pipe_t::read (msg_t *msg_)
     if (unlikely (!in_active || (state != active && state != pending)))
         return false;
 
-    if (!inpipe->read (msg_)) {
+    if (!upipe_read (inpipe, msg_)) {
         in_active = false;
         return false;
     }
@@ -140,9 +230,16 @@ bool xs::pipe_t::read (msg_t *msg_)
 
     if (!(msg_->flags () & msg_t::more))
         msgs_read++;
-
-    if (lwm > 0 && msgs_read % lwm == 0)
-        send_activate_write (peer, msgs_read);
+    bytes_read += msg_->size ();
+    XS_TRACE (pipe_read, this, msg_->size ());
+
+    //  Let the writer know how much was read either once per low watermark
+    //  messages or once per low watermark bytes.
+    if ((lwm > 0 && msgs_read % lwm == 0) ||
+          (byte_lwm > 0 && bytes_read - bytes_reported >= byte_lwm)) {
+        bytes_reported = bytes_read;
+        send_activate_write (peer, msgs_read, bytes_read);
+    }
 
     return true;
 }
@@ -154,6 +251,19 @@ bool xs::pipe_t::check_write (msg_t *msg_)
 
     bool full = hwm > 0 && msgs_written - peers_msgs_read == uint64_t (hwm);
 
+    //  Byte high watermark is checked only at the beginning of the message.
+    //  Thus, a single message can exceed the limit but we never block in
+    //  the middle of a multipart message.
+    if (byte_hwm > 0 && !out_more &&
+          bytes_written - peers_bytes_read >= byte_hwm)
+        full = true;
+
+    //  With credit-based flow control the pipe is full also when there's no
+    //  credit left. The credit is consumed by the last part of the message
+    //  so we never block in the middle of a multipart message.
+    if (unlikely (credit_flow && !out_more && msgs_written >= credit_limit))
+        full = true;
+
     if (unlikely (full)) {
         out_active = false;
         return false;
@@ -168,7 +278,10 @@ bool xs::pipe_t::write (msg_t *msg_)
         return false;
 
     bool more = msg_->flags () & msg_t::more ? true : false;
-    outpipe->write (*msg_, more);
+    bytes_written += msg_->size ();
+    XS_TRACE (pipe_write, this, msg_->size ());
+    upipe_write (outpipe, *msg_, more);
+    out_more = more;
     if (!more)
         msgs_written++;
 
@@ -180,12 +293,14 @@ void xs::pipe_t::rollback ()
     //  Remove incomplete message from the outbound pipe.
     msg_t msg;
     if (outpipe) {
-		while (outpipe->unwrite (&msg)) {
+		while (upipe_unwrite (outpipe, &msg)) {
 		    xs_assert (msg.flags () & msg_t::more);
+		    bytes_written -= msg.size ();
 		    int rc = msg.close ();
 		    errno_assert (rc == 0);
 		}
     }
+    out_more = false;
 }
 
 void xs::pipe_t::flush ()
@@ -198,7 +313,7 @@ void xs::pipe_t::flush ()
     if (state == terminating)
         return;
 
-    if (outpipe && !outpipe->flush ())
+    if (outpipe && !upipe_flush (outpipe))
         send_activate_read (peer);
 }
 
@@ -210,10 +325,12 @@ void xs::pipe_t::process_activate_read ()
     }
 }
 
-void xs::pipe_t::process_activate_write (uint64_t msgs_read_)
+void xs::pipe_t::process_activate_write (uint64_t msgs_read_,
+    uint64_t bytes_read_)
 {
-    //  Remember the peers's message sequence number.
+    //  Remember the peers's message and byte sequence numbers.
     peers_msgs_read = msgs_read_;
+    peers_bytes_read = bytes_read_;
 
     if (!out_active && state == active) {
         out_active = true;
@@ -225,18 +342,39 @@ void xs::pipe_t::process_hiccup (void *pipe_)
 {
     //  Destroy old outpipe. Note that the read end of the pipe was already
     //  migrated to this thread.
+    //  The messages dropped will never be reported as read by the peer,
+    //  so they have to be removed from the high watermark accounting.
     xs_assert (outpipe);
-    outpipe->flush ();
+    upipe_flush (outpipe);
     msg_t msg;
-    while (outpipe->read (&msg)) {
+    bool delimited = false;
+    while (upipe_read (outpipe, &msg)) {
+       if (msg.is_delimiter ())
+           delimited = true;
+       else {
+           if (!(msg.flags () & msg_t::more))
+               msgs_written--;
+           bytes_written -= msg.size ();
+       }
        int rc = msg.close ();
        errno_assert (rc == 0);
     }
-    delete outpipe;
+    upipe_delete (outpipe);
+    out_more = false;
 
     //  Plug in the new outpipe.
     xs_assert (pipe_);
     outpipe = (upipe_t*) pipe_;
+
+    //  If the pipe is being terminated, the peer is still waiting for
+    //  the delimiter. Pass it via the new outpipe.
+    if (delimited) {
+        msg.init_delimiter ();
+        upipe_write (outpipe, msg, false);
+        if (!upipe_flush (outpipe))
+            send_activate_read (peer);
+        return;
+    }
     out_active = true;
 
     //  If appropriate, notify the user about the hiccup.
@@ -312,11 +450,11 @@ void xs::pipe_t::process_pipe_term_ack ()
     //  hand because msg_t doesn't have automatic destructor. Then deallocate
     //  the ypipe itself.
     msg_t msg;
-    while (inpipe->read (&msg)) {
+    while (upipe_read (inpipe, &msg)) {
        int rc = msg.close ();
        errno_assert (rc == 0);
     }
-    delete inpipe;
+    upipe_delete (inpipe);
 
     //  Deallocate the pipe object
     delete this;
@@ -380,8 +518,8 @@ void xs::pipe_t::terminate (bool delay_)
         //  is full.
 		msg_t msg;
 		msg.init_delimiter ();
-		outpipe->write (msg, false);
-        if (state != terminating && !outpipe->flush ())
+		upipe_write (outpipe, msg, false);
+        if (state != terminating && !upipe_flush (outpipe))
             send_activate_read (peer);
     }
 }
@@ -391,11 +529,79 @@ int xs::pipe_t::get_sp_version ()
     return sp_version;
 }
 
+uint64_t xs::pipe_t::get_outstanding ()
+{
+    return msgs_written - peers_msgs_read;
+}
+
+void xs::pipe_t::get_stats (xs_pipe_stats_t *stats_)
+{
+    stats_->msgs_in = msgs_read;
+    stats_->bytes_in = bytes_read;
+    stats_->msgs_out = msgs_written;
+    stats_->bytes_out = bytes_written;
+    stats_->queued_out = msgs_written - peers_msgs_read;
+    stats_->blocked_out = out_active ? 0 : 1;
+}
+
+void xs::pipe_t::enable_credit ()
+{
+    credit_flow = true;
+}
+
+void xs::pipe_t::add_credit (uint32_t credit_, uint32_t connection_,
+    uint64_t base_)
+{
+    if (connection_ < credit_connection)
+        return;
+    if (connection_ > credit_connection) {
+        credit_connection = connection_;
+        credit_limit = base_;
+    }
+    credit_limit += credit_;
+
+    //  If the pipe was blocked, try to unblock it. If it's still over the high
+    //  watermark it will be blocked again on the next write.
+    if (!out_active && msgs_written < credit_limit && state == active) {
+        out_active = true;
+        sink->write_activated (this);
+    }
+}
+
+uint64_t xs::pipe_t::get_ungranted ()
+{
+    return msgs_read - msgs_granted;
+}
+
+void xs::pipe_t::add_granted (uint64_t count_)
+{
+    msgs_granted += count_;
+}
+
 bool xs::pipe_t::is_delimiter (msg_t &msg_)
 {
     return msg_.is_delimiter ();
 }
 
+xs::pipe_t::upipe_t *xs::pipe_t::create_upipe (int hwm_, bool ring_)
+{
+    upipe_t *upipe;
+    if (ring_ && hwm_ > 0) {
+
+        //  The ring has to accommodate all the messages the writer is allowed
+        //  to write plus the delimiter. Reader reports the freed slots in
+        //  batches of 1/8 of the ring, so some slack is needed on top of it.
+        size_t capacity = message_ring_max_size;
+        if (hwm_ < message_ring_max_size)
+            capacity = std::min (capacity, ((size_t) hwm_ + 2) * 8 / 7 + 1);
+        upipe = new (std::nothrow) yring_type (capacity);
+    }
+    else
+        upipe = new (std::nothrow) ypipe_type ();
+    alloc_assert (upipe);
+    return upipe;
+}
+
 int xs::pipe_t::compute_lwm (int hwm_)
 {
     //  Compute the low water mark. Following point should be taken
@@ -448,13 +654,15 @@ void xs::pipe_t::hiccup ()
     if (state != active)
         return;
 
+    XS_TRACE (pipe_hiccup, this, 0);
+
     //  We'll drop the pointer to the inpipe. From now on, the peer is
     //  responsible for deallocating it.
+    bool ring = inpipe->ring;
     inpipe = NULL;
 
-    //  Create new inpipe.
-    inpipe = new (std::nothrow) pipe_t::upipe_t ();
-    alloc_assert (inpipe);
+    //  Create new inpipe of the same kind.
+    inpipe = create_upipe (inhwm, ring);
     in_active = true;
 
     //  Notify the peer about the hiccup.
@@ -25,6 +25,7 @@
 
 #include "msg.hpp"
 #include "ypipe.hpp"
+#include "yring.hpp"
 #include "config.hpp"
 #include "object.hpp"
 #include "stdint.hpp"
@@ -40,11 +41,16 @@ namespace xs
     //  Create a pipepair for bi-directional transfer of messages.
     //  First HWM is for messages passed from first pipe to the second pipe.
     //  Second HWM is for messages passed from second pipe to the first pipe.
+    //  Byte HWMs work the same way, except that they limit the size of the
+    //  messages in the pipe rather than their number.
     //  Delay specifies how the pipe behaves when the peer terminates. If true
     //  pipe receives all the pending messages before terminating, otherwise it
     //  terminates straight away.
+    //  If ring is true, directions with finite HWM are backed by preallocated
+    //  rings rather than by linked lists of chunks.
     int pipepair (xs::object_t *parents_ [2], xs::pipe_t* pipes_ [2],
-        int hwms_ [2], bool delays_ [2], int sp_version_);
+        int hwms_ [2], uint64_t byte_hwms_ [2], bool delays_ [2], bool ring_,
+        int sp_version_);
 
     struct i_pipe_events
     {
@@ -68,8 +74,8 @@ namespace xs
     {
         //  This allows pipepair to create pipe objects.
         friend int pipepair (xs::object_t *parents_ [2],
-            xs::pipe_t* pipes_ [2], int hwms_ [2], bool delays_ [2],
-            int sp_version_);
+            xs::pipe_t* pipes_ [2], int hwms_ [2], uint64_t byte_hwms_ [2],
+            bool delays_ [2], bool ring_, int sp_version_);
 
     public:
 
@@ -80,6 +86,16 @@ namespace xs
         void set_identity (const blob_t &identity_);
         blob_t get_identity ();
 
+        //  Marks the pipe as leading to a session that matches the messages
+        //  against the subscriptions itself.
+        void set_filter_offload ();
+        bool get_filter_offload ();
+
+        //  Priority used by the reader when choosing the pipe to read
+        //  the next message from.
+        void set_priority (int priority_);
+        int get_priority ();
+
         //  Returns true if there is at least one message to read in the pipe.
         bool check_read ();
 
@@ -114,14 +130,65 @@ namespace xs
         //  Returns the SP pattern version in use on this pipe.
         int get_sp_version ();
 
+        //  Returns the number of messages written to the pipe that the peer
+        //  haven't reported as read yet. The peer reports the number of
+        //  messages read once per low watermark, so the value is approximate.
+        uint64_t get_outstanding ();
+
+        //  Fills in the snapshot of the pipe's counters as seen from this
+        //  end of the pipe.
+        void get_stats (xs_pipe_stats_t *stats_);
+
+        //  Enables credit-based flow control on the outbound side of the pipe.
+        //  From now on, messages are written only while there's credit
+        //  granted by the peer left.
+        void enable_credit ();
+
+        //  Adds credit granted by the peer on the specified connection.
+        //  Credit granted on a connection that was already replaced is
+        //  ignored, credit granted on a newer connection replaces whatever
+        //  credit was left. 'base_' is the number of messages written to
+        //  the pipe that were consumed by the previous connections. Those
+        //  written afterwards count against the credit of the new one.
+        //  If the pipe was blocked because of lack of credit,
+        //  'write_activated' event is generated.
+        void add_credit (uint32_t credit_, uint32_t connection_ = 0,
+            uint64_t base_ = 0);
+
+        //  Returns the number of messages read from the pipe that the peer
+        //  wasn't granted the credit for yet.
+        uint64_t get_ungranted ();
+
+        //  Marks the specified number of messages read as granted.
+        void add_granted (uint64_t count_);
+
     private:
 
-        //  Type of the underlying lock-free pipe.
-        typedef ypipe_t <msg_t, message_pipe_granularity> upipe_t;
+        //  Type of the underlying lock-free pipe and its two implementations.
+        typedef ypipe_base_t <msg_t> upipe_t;
+        typedef ypipe_t <msg_t, message_pipe_granularity> ypipe_type;
+        typedef yring_t <msg_t> yring_type;
+
+        //  Creates the lock-free pipe for the specified HWM. If ring is
+        //  requested and HWM is finite preallocated ring is used, otherwise
+        //  it's ypipe_t.
+        static upipe_t *create_upipe (int hwm_, bool ring_);
+
+        //  Access to the underlying lock-free pipe. Calls the actual
+        //  implementation according to the type of the pipe.
+        static void upipe_write (upipe_t *upipe_, const msg_t &msg_,
+            bool incomplete_);
+        static bool upipe_unwrite (upipe_t *upipe_, msg_t *msg_);
+        static bool upipe_flush (upipe_t *upipe_);
+        static bool upipe_check_read (upipe_t *upipe_);
+        static bool upipe_read (upipe_t *upipe_, msg_t *msg_);
+        static bool upipe_probe (upipe_t *upipe_, bool (*fn)(msg_t &));
+        static void upipe_delete (upipe_t *upipe_);
 
         //  Command handlers.
         void process_activate_read ();
-        void process_activate_write (uint64_t msgs_read_);
+        void process_activate_write (uint64_t msgs_read_,
+            uint64_t bytes_read_);
         void process_hiccup (void *pipe_);
         void process_pipe_term ();
         void process_pipe_term_ack ();
@@ -132,7 +199,8 @@ namespace xs
         //  Constructor is private. Pipe can only be created using
         //  pipepair function.
         pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
-            int inhwm_, int outhwm_, bool delay_, int sp_version_);
+            int inhwm_, int outhwm_, uint64_t in_byte_hwm_,
+            uint64_t out_byte_hwm_, bool delay_, int sp_version_);
 
         //  Pipepair uses this function to let us know about
         //  the peer pipe object.
@@ -152,7 +220,8 @@ namespace xs
         //  High watermark for the outbound pipe.
         int hwm;
 
-        //  Low watermark for the inbound pipe.
+        //  High and low watermark for the inbound pipe.
+        int inhwm;
         int lwm;
 
         //  Number of messages read and written so far.
@@ -163,6 +232,28 @@ namespace xs
         //  can be higher at the moment.
         uint64_t peers_msgs_read;
 
+        //  High watermark in bytes for the outbound pipe. Zero means there's
+        //  no limit.
+        uint64_t byte_hwm;
+
+        //  Low watermark in bytes for the inbound pipe, i.e. the number of
+        //  bytes to read before reporting them to the peer. Zero means that
+        //  the bytes are not reported on their own.
+        uint64_t byte_lwm;
+
+        //  Number of bytes read and written so far.
+        uint64_t bytes_read;
+        uint64_t bytes_written;
+
+        //  Number of bytes read when the peer was last notified.
+        uint64_t bytes_reported;
+
+        //  Last received peer's bytes_read.
+        uint64_t peers_bytes_read;
+
+        //  True if we are in the middle of writing a multipart message.
+        bool out_more;
+
         //  The pipe object on the other side of the pipepair.
         pipe_t *peer;
 
@@ -199,6 +290,25 @@ namespace xs
         //  Identity of the writer. Used uniquely by the reader side.
         blob_t identity;
 
+        //  If true, the messages written to the pipe are filtered by the peer.
+        bool filter_offload;
+
+        //  Priority of the inbound messages.
+        int priority;
+
+        //  If true, credit-based flow control is used on the outbound side.
+        bool credit_flow;
+
+        //  Number of messages that can be written in total before the peer
+        //  grants more credit.
+        uint64_t credit_limit;
+
+        //  Connection the credit was granted on.
+        uint32_t credit_connection;
+
+        //  Number of messages read the peer was granted the credit for.
+        uint64_t msgs_granted;
+
         //  Returns true if the message is delimiter; false otherwise.
         static bool is_delimiter (msg_t &msg_);
 
@@ -131,6 +131,7 @@ void xs::poll_t::loop ()
         //  in checking the pollset.
         if (rc == 0)
             continue;
+        woken_up (rc);
 
         for (pollset_t::size_type i = 0; i != pollset.size (); i++) {
 
@@ -138,15 +139,18 @@ void xs::poll_t::loop ()
             if (pollset [i].fd == retired_fd)
                continue;
             if (pollset [i].revents & (POLLERR | POLLHUP))
-                fd_table [pollset [i].fd].events->in_event (pollset [i].fd);
+                dispatch_in_event (fd_table [pollset [i].fd].events,
+                    pollset [i].fd);
             if (pollset [i].fd == retired_fd)
                continue;
             if (pollset [i].revents & POLLOUT)
-                fd_table [pollset [i].fd].events->out_event (pollset [i].fd);
+                dispatch_out_event (fd_table [pollset [i].fd].events,
+                    pollset [i].fd);
             if (pollset [i].fd == retired_fd)
                continue;
             if (pollset [i].revents & POLLIN)
-                fd_table [pollset [i].fd].events->in_event (pollset [i].fd);
+                dispatch_in_event (fd_table [pollset [i].fd].events,
+                    pollset [i].fd);
         }
 
         //  Clean up the pollset and update the fd_table accordingly.
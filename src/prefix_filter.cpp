@@ -21,14 +21,33 @@
 
 #include <new>
 #include <map>
+#include <vector>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined __SSE2__ || defined _M_X64 || \
+    (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define XS_PFX_SSE2
+#include <emmintrin.h>
+#endif
 
 #include "../include/xs/xs.h"
 
 #include "prefix_filter.hpp"
 #include "err.hpp"
 
+//  Maximal number of subscribers reported to the core in a single call.
+enum {pfx_batch_size = 64};
+
+//  Subscriptions up to this length are stored in the packed table used
+//  by the SIMD matcher. It equals the width of an SSE2 register.
+enum {pfx_packed_size = 16};
+
+//  Maximal number of subscriptions matched using the packed table. Above
+//  this count the trie lookup is faster than the linear scan.
+enum {pfx_packed_max = 256};
+
 struct pfx_node_t
 {
     //  Pointer to particular subscriber associated with the reference count.
@@ -484,88 +503,144 @@ static void pf_unsubscribe_all (void *core_, void *pf_, void *subscriber_)
     free (buff);
 }
 
-static void pf_match (void *core_, void *pf_,
-    const unsigned char *data_, size_t size_)
+static void pf_match_batch (void *core_, void *pf_, int count_,
+    const unsigned char **data_, const size_t *size_)
 {
-    pfx_node_t *current = (pfx_node_t*) pf_;
-    while (true) {
-
-        //  Signal the subscribers attached to this node.
-        if (current->subscribers) {
-            for (pfx_node_t::subscribers_t::iterator it =
-                  current->subscribers->begin ();
-                  it != current->subscribers->end (); ++it) {
-                int rc = xs_filter_matching (core_, it->first);
-                errno_assert (rc == 0);
+    //  Matching subscribers are reported in dense chunks rather than
+    //  one by one.
+    void *buff [pfx_batch_size];
+    for (int i = 0; i != count_; i++) {
+        const unsigned char *data = data_ [i];
+        size_t size = size_ [i];
+        pfx_node_t *current = (pfx_node_t*) pf_;
+        while (current) {
+
+            //  Signal the subscribers attached to this node.
+            if (current->subscribers) {
+                int n = 0;
+                for (pfx_node_t::subscribers_t::iterator it =
+                      current->subscribers->begin ();
+                      it != current->subscribers->end (); ++it) {
+                    buff [n++] = it->first;
+                    if (n == pfx_batch_size) {
+                        int rc = xs_filter_matching_batch (core_, i, buff, n);
+                        errno_assert (rc == 0);
+                        n = 0;
+                    }
+                }
+                if (n) {
+                    int rc = xs_filter_matching_batch (core_, i, buff, n);
+                    errno_assert (rc == 0);
+                }
             }
-        }
-
-        //  If we are at the end of the message, there's nothing more to match.
-        if (!size_)
-            break;
-
-        //  If there are no subnodes in the trie, return.
-        if (current->count == 0)
-            break;
 
-        //  If there's one subnode (optimisation).
-		if (current->count == 1) {
-            if (data_ [0] != current->min)
+            //  Move to the next node, if any.
+            if (!size || current->count == 0)
                 break;
-            current = current->next.node;
-            data_++;
-            size_--;
-		    continue;
-		}
-
-		//  If there are multiple subnodes.
-        if (data_ [0] < current->min || data_ [0] >=
-              current->min + current->count)
-            break;
-        if (!current->next.table [data_ [0] - current->min])
-            break;
-        current = current->next.table [data_ [0] - current->min];
-        data_++;
-        size_--;
+            unsigned char c = *data;
+            if (c < current->min || c >= current->min + current->count)
+                break;
+            current = current->count == 1 ? current->next.node :
+                current->next.table [c - current->min];
+            data++;
+            size--;
+        }
     }
 }
 
+static void pf_match (void *core_, void *pf_,
+    const unsigned char *data_, size_t size_)
+{
+    pf_match_batch (core_, pf_, 1, &data_, &size_);
+}
+
+//  Subscriber-side filter state. Alongside the trie, short subscriptions
+//  are kept in a flat table so that small subscription sets can be matched
+//  by comparing the message head against all of them using SIMD.
+struct pfx_sf_t
+{
+    pfx_node_t trie;
+
+    struct packed_t
+    {
+        unsigned char data [pfx_packed_size];
+        size_t size;
+        unsigned int mask;
+    };
+    typedef std::vector <packed_t> packed_set_t;
+    packed_set_t packed;
+
+    //  Number of subscriptions too long to be stored in 'packed'.
+    int unpacked;
+};
+
 static void *sf_create (void *core_)
 {
-    pfx_node_t *root = (pfx_node_t*) malloc (sizeof (pfx_node_t));
-    alloc_assert (root);
-    pfx_init (root);
-    return (void*) root;
+    pfx_sf_t *self = new (std::nothrow) pfx_sf_t;
+    alloc_assert (self);
+    pfx_init (&self->trie);
+    self->unpacked = 0;
+    return (void*) self;
 }
 
 static void sf_destroy (void *core_, void *sf_)
 {
-    pfx_close ((pfx_node_t*) sf_);
-    free (sf_);
+    pfx_sf_t *self = (pfx_sf_t*) sf_;
+    pfx_close (&self->trie);
+    delete self;
 }
 
 static int sf_subscribe (void *core_, void *sf_,
     const unsigned char *data_, size_t size_)
 {
-    if (pfx_add ((pfx_node_t*) sf_, data_, size_, NULL))
-        return xs_filter_subscribed (core_, data_, size_);
-    return 0;
+    pfx_sf_t *self = (pfx_sf_t*) sf_;
+    if (!pfx_add (&self->trie, data_, size_, NULL))
+        return 0;
+
+    if (size_ > pfx_packed_size)
+        self->unpacked++;
+    else {
+        pfx_sf_t::packed_t packed;
+        memset (packed.data, 0, sizeof packed.data);
+        memcpy (packed.data, data_, size_);
+        packed.size = size_;
+        packed.mask = (1u << size_) - 1;
+        self->packed.push_back (packed);
+    }
+
+    return xs_filter_subscribed (core_, data_, size_);
 }
 
 static int sf_unsubscribe (void *core_, void *sf_,
     const unsigned char *data_, size_t size_)
 {
-    if (pfx_rm ((pfx_node_t*) sf_, data_, size_, NULL))
-        return xs_filter_unsubscribed (core_, data_, size_);
-    return 0;
+    pfx_sf_t *self = (pfx_sf_t*) sf_;
+    if (!pfx_rm (&self->trie, data_, size_, NULL))
+        return 0;
+
+    if (size_ > pfx_packed_size) {
+        if (self->unpacked)
+            self->unpacked--;
+    }
+    else {
+        for (pfx_sf_t::packed_set_t::iterator it = self->packed.begin ();
+              it != self->packed.end (); ++it)
+            if (it->size == size_ && memcmp (it->data, data_, size_) == 0) {
+                *it = self->packed.back ();
+                self->packed.pop_back ();
+                break;
+            }
+    }
+
+    return xs_filter_unsubscribed (core_, data_, size_);
 }
 
-static int sf_match (void *core_, void *sf_,
-    const unsigned char *data_, size_t size_)
+static int pfx_match (pfx_node_t *node_, const unsigned char *data_,
+    size_t size_)
 {
     //  This function is on critical path. It deliberately doesn't use
     //  recursion to get a bit better performance.
-    pfx_node_t *current = (pfx_node_t*) sf_;
+    pfx_node_t *current = node_;
     while (true) {
 
         //  We've found a corresponding subscription!
@@ -595,9 +670,49 @@ static int sf_match (void *core_, void *sf_,
     }
 }
 
+#if defined XS_PFX_SSE2
+
+static int pfx_match_packed (pfx_sf_t *self_, const unsigned char *data_,
+    size_t size_)
+{
+    //  Load the head of the message into a zero-padded register. Bytes past
+    //  the end of the message are never compared as the size check below
+    //  rules out subscriptions longer than the message.
+    unsigned char head [pfx_packed_size];
+    size_t len = size_ < pfx_packed_size ? size_ : pfx_packed_size;
+    memset (head, 0, sizeof head);
+    memcpy (head, data_, len);
+    __m128i msg = _mm_loadu_si128 ((const __m128i*) head);
+
+    for (pfx_sf_t::packed_set_t::const_iterator it = self_->packed.begin ();
+          it != self_->packed.end (); ++it) {
+        if (it->size > size_)
+            continue;
+        __m128i sub = _mm_loadu_si128 ((const __m128i*) it->data);
+        unsigned int eq = (unsigned int)
+            _mm_movemask_epi8 (_mm_cmpeq_epi8 (msg, sub));
+        if ((eq & it->mask) == it->mask)
+            return 1;
+    }
+    return 0;
+}
+
+#endif
+
+static int sf_match (void *core_, void *sf_,
+    const unsigned char *data_, size_t size_)
+{
+    pfx_sf_t *self = (pfx_sf_t*) sf_;
+#if defined XS_PFX_SSE2
+    if (!self->unpacked && self->packed.size () <= pfx_packed_max)
+        return pfx_match_packed (self, data_, size_);
+#endif
+    return pfx_match (&self->trie, data_, size_);
+}
+
 static xs_filter_t pfx_filter = {
     XS_PLUGIN_FILTER,
-    1,
+    2,
     id,
     pf_create,
     pf_destroy,
@@ -609,7 +724,8 @@ static xs_filter_t pfx_filter = {
     sf_destroy,
     sf_subscribe,
     sf_unsubscribe,
-    sf_match
+    sf_match,
+    pf_match_batch
 };
 
 void *xs::prefix_filter = (void*) &pfx_filter;
@@ -58,7 +58,7 @@ int xs::pull_t::xsetsockopt (int option_, const void *optval_,
     }
 
     int version = *(int *) optval_;
-    if (version != 2) {
+    if (version != 2 && version != 4) {
         errno = EINVAL;
         return -1;
     }
@@ -71,6 +71,11 @@ void xs::pull_t::xattach_pipe (pipe_t *pipe_, bool icanhasall_)
 {
     xs_assert (pipe_);
     fq.attach (pipe_);
+
+    //  In version 4 of the pattern the peer sends only the messages it was
+    //  granted the credit for. Grant it the whole window straight away.
+    if (pipe_->get_sp_version () >= 4)
+        reset_credit (pipe_);
 }
 
 void xs::pull_t::xread_activated (pipe_t *pipe_)
@@ -78,6 +83,19 @@ void xs::pull_t::xread_activated (pipe_t *pipe_)
     fq.activated (pipe_);
 }
 
+void xs::pull_t::xwrite_activated (pipe_t *pipe_)
+{
+    //  Credit that haven't fit into the pipe can be sent now.
+    grant (pipe_);
+}
+
+void xs::pull_t::xhiccuped (pipe_t *pipe_)
+{
+    //  The connection was re-established. The credit granted so far was lost
+    //  with the old connection so we have to grant the whole window anew.
+    reset_credit (pipe_);
+}
+
 void xs::pull_t::xterminated (pipe_t *pipe_)
 {
     fq.terminated (pipe_);
@@ -85,7 +103,15 @@ void xs::pull_t::xterminated (pipe_t *pipe_)
 
 int xs::pull_t::xrecv (msg_t *msg_, int flags_)
 {
-    return fq.recv (msg_, flags_);
+    pipe_t *pipe;
+    int rc = fq.recvpipe (msg_, flags_, &pipe);
+    if (rc != 0)
+        return -1;
+
+    if (pipe->get_sp_version () >= 4 && !(msg_->flags () & msg_t::more))
+        grant (pipe);
+
+    return 0;
 }
 
 bool xs::pull_t::xhas_in ()
@@ -93,6 +119,46 @@ bool xs::pull_t::xhas_in ()
     return fq.has_in ();
 }
 
+uint32_t xs::pull_t::credit_window ()
+{
+    //  The window matches the high watermark so that the messages on the fly
+    //  never exceed it. If there's no high watermark the credit is virtually
+    //  unlimited.
+    return options.rcvhwm > 0 ? (uint32_t) options.rcvhwm : 0x7fffffff;
+}
+
+void xs::pull_t::reset_credit (pipe_t *pipe_)
+{
+    //  Adjust the accounting so that exactly one window worth of messages
+    //  is waiting to be granted and send it to the peer.
+    pipe_->add_granted (pipe_->get_ungranted () - credit_window ());
+    grant (pipe_);
+}
+
+void xs::pull_t::grant (pipe_t *pipe_)
+{
+    //  Credit is returned in batches of half the window so that there's
+    //  single credit message per many messages received.
+    uint64_t ungranted = pipe_->get_ungranted ();
+    uint32_t threshold = credit_window () / 2;
+    if (ungranted < (threshold ? threshold : 1))
+        return;
+
+    //  If the credit doesn't fit into the pipe, it will be sent once
+    //  the pipe becomes writable again.
+    msg_t msg;
+    int rc = msg.init_size (4);
+    errno_assert (rc == 0);
+    put_uint32 ((unsigned char*) msg.data (), (uint32_t) ungranted);
+    if (!pipe_->write (&msg)) {
+        rc = msg.close ();
+        errno_assert (rc == 0);
+        return;
+    }
+    pipe_->flush ();
+    pipe_->add_granted (ungranted);
+}
+
 xs::pull_session_t::pull_session_t (io_thread_t *io_thread_, bool connect_,
       socket_base_t *socket_, const options_t &options_,
       const char *protocol_, const char *address_) :
@@ -50,10 +50,24 @@ namespace xs
         int xrecv (xs::msg_t *msg_, int flags_);
         bool xhas_in ();
         void xread_activated (xs::pipe_t *pipe_);
+        void xwrite_activated (xs::pipe_t *pipe_);
+        void xhiccuped (xs::pipe_t *pipe_);
         void xterminated (xs::pipe_t *pipe_);
 
     private:
 
+        //  Number of messages the peers are granted the credit for up front
+        //  in version 4 of the pattern.
+        uint32_t credit_window ();
+
+        //  Grants the peer the credit for the whole window. Used when there's
+        //  a new peer on the other side of the pipe.
+        void reset_credit (xs::pipe_t *pipe_);
+
+        //  Gives the credit for the messages consumed back to the peer once
+        //  there's enough of them.
+        void grant (xs::pipe_t *pipe_);
+
         //  Fair queueing object for inbound pipes.
         fq_t fq;
 
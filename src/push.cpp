@@ -19,6 +19,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
+
 #include "push.hpp"
 #include "pipe.hpp"
 #include "err.hpp"
@@ -42,6 +44,21 @@ xs::push_t::~push_t ()
 int xs::push_t::xsetsockopt (int option_, const void *optval_,
     size_t optvallen_)
 {
+    if (option_ == XS_LB_STRATEGY) {
+        if (optvallen_ != sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (!optval_) {
+            errno = EFAULT;
+            return -1;
+        }
+        int rc = lb.set_strategy (*(int*) optval_);
+        if (rc == 0)
+            options.lb_strategy = *(int*) optval_;
+        return rc;
+    }
+
     if (option_ != XS_PATTERN_VERSION) {
         errno = EINVAL;
         return -1;
@@ -58,7 +75,7 @@ int xs::push_t::xsetsockopt (int option_, const void *optval_,
     }
 
     int version = *(int *) optval_;
-    if (version != 2) {
+    if (version != 2 && version != 4) {
         errno = EINVAL;
         return -1;
     }
@@ -71,6 +88,19 @@ void xs::push_t::xattach_pipe (pipe_t *pipe_, bool icanhasall_)
 {
     xs_assert (pipe_);
     lb.attach (pipe_);
+
+    //  In version 4 of the pattern the messages are sent only when the peer
+    //  have granted the credit for them. The credit may be already waiting
+    //  in the pipe.
+    if (pipe_->get_sp_version () >= 4) {
+        pipe_->enable_credit ();
+        read_credit (pipe_);
+    }
+}
+
+void xs::push_t::xread_activated (pipe_t *pipe_)
+{
+    read_credit (pipe_);
 }
 
 void xs::push_t::xwrite_activated (pipe_t *pipe_)
@@ -83,6 +113,11 @@ void xs::push_t::xterminated (pipe_t *pipe_)
     lb.terminated (pipe_);
 }
 
+uint64_t xs::push_t::xdropped ()
+{
+    return lb.dropped ();
+}
+
 int xs::push_t::xsend (msg_t *msg_, int flags_)
 {
     return lb.send (msg_, flags_);
@@ -93,11 +128,37 @@ bool xs::push_t::xhas_out ()
     return lb.has_out ();
 }
 
+void xs::push_t::read_credit (pipe_t *pipe_)
+{
+    //  Each credit message carries the number of messages the peer is ready
+    //  to accept. When passed through a session, it's prefixed by the number
+    //  of the connection it was granted on and the number of messages
+    //  consumed by the previous connections. Anything else is silently
+    //  dropped.
+    msg_t msg;
+    int rc = msg.init ();
+    errno_assert (rc == 0);
+    while (pipe_->read (&msg)) {
+        if (msg.flags () & msg_t::more)
+            continue;
+        unsigned char *data = (unsigned char*) msg.data ();
+        if (msg.size () == 4)
+            pipe_->add_credit (get_uint32 (data));
+        else if (msg.size () == 16)
+            pipe_->add_credit (get_uint32 (data + 12), get_uint32 (data),
+                get_uint64 (data + 4));
+    }
+    rc = msg.close ();
+    errno_assert (rc == 0);
+}
+
 xs::push_session_t::push_session_t (io_thread_t *io_thread_, bool connect_,
       socket_base_t *socket_, const options_t &options_,
       const char *protocol_, const char *address_) :
     session_base_t (io_thread_, connect_, socket_, options_, protocol_,
-        address_)
+        address_),
+    connection (0),
+    base (0)
 {
 }
 
@@ -105,3 +166,36 @@ xs::push_session_t::~push_session_t ()
 {
 }
 
+int xs::push_session_t::write (msg_t *msg_)
+{
+    //  Prefix the credit by the number of the connection it was granted on.
+    //  That way the socket can tell it from the credit granted on the
+    //  previous connections. The messages still queued when the connection
+    //  was re-established are passed to the new one, thus they count
+    //  against its credit.
+    if (options.sp_version >= 4 && msg_->size () == 4 &&
+          !(msg_->flags () & msg_t::more)) {
+        msg_t tagged;
+        int rc = tagged.init_size (16);
+        errno_assert (rc == 0);
+        unsigned char *data = (unsigned char*) tagged.data ();
+        put_uint32 (data, connection);
+        put_uint64 (data + 4, base);
+        memcpy (data + 12, msg_->data (), 4);
+        rc = msg_->move (tagged);
+        errno_assert (rc == 0);
+    }
+
+    return session_base_t::write (msg_);
+}
+
+void xs::push_session_t::detach ()
+{
+    //  The messages read so far, including the remainder of the message
+    //  being sent, were consumed by the old connection. Credit arriving
+    //  from now on belongs to the next one.
+    session_base_t::detach ();
+    connection++;
+    base = get_msgs_read ();
+}
+
@@ -49,11 +49,16 @@ namespace xs
         void xattach_pipe (xs::pipe_t *pipe_, bool icanhasall_);
         int xsend (xs::msg_t *msg_, int flags_);
         bool xhas_out ();
+        void xread_activated (xs::pipe_t *pipe_);
         void xwrite_activated (xs::pipe_t *pipe_);
         void xterminated (xs::pipe_t *pipe_);
+        uint64_t xdropped ();
 
     private:
 
+        //  Reads the credit granted by the peer from the pipe.
+        void read_credit (xs::pipe_t *pipe_);
+
         //  Load balancer managing the outbound pipes.
         lb_t lb;
 
@@ -70,8 +75,18 @@ namespace xs
             const char *protocol_, const char *address_);
         ~push_session_t ();
 
+        //  Overloads of the functions from session_base_t.
+        int write (msg_t *msg_);
+        void detach ();
+
     private:
 
+        //  Number of times the connection to the peer was re-established
+        //  and the number of messages consumed by the old connections.
+        //  Credit received from the network is tagged with both.
+        uint32_t connection;
+        uint64_t base;
+
         push_session_t (const push_session_t&);
         const push_session_t &operator = (const push_session_t&);
     };
@@ -20,6 +20,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
 #include "req.hpp"
 #include "err.hpp"
 #include "msg.hpp"
@@ -29,8 +31,8 @@
 
 xs::req_t::req_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
     xreq_t (parent_, tid_, sid_),
-    receiving_reply (false),
     message_begins (true),
+    reply_begins (true),
     request_id (generate_random ())
 {
     options.type = XS_REQ;
@@ -38,15 +40,55 @@ xs::req_t::req_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
 
 xs::req_t::~req_t ()
 {
+    for (replies_t::iterator it = replies.begin (); it != replies.end (); ++it)
+        for (size_t i = 0; i != it->second.size (); i++) {
+            int rc = it->second [i].close ();
+            errno_assert (rc == 0);
+        }
+    for (size_t i = 0; i != ready.size (); i++) {
+        int rc = ready [i].close ();
+        errno_assert (rc == 0);
+    }
+}
+
+int xs::req_t::xsetsockopt (int option_, const void *optval_,
+    size_t optvallen_)
+{
+    if (option_ != XS_REQ_OUTSTANDING)
+        return xreq_t::xsetsockopt (option_, optval_, optvallen_);
+
+    if (optvallen_ != sizeof (int)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (!optval_) {
+        errno = EFAULT;
+        return -1;
+    }
+
+    int val = *(int*) optval_;
+    if (val < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    options.req_outstanding = val;
+    return 0;
+}
+
+size_t xs::req_t::max_outstanding ()
+{
+    return options.sp_version >= 3 ? (size_t) options.req_outstanding : 1;
 }
 
 int xs::req_t::xsend (msg_t *msg_, int flags_)
 {
     int rc;
 
-    //  If we've sent a request and we still haven't got the reply,
+    //  If there are too many requests without the reply,
     //  we can't send another request.
-    if (receiving_reply) {
+    if (outstanding.size () >= max_outstanding ()) {
         errno = EFSM;
         return -1;
     }
@@ -85,9 +127,10 @@ int xs::req_t::xsend (msg_t *msg_, int flags_)
     if (rc != 0)
         return rc;
 
-    //  If the request was fully sent, flip the FSM into reply-receiving state.
+    //  If the request was fully sent, start waiting for the reply.
     if (!more) {
-        receiving_reply = true;
+        outstanding.push_back (request_id);
+        ++request_id;
         message_begins = true;
     }
 
@@ -98,24 +141,38 @@ int xs::req_t::xrecv (msg_t *msg_, int flags_)
 {
     int rc;
 
+    //  Replies that arrived out of order are passed to the user first.
+    if (!ready.empty ()) {
+        rc = msg_->move (ready.front ());
+        errno_assert (rc == 0);
+        ready.pop_front ();
+        return 0;
+    }
+
     //  If request wasn't send, we can't wait for reply.
-    if (!receiving_reply) {
+    if (reply_begins && outstanding.empty ()) {
         errno = EFSM;
         return -1;
     }
 
     //  First part of the reply should be the original request ID,
     //  then delimiter.
-    if (message_begins) {
+    if (reply_begins) {
+        uint32_t id = outstanding.front ();
 retry:
         rc = xreq_t::xrecv (msg_, flags_);
         if (rc != 0)
             return rc;
 
         if (options.sp_version >= 3) {
-            if (unlikely (!(msg_->flags () & msg_t::more) ||
-                  msg_->size () != 4 ||
-                  get_uint32 ((unsigned char*) msg_->data ()) != request_id)) {
+            bool valid = (msg_->flags () & msg_t::more) && msg_->size () == 4;
+            if (likely (valid)) {
+                id = get_uint32 ((unsigned char*) msg_->data ());
+                valid = std::find (outstanding.begin (), outstanding.end (),
+                    id) != outstanding.end () && replies.find (id) ==
+                    replies.end ();
+            }
+            if (unlikely (!valid)) {
                 while (true) {
                     rc = xreq_t::xrecv (msg_, flags_);
                     errno_assert (rc == 0);
@@ -126,7 +183,6 @@ retry:
                 msg_->init ();
                 goto retry;
             }
-            ++request_id;
             rc = xreq_t::xrecv (msg_, flags_);
             errno_assert (rc == 0);
         }
@@ -143,27 +199,62 @@ retry:
             goto retry;
         }
 
-        message_begins = false;
+        //  The reply to a later request has arrived first. Store it until
+        //  the replies to all the preceding requests are passed to the user.
+        if (id != outstanding.front ()) {
+            std::vector <msg_t> &parts = replies [id];
+            while (true) {
+                msg_t part;
+                rc = part.init ();
+                errno_assert (rc == 0);
+                rc = xreq_t::xrecv (&part, flags_);
+                errno_assert (rc == 0);
+                parts.push_back (part);
+                if (!(part.flags () & msg_t::more))
+                    break;
+            }
+            msg_->close ();
+            msg_->init ();
+            goto retry;
+        }
+
+        reply_begins = false;
     }
 
     rc = xreq_t::xrecv (msg_, flags_);
     if (rc != 0)
         return rc;
 
-    //  If the reply is fully received, flip the FSM into request-sending state.
+    //  If the reply is fully received, the request is done.
     if (!(msg_->flags () & msg_t::more)) {
-        receiving_reply = false;
-        message_begins = true;
+        outstanding.pop_front ();
+        reply_begins = true;
+        promote_replies ();
     }
 
     return 0;
 }
 
+void xs::req_t::promote_replies ()
+{
+    while (!outstanding.empty ()) {
+        replies_t::iterator it = replies.find (outstanding.front ());
+        if (it == replies.end ())
+            break;
+        ready.insert (ready.end (), it->second.begin (), it->second.end ());
+        replies.erase (it);
+        outstanding.pop_front ();
+    }
+}
+
 bool xs::req_t::xhas_in ()
 {
     //  TODO: Duplicates should be removed here.
 
-    if (!receiving_reply)
+    if (!ready.empty ())
+        return true;
+
+    if (reply_begins && outstanding.empty ())
         return false;
 
     return xreq_t::xhas_in ();
@@ -171,7 +262,7 @@ bool xs::req_t::xhas_in ()
 
 bool xs::req_t::xhas_out ()
 {
-    if (receiving_reply)
+    if (outstanding.size () >= max_outstanding ())
         return false;
 
     return xreq_t::xhas_out ();
@@ -193,6 +284,11 @@ xs::req_session_t::~req_session_t ()
 
 int xs::req_session_t::write (msg_t *msg_)
 {
+    //  In version 4 of the pattern the envelope is packed into the body
+    //  and it's up to the socket to check it.
+    if (options.sp_version >= 4 && state != identity)
+        return xreq_session_t::write (msg_);
+
     switch (state) {
     case reqid:
         if (msg_->flags () == msg_t::more && msg_->size () == 4) {
@@ -210,7 +306,7 @@ int xs::req_session_t::write (msg_t *msg_)
         if (msg_->flags () == msg_t::more)
             return xreq_session_t::write (msg_);
         if (msg_->flags () == 0) {
-            state = bottom;
+            state = options.sp_version >= 3 ? reqid : bottom;
             return xreq_session_t::write (msg_);
         }
         break;
@@ -23,8 +23,13 @@
 #ifndef __XS_REQ_HPP_INCLUDED__
 #define __XS_REQ_HPP_INCLUDED__
 
+#include <map>
+#include <deque>
+#include <vector>
+
 #include "xreq.hpp"
 #include "stdint.hpp"
+#include "msg.hpp"
 
 namespace xs
 {
@@ -42,6 +47,7 @@ namespace xs
         ~req_t ();
 
         //  Overloads of functions from socket_base_t.
+        int xsetsockopt (int option_, const void *optval_, size_t optvallen_);
         int xsend (xs::msg_t *msg_, int flags_);
         int xrecv (xs::msg_t *msg_, int flags_);
         bool xhas_in ();
@@ -49,17 +55,37 @@ namespace xs
 
     private:
 
-        //  If true, request was already sent and reply wasn't received yet or
-        //  was raceived partially.
-        bool receiving_reply;
+        //  Maximal number of requests in flight. Without request IDs on the
+        //  wire replies can't be told apart so only one request is allowed.
+        size_t max_outstanding ();
+
+        //  Moves the buffered replies that are next in line to 'ready'.
+        void promote_replies ();
 
-        //  If true, we are starting to send/recv a message. The first part
+        //  If true, we are starting to send a message. The first part
         //  of the message must be empty message part (backtrace stack bottom).
         bool message_begins;
 
-        //  ID of the ongoing request.
+        //  If true, we are starting to receive a reply. False if the reply
+        //  was received partially.
+        bool reply_begins;
+
+        //  ID of the next request to send.
         uint32_t request_id;
 
+        //  IDs of the requests sent whose replies weren't received yet,
+        //  in the order the requests were sent.
+        typedef std::deque <uint32_t> outstanding_t;
+        outstanding_t outstanding;
+
+        //  Replies that arrived ahead of the replies to earlier requests.
+        //  They are stored as lists of body parts indexed by request ID.
+        typedef std::map <uint32_t, std::vector <msg_t> > replies_t;
+        replies_t replies;
+
+        //  Body parts of the replies that are next to be passed to the user.
+        std::deque <msg_t> ready;
+
         req_t (const req_t&);
         const req_t &operator = (const req_t&);
     };
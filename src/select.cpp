@@ -172,20 +172,21 @@ void xs::select_t::loop ()
         //  in checking the pollset.
         if (rc == 0)
             continue;
+        woken_up (rc);
 
         for (fd_set_t::size_type i = 0; i < fds.size (); i ++) {
             if (fds [i].fd == retired_fd)
                 continue;
             if (FD_ISSET (fds [i].fd, &exceptfds))
-                fds [i].events->in_event (fds [i].fd);
+                dispatch_in_event (fds [i].events, fds [i].fd);
             if (fds [i].fd == retired_fd)
                 continue;
             if (FD_ISSET (fds [i].fd, &writefds))
-                fds [i].events->out_event (fds [i].fd);
+                dispatch_out_event (fds [i].events, fds [i].fd);
             if (fds [i].fd == retired_fd)
                 continue;
             if (FD_ISSET (fds [i].fd, &readfds))
-                fds [i].events->in_event (fds [i].fd);
+                dispatch_in_event (fds [i].events, fds [i].fd);
         }
 
         //  Destroy retired event sources.
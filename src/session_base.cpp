@@ -25,7 +25,9 @@
 #include "i_engine.hpp"
 #include "err.hpp"
 #include "pipe.hpp"
+#include "trace.hpp"
 #include "likely.hpp"
+#include "clock.hpp"
 #include "tcp_connecter.hpp"
 #include "ipc_connecter.hpp"
 #include "pgm_sender.hpp"
@@ -132,6 +134,8 @@ xs::session_base_t::session_base_t (class io_thread_t *io_thread_,
     pending (false),
     engine (NULL),
     socket (socket_),
+    in_stamp (0),
+    out_stamp (0),
     io_thread (io_thread_),
     send_identity (options_.send_identity),
     identity_sent (false),
@@ -187,6 +191,14 @@ int xs::session_base_t::read (msg_t *msg_)
     }
     incomplete_in = msg_->flags () & msg_t::more ? true : false;
 
+    //  Account for the time the message spent in the outbound pipe.
+    if (unlikely (options.latency) && msg_->is_stamped ()) {
+        uint64_t now = clock_t::now_ns ();
+        latency.record (XS_HOP_OUT_PIPE, now - msg_->last_stamp ());
+        if (!out_stamp)
+            out_stamp = now;
+    }
+
     return 0;
 }
 
@@ -198,6 +210,16 @@ int xs::session_base_t::write (msg_t *msg_)
         identity_recvd = true;
     }
 
+    //  Account for the time needed to decode the message. If the message
+    //  is already stamped, this is a retry after the pipe was full. Messages
+    //  that can't be stamped are not sampled.
+    if (unlikely (options.latency) && !msg_->is_stamped ()) {
+        uint64_t now = clock_t::now_ns ();
+        uint64_t arrived = in_stamp ? in_stamp : now;
+        if (msg_->stamp (arrived, now))
+            latency.record (XS_HOP_IN_DECODER, now - arrived);
+    }
+
     if (pipe && pipe->write (msg_)) {
         int rc = msg_->init ();
         errno_assert (rc == 0);
@@ -210,10 +232,36 @@ int xs::session_base_t::write (msg_t *msg_)
 
 void xs::session_base_t::flush ()
 {
+    //  Pass the samples to the socket before the messages become visible
+    //  to it, so that the statistics are never behind the messages received.
+    if (unlikely (options.latency) && !latency.empty ())
+        socket->merge_latency (latency);
+
     if (pipe)
         pipe->flush ();
 }
 
+void xs::session_base_t::data_received ()
+{
+    if (options.latency)
+        in_stamp = clock_t::now_ns ();
+}
+
+void xs::session_base_t::data_sent ()
+{
+    //  Account for the time the oldest message spent in the encoder and
+    //  the engine's buffer.
+    if (options.latency && out_stamp) {
+        latency.record (XS_HOP_OUT_ENGINE, clock_t::now_ns () - out_stamp);
+        out_stamp = 0;
+    }
+
+    //  Samples are passed to the socket in batches to avoid locking it
+    //  for each message.
+    if (options.latency && !latency.empty ())
+        socket->merge_latency (latency);
+}
+
 void xs::session_base_t::clean_pipes ()
 {
     if (pipe) {
@@ -223,21 +271,38 @@ void xs::session_base_t::clean_pipes ()
         pipe->rollback ();
         pipe->flush ();
 
-        //  Remove any half-read message from the in pipe.
+        //  Remove any half-read message from the in pipe. The pipe is read
+        //  directly, bypassing the overloads of read in derived sessions
+        //  as well as sending of the identity.
         while (incomplete_in) {
             msg_t msg;
             int rc = msg.init ();
             errno_assert (rc == 0);
-            if (!read (&msg)) {
-                xs_assert (!incomplete_in);
+            if (!pipe->read (&msg)) {
+                incomplete_in = false;
                 break;
             }
+            incomplete_in = msg.flags () & msg_t::more ? true : false;
             rc = msg.close ();
             errno_assert (rc == 0);
         }
     }
 }
 
+void xs::session_base_t::reset_incomplete_in ()
+{
+    incomplete_in = false;
+}
+
+uint64_t xs::session_base_t::get_msgs_read ()
+{
+    if (!pipe)
+        return 0;
+    xs_pipe_stats_t stats;
+    pipe->get_stats (&stats);
+    return stats.msgs_in;
+}
+
 void xs::session_base_t::terminated (pipe_t *pipe_)
 {
     //  Drop the reference to the deallocated pipe.
@@ -297,12 +362,20 @@ void xs::session_base_t::process_attach (i_engine *engine_)
         object_t *parents [2] = {this, socket};
         pipe_t *pipes [2] = {NULL, NULL};
         int hwms [2] = {options.rcvhwm, options.sndhwm};
+        uint64_t byte_hwms [2] = {options.rcvhwm_bytes, options.sndhwm_bytes};
         bool delays [2] = {options.delay_on_close, options.delay_on_disconnect};
-        int rc = pipepair (parents, pipes, hwms, delays, options.sp_version);
+        int rc = pipepair (parents, pipes, hwms, byte_hwms, delays,
+            options.pipe_ring, options.sp_version);
         errno_assert (rc == 0);
 
         //  Plug the local end of the pipe.
         pipes [0]->set_event_sink (this);
+        pipes [1]->set_priority (options.rcvpriority);
+
+        //  If required, the session matches the messages against
+        //  the subscriptions, so the socket can pass it all the messages.
+        if (options.filter_offload && options.sp_version != 1)
+            pipes [1]->set_filter_offload ();
 
         //  Remember the local end of the pipe.
         xs_assert (!pipe);
@@ -401,11 +474,15 @@ void xs::session_base_t::detached ()
     }
 
     //  Reconnect.
+    XS_TRACE (reconnect, this, 0);
+    socket->reconnecting ();
     start_connecting (true);
 
     //  For subscriber sockets we hiccup the inbound pipe, which will cause
-    //  the socket object to resend all the subscriptions.
-    if (pipe && (options.type == XS_SUB || options.type == XS_XSUB))
+    //  the socket object to resend all the subscriptions. Same way, PULL
+    //  socket using credit-based flow control re-grants the credit.
+    if (pipe && (options.type == XS_SUB || options.type == XS_XSUB ||
+          (options.type == XS_PULL && options.sp_version >= 4)))
         pipe->hiccup ();  
 }
 
@@ -28,6 +28,8 @@
 #include "own.hpp"
 #include "io_object.hpp"
 #include "pipe.hpp"
+#include "stdint.hpp"
+#include "latency.hpp"
 
 namespace xs
 {
@@ -61,6 +63,12 @@ namespace xs
         virtual void flush ();
         virtual void detach ();
 
+        //  Used by the engine to report that data have arrived from the
+        //  network and that all the data fetched from the session so far
+        //  were passed to the network. Needed for latency accounting.
+        void data_received ();
+        void data_sent ();
+
         //  i_pipe_events interface implementation.
         void read_activated (xs::pipe_t *pipe_);
         void write_activated (xs::pipe_t *pipe_);
@@ -74,6 +82,16 @@ namespace xs
             const char *protocol_, const char *address_);
         ~session_base_t ();
 
+        //  Sessions reading messages from the pipe in advance use this to
+        //  keep the remainder of the last message read in the pipe when
+        //  the engine is detached, as it is not the message the engine
+        //  was in the middle of.
+        void reset_incomplete_in ();
+
+        //  Returns the number of messages read from the socket so far,
+        //  including those dropped when an engine was detached.
+        uint64_t get_msgs_read ();
+
     private:
 
         void start_connecting (bool wait_);
@@ -116,6 +134,15 @@ namespace xs
         //  The socket the session belongs to.
         xs::socket_base_t *socket;
 
+        //  Time the data last arrived from the network and time the oldest
+        //  message not yet passed to the network was read from the pipe.
+        //  Zero if unknown. Used only if XS_LATENCY option is set.
+        uint64_t in_stamp;
+        uint64_t out_stamp;
+
+        //  Latency samples not yet passed to the socket.
+        latency_t latency;
+
         //  I/O thread the session is living in. It will be used to plug in
         //  the engines into the same thread.
         xs::io_thread_t *io_thread;
@@ -0,0 +1,140 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __XS_SLOT_TABLE_HPP_INCLUDED__
+#define __XS_SLOT_TABLE_HPP_INCLUDED__
+
+#include <stddef.h>
+#include <vector>
+#include <deque>
+
+#include "stdint.hpp"
+#include "random.hpp"
+#include "wire.hpp"
+#include "likely.hpp"
+#include "err.hpp"
+
+namespace xs
+{
+
+    //  Table of peers addressed by identities generated by the table itself.
+    //  Identity consists of the index of the slot the item is stored in and
+    //  the generation of the slot. Thus, routing a message to the peer is
+    //  an array lookup followed by generation check. No hashing, no
+    //  allocation. Generation is incremented each time the slot is freed so
+    //  that identities of the peers that have already disconnected never
+    //  match the peers that were assigned the same slot later on.
+
+    template <typename T> class slot_table_t
+    {
+    public:
+
+        //  Size of the identity in bytes.
+        enum {id_size = 8};
+
+        inline slot_table_t () :
+            count (0)
+        {
+        }
+
+        inline ~slot_table_t ()
+        {
+        }
+
+        //  Stores the item in the table and writes its identity into the
+        //  buffer. The buffer must be at least id_size bytes long.
+        inline void insert (const T &item_, unsigned char *id_)
+        {
+            uint32_t index;
+            if (unused.empty ()) {
+                index = (uint32_t) slots.size ();
+                slot_t slot = {item_, generate_random (), true};
+                slots.push_back (slot);
+            }
+            else {
+                index = unused.front ();
+                unused.pop_front ();
+                slots [index].item = item_;
+                slots [index].used = true;
+            }
+            ++count;
+            put_uint32 (id_, index);
+            put_uint32 (id_ + 4, slots [index].generation);
+        }
+
+        //  Returns the item with the specified identity or NULL if there's
+        //  no such item. The pointer is valid only till the next insert.
+        inline T *find (unsigned char *id_)
+        {
+            uint32_t index = get_uint32 (id_);
+            if (unlikely (index >= slots.size ()))
+                return NULL;
+            slot_t &slot = slots [index];
+            if (unlikely (!slot.used ||
+                  slot.generation != get_uint32 (id_ + 4)))
+                return NULL;
+            return &slot.item;
+        }
+
+        //  Removes the item with the specified identity from the table.
+        //  The item must be present in the table.
+        inline void erase (unsigned char *id_)
+        {
+            xs_assert (find (id_));
+            uint32_t index = get_uint32 (id_);
+            slots [index].used = false;
+            ++slots [index].generation;
+            --count;
+
+            //  Freed slots are reused in FIFO order so that the particular
+            //  slot is reused as late as possible.
+            unused.push_back (index);
+        }
+
+        inline bool empty ()
+        {
+            return count == 0;
+        }
+
+    private:
+
+        struct slot_t
+        {
+            T item;
+            uint32_t generation;
+            bool used;
+        };
+
+        //  The slots, both used and unused ones.
+        std::vector <slot_t> slots;
+
+        //  Indices of the unused slots.
+        std::deque <uint32_t> unused;
+
+        //  Number of items in the table.
+        size_t count;
+
+        slot_table_t (const slot_table_t&);
+        const slot_table_t &operator = (const slot_table_t&);
+    };
+
+}
+
+#endif
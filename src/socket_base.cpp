@@ -144,7 +144,11 @@ xs::socket_base_t::socket_base_t (ctx_t *parent_, uint32_t tid_, int sid_) :
     initialised (false),
     last_tsc (0),
     ticks (0),
-    rcvmore (false)
+    rcvmore (false),
+    msgs_sent (0),
+    bytes_sent (0),
+    msgs_received (0),
+    bytes_received (0)
 {
     options.socket_id = sid_;
 }
@@ -309,6 +313,15 @@ int xs::socket_base_t::getsockopt (int option_, void *optval_,
         return 0;
     }
 
+    if (option_ == XS_STATS)
+        return get_stats (optval_, optvallen_);
+
+    if (option_ == XS_PIPE_STATS)
+        return get_pipe_stats (optval_, optvallen_);
+
+    if (option_ == XS_LATENCY_STATS)
+        return get_latency_stats (optval_, optvallen_);
+
     if (option_ == XS_EVENTS) {
         if (*optvallen_ < sizeof (int)) {
             errno = EINVAL;
@@ -446,13 +459,30 @@ int xs::socket_base_t::connect (const char *addr_)
         else
             rcvhwm = options.rcvhwm + peer.options.sndhwm;
 
+        //  Same applies to the HWMs in bytes.
+        uint64_t sndhwm_bytes;
+        uint64_t rcvhwm_bytes;
+        if (options.sndhwm_bytes == 0 || peer.options.rcvhwm_bytes == 0)
+            sndhwm_bytes = 0;
+        else
+            sndhwm_bytes = options.sndhwm_bytes + peer.options.rcvhwm_bytes;
+        if (options.rcvhwm_bytes == 0 || peer.options.sndhwm_bytes == 0)
+            rcvhwm_bytes = 0;
+        else
+            rcvhwm_bytes = options.rcvhwm_bytes + peer.options.sndhwm_bytes;
+
         //  Create a bi-directional pipe to connect the peers.
         object_t *parents [2] = {this, peer.socket};
         pipe_t *ppair [2] = {NULL, NULL};
         int hwms [2] = {sndhwm, rcvhwm};
+        uint64_t byte_hwms [2] = {sndhwm_bytes, rcvhwm_bytes};
         bool delays [2] = {options.delay_on_disconnect, options.delay_on_close};
-        rc = pipepair (parents, ppair, hwms, delays, options.sp_version);
+        bool ring = options.pipe_ring || peer.options.pipe_ring;
+        rc = pipepair (parents, ppair, hwms, byte_hwms, delays, ring,
+            options.sp_version);
         errno_assert (rc == 0);
+        ppair [0]->set_priority (options.rcvpriority);
+        ppair [1]->set_priority (peer.options.rcvpriority);
 
         //  Attach local end of the pipe to this socket object.
         attach_pipe (ppair [0]);
@@ -534,9 +564,12 @@ int xs::socket_base_t::connect (const char *addr_)
     object_t *parents [2] = {this, session};
     pipe_t *ppair [2] = {NULL, NULL};
     int hwms [2] = {options.sndhwm, options.rcvhwm};
+    uint64_t byte_hwms [2] = {options.sndhwm_bytes, options.rcvhwm_bytes};
     bool delays [2] = {options.delay_on_disconnect, options.delay_on_close};
-    rc = pipepair (parents, ppair, hwms, delays, options.sp_version);
+    rc = pipepair (parents, ppair, hwms, byte_hwms, delays, options.pipe_ring,
+        options.sp_version);
     errno_assert (rc == 0);
+    ppair [0]->set_priority (options.rcvpriority);
 
     // PGM does not support subscription forwarding; ask for all data to be
     // sent to this pipe.
@@ -544,6 +577,11 @@ int xs::socket_base_t::connect (const char *addr_)
     if (protocol == "pgm" || protocol == "epgm")
         icanhasall = true;
 
+    //  If required, let the session match the messages against
+    //  the subscriptions in its I/O thread.
+    if (options.filter_offload && !icanhasall && options.sp_version != 1)
+        ppair [0]->set_filter_offload ();
+
     //  Attach local end of the pipe to the socket object.
     attach_pipe (ppair [0], icanhasall);
 
@@ -600,17 +638,32 @@ int xs::socket_base_t::send (msg_t *msg_, int flags_)
     if (unlikely (rc != 0))
         return -1;
 
-    //  Clear any user-visible flags that are set on the message.
-    msg_->reset_flags (msg_t::more);
+    //  Clear any user-visible flags that are set on the message. Stamps of
+    //  a message that is being forwarded, e.g. by a device, are stale, so
+    //  drop them as well. If required, the message is stamped anew below.
+    msg_->reset_flags (msg_t::more | msg_t::stamped);
 
     //  At this point we impose the flags on the message.
     if (flags_ & XS_SNDMORE)
         msg_->set_flags (msg_t::more);
 
+    //  Mark the time the message entered the pipeline.
+    if (unlikely (options.latency)) {
+        uint64_t now = clock_t::now_ns ();
+        msg_->stamp (now, now);
+    }
+
+    //  Remember the size of the message as it is consumed by xsend.
+    size_t size = msg_->size ();
+
     //  Try to send the message.
     rc = xsend (msg_, flags_);
-    if (rc == 0)
+    if (rc == 0) {
+        bytes_sent += size;
+        if (!(flags_ & XS_SNDMORE))
+            msgs_sent++;
         return 0;
+    }
     if (unlikely (errno != EAGAIN))
         return -1;
 
@@ -624,7 +677,13 @@ int xs::socket_base_t::send (msg_t *msg_, int flags_)
         rc = process_commands (0, false);
         if (unlikely (rc != 0))
             return -1;
-        return xsend (msg_, flags_);
+        rc = xsend (msg_, flags_);
+        if (rc != 0)
+            return -1;
+        bytes_sent += size;
+        if (!(flags_ & XS_SNDMORE))
+            msgs_sent++;
+        return 0;
     }
 
     //  Compute the time when the timeout should occur.
@@ -651,6 +710,9 @@ int xs::socket_base_t::send (msg_t *msg_, int flags_)
         }
     }
 
+    bytes_sent += size;
+    if (!(flags_ & XS_SNDMORE))
+        msgs_sent++;
     return 0;
 }
 
@@ -719,7 +781,19 @@ int xs::socket_base_t::recv (msg_t *msg_, int flags_)
     //  we are able to fetch a message.
     bool block = (ticks != 0);
     while (true) {
-        if (unlikely (process_commands (block ? timeout : 0, false) != 0))
+
+        //  If the socket has a deadline of its own, make sure that we wake up
+        //  exactly when it expires.
+        int wait = block ? timeout : 0;
+        uint64_t deadline = rcvdeadline ();
+        if (deadline && wait != 0) {
+            uint64_t now = clock.now_ms ();
+            int left = now >= deadline ? 0 : (int) (deadline - now);
+            if (wait < 0 || left < wait)
+                wait = left;
+        }
+
+        if (unlikely (process_commands (wait, false) != 0))
             return -1;
         rc = xrecv (msg_, flags_);
         if (rc == 0) {
@@ -728,6 +802,13 @@ int xs::socket_base_t::recv (msg_t *msg_, int flags_)
         }
         if (unlikely (errno != EAGAIN))
             return -1;
+
+        //  The deadline have expired, yet the socket have nothing to report.
+        if (deadline && clock.now_ms () >= deadline) {
+            errno = EAGAIN;
+            return -1;
+        }
+
         block = true;
         if (timeout > 0) {
             timeout = (int) (end - clock.now_ms ());
@@ -998,6 +1079,78 @@ void xs::socket_base_t::extract_flags (msg_t *msg_)
   
     //  Remove MORE flag.
     rcvmore = msg_->flags () & msg_t::more ? true : false;
+
+    //  Account for the time the message spent in the inbound pipe and
+    //  in the pipeline as a whole.
+    if (unlikely (options.latency) && msg_->is_stamped ()) {
+        uint64_t now = clock_t::now_ns ();
+        latency.record (XS_HOP_IN_PIPE, now - msg_->last_stamp ());
+        latency.record (XS_HOP_TOTAL, now - msg_->origin_stamp ());
+    }
+
+    bytes_received += msg_->size ();
+    if (!rcvmore)
+        msgs_received++;
+}
+
+int xs::socket_base_t::get_stats (void *optval_, size_t *optvallen_)
+{
+    if (*optvallen_ < sizeof (xs_stats_t)) {
+        errno = EINVAL;
+        return -1;
+    }
+    xs_stats_t *stats = (xs_stats_t*) optval_;
+    stats->msgs_sent = msgs_sent;
+    stats->bytes_sent = bytes_sent;
+    stats->msgs_received = msgs_received;
+    stats->bytes_received = bytes_received;
+    stats->msgs_dropped = xdropped ();
+    stats->reconnects = reconnects.get ();
+    stats->pipes = (int) pipes.size ();
+    *optvallen_ = sizeof (xs_stats_t);
+    return 0;
+}
+
+int xs::socket_base_t::get_pipe_stats (void *optval_, size_t *optvallen_)
+{
+    //  Fill in as many pipes as fit into the supplied buffer. The number
+    //  of pipes can be obtained beforehand using XS_STATS option.
+    size_t count = std::min ((size_t) pipes.size (),
+        *optvallen_ / sizeof (xs_pipe_stats_t));
+    xs_pipe_stats_t *stats = (xs_pipe_stats_t*) optval_;
+    for (size_t i = 0; i != count; i++)
+        pipes [i]->get_stats (&stats [i]);
+    *optvallen_ = count * sizeof (xs_pipe_stats_t);
+    return 0;
+}
+
+int xs::socket_base_t::get_latency_stats (void *optval_, size_t *optvallen_)
+{
+    if (*optvallen_ < XS_HOPS * sizeof (xs_latency_stats_t)) {
+        errno = EINVAL;
+        return -1;
+    }
+    latency_t total;
+    latency_sync.lock ();
+    total.add (io_latency);
+    latency_sync.unlock ();
+    total.add (latency);
+    total.get ((xs_latency_stats_t*) optval_);
+    *optvallen_ = XS_HOPS * sizeof (xs_latency_stats_t);
+    return 0;
+}
+
+void xs::socket_base_t::reconnecting ()
+{
+    reconnects.add (1);
+}
+
+void xs::socket_base_t::merge_latency (latency_t &latency_)
+{
+    latency_sync.lock ();
+    io_latency.add (latency_);
+    latency_sync.unlock ();
+    latency_.reset ();
 }
 
 int xs::socket_base_t::rcvtimeo ()
@@ -1010,6 +1163,16 @@ int xs::socket_base_t::sndtimeo ()
     return options.sndtimeo;
 }
 
+uint64_t xs::socket_base_t::rcvdeadline ()
+{
+    return 0;
+}
+
+uint64_t xs::socket_base_t::xdropped ()
+{
+    return 0;
+}
+
 uint64_t xs::socket_base_t::now_ms ()
 {
     return clock.now_ms ();
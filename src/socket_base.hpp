@@ -35,6 +35,8 @@
 #include "stdint.hpp"
 #include "clock.hpp"
 #include "pipe.hpp"
+#include "latency.hpp"
+#include "mutex.hpp"
 
 namespace xs
 {
@@ -67,6 +69,16 @@ namespace xs
         //  This function can be called from a different thread!
         void stop ();
 
+        //  Used by the sessions to report that the connection was lost
+        //  and is being re-established. This function can be called from
+        //  a different thread!
+        void reconnecting ();
+
+        //  Used by the sessions to pass the latency samples they've
+        //  collected to the socket. 'latency_' is reset afterwards. This
+        //  function can be called from a different thread!
+        void merge_latency (latency_t &latency_);
+
         //  Interface for communication with the API layer.
         int setsockopt (int option_, const void *optval_, size_t optvallen_);
         int getsockopt (int option_, void *optval_, size_t *optvallen_);
@@ -126,6 +138,17 @@ namespace xs
         virtual int rcvtimeo ();
         virtual int sndtimeo ();
 
+        //  Allow derived classes to impose a deadline on blocking recv.
+        //  The value is an absolute time as returned by now_ms (), 0 means
+        //  there's no deadline. Blocking recv wakes up at the deadline and
+        //  tries xrecv once more so that the socket can report the reason.
+        virtual uint64_t rcvdeadline ();
+
+        //  Returns the number of messages dropped by the socket, e.g. because
+        //  of reaching the high watermark. The default implementation assumes
+        //  that no messages are dropped.
+        virtual uint64_t xdropped ();
+
         //  i_pipe_events will be forwarded to these functions.
         virtual void xread_activated (pipe_t *pipe_);
         virtual void xwrite_activated (pipe_t *pipe_);
@@ -150,9 +173,15 @@ namespace xs
         void check_destroy ();
 
         //  Moves the flags from the message to local variables,
-        //  to be later retrieved by getsockopt.
+        //  to be later retrieved by getsockopt. Accounts for the received
+        //  message in the statistics.
         void extract_flags (msg_t *msg_);
 
+        //  Fills in the statistics of the socket and of its pipes.
+        int get_stats (void *optval_, size_t *optvallen_);
+        int get_pipe_stats (void *optval_, size_t *optvallen_);
+        int get_latency_stats (void *optval_, size_t *optvallen_);
+
         //  Creates new endpoint ID and adds the endpoint to the map.
         int add_endpoint (own_t *endpoint_);
 
@@ -214,6 +243,25 @@ namespace xs
         //  Improves efficiency of time measurement.
         clock_t clock;
 
+        //  Number of messages and bytes passed through the socket. Updated
+        //  by the application thread only.
+        uint64_t msgs_sent;
+        uint64_t bytes_sent;
+        uint64_t msgs_received;
+        uint64_t bytes_received;
+
+        //  Number of times the connections of this socket were lost and
+        //  re-established. Updated from the I/O threads.
+        atomic_counter_t reconnects;
+
+        //  Dwell times of the messages at individual hops of the pipeline.
+        //  Collected only if XS_LATENCY option is set. The former is updated
+        //  by the application thread only, the latter holds the samples
+        //  passed from the sessions and is guarded by latency_sync.
+        latency_t latency;
+        latency_t io_latency;
+        mutex_t latency_sync;
+
         //   Map of open endpoints.
         typedef std::map <int, own_t*> endpoints_t;
         endpoints_t endpoints;
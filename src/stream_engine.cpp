@@ -39,6 +39,7 @@
 #include "io_thread.hpp"
 #include "session_base.hpp"
 #include "config.hpp"
+#include "trace.hpp"
 #include "err.hpp"
 #include "ip.hpp"
 
@@ -173,6 +174,7 @@ void xs::stream_engine_t::in_event (fd_t fd_)
 
         //  Read remaining header bytes.
         int hbytes = read (header_pos, header_remaining);
+        XS_TRACE (engine_read, this, hbytes);
 
         //  Check whether the peer has closed the connection.
         if (hbytes == -1) {
@@ -206,12 +208,15 @@ void xs::stream_engine_t::in_event (fd_t fd_)
         //  number of bytes read will be always limited.
         decoder.get_buffer (&inpos, &insize);
         insize = read (inpos, insize);
+        XS_TRACE (engine_read, this, (int) insize);
 
         //  Check whether the peer has closed the connection.
         if (insize == (size_t) -1) {
             insize = 0;
             disconnection = true;
         }
+        else if (unlikely (options.latency) && insize)
+            session->data_received ();
     }
 
     //  Push the data to the decoder.
@@ -255,6 +260,7 @@ void xs::stream_engine_t::out_event (fd_t fd_)
     //  If protocol header was not yet sent...
     if (unlikely (!options.legacy_protocol && !header_sent)) {
         int hbytes = write (out_header, sizeof out_header);
+        XS_TRACE (engine_write, this, hbytes);
 
         //  It should always be possible to write the full protocol header to a
         //  freshly connected TCP socket. Therefore, if we get an error or
@@ -292,6 +298,7 @@ void xs::stream_engine_t::out_event (fd_t fd_)
     //  limited transmission buffer and thus the actual number of bytes
     //  written should be reasonably modest.
     int nbytes = write (outpos, outsize);
+    XS_TRACE (engine_write, this, nbytes);
 
     //  Handle problems with the connection.
     if (nbytes == -1) {
@@ -302,6 +309,10 @@ void xs::stream_engine_t::out_event (fd_t fd_)
     outpos += nbytes;
     outsize -= nbytes;
 
+    //  All the data fetched from the encoder so far are in the kernel now.
+    if (unlikely (options.latency) && !outsize)
+        session->data_sent ();
+
     //  If the encoder reports that there are no more data to get from it
     //  we can stop polling for POLLOUT immediately.
     if (!more_data && !outsize)
@@ -31,7 +31,9 @@ xs::surveyor_t::surveyor_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
     xsurveyor_t (parent_, tid_, sid_),
     receiving_responses (false),
     survey_id (generate_random ()),
-    timeout (0),
+    deadline (0),
+    quorum (-1),
+    responses (0),
     has_prefetched (false)
 {
     options.type = XS_SURVEYOR;
@@ -74,12 +76,33 @@ int xs::surveyor_t::xsend (msg_t *msg_, int flags_)
 
     //  Start waiting for responses from the peers.
     receiving_responses = true;
+    responses = 0;
+
+    //  Compute the number of responses that completes the survey. There's
+    //  no point in waiting for more responses than there are peers the
+    //  survey was actually delivered to.
+    if (!options.survey_quorum)
+        quorum = -1;
+    else if (options.survey_quorum < 0)
+        quorum = delivered ();
+    else
+        quorum = std::min (options.survey_quorum, delivered ());
+
+    //  Drop the response prefetched for the previous survey, if any.
+    if (has_prefetched) {
+        rc = prefetched.close ();
+        errno_assert (rc == 0);
+        rc = prefetched.init ();
+        errno_assert (rc == 0);
+        has_prefetched = false;
+    }
 
-    //  Set up the timeout for the survey (-1 means infinite).
-    if (!options.survey_timeout)
-        timeout = -1;
+    //  Set up the deadline for the survey (negative timeout means infinite).
+    //  Blocking recv will wake up exactly when the deadline expires.
+    if (options.survey_timeout < 0)
+        deadline = 0;
     else
-        timeout = now_ms () + options.survey_timeout;
+        deadline = now_ms () + options.survey_timeout;
 
     return 0;
 }
@@ -101,38 +124,47 @@ int xs::surveyor_t::xrecv (msg_t *msg_, int flags_)
         return 0;
     }
 
-    //  Get the first part of the response -- the survey ID.
-    rc = xsurveyor_t::xrecv (msg_, flags_);
-    if (rc != 0) {
-        if (errno != EAGAIN)
-            return -1;
-
-        //  In case of AGAIN we should check whether the survey timeout expired.
-        //  If so, we should return ETIMEDOUT so that user is able to
-        //  distinguish survey timeout from RCVTIMEO-caused timeout.
-        errno = now_ms () >= timeout ? ETIMEDOUT : EAGAIN;
+    //  If enough responses were already received, the survey is complete.
+    //  Report it using a distinct error so that user doesn't have to wait
+    //  for the survey timeout.
+    if (quorum >= 0 && responses >= quorum) {
+        errno = EQUORUM;
         return -1;
     }
 
-    //  Check whether this is response for the onging survey. If not, we can
-    //  drop the response.
-    if (unlikely (!(msg_->flags () & msg_t::more) || msg_->size () != 4 ||
-          get_uint32 ((unsigned char*) msg_->data ()) != survey_id)) {
-        while (true) {
+    while (true) {
+
+        //  Get the first part of the response -- the survey ID.
+        rc = xsurveyor_t::xrecv (msg_, flags_);
+        if (rc != 0) {
+            if (errno != EAGAIN)
+                return -1;
+
+            //  In case of AGAIN we should check whether the survey timeout
+            //  expired. If so, we should return ETIMEDOUT so that user is able
+            //  to distinguish survey timeout from RCVTIMEO-caused timeout.
+            errno = deadline && now_ms () >= deadline ? ETIMEDOUT : EAGAIN;
+            return -1;
+        }
+
+        //  Check whether this is response for the onging survey.
+        if (likely ((msg_->flags () & msg_t::more) && msg_->size () == 4 &&
+              get_uint32 ((unsigned char*) msg_->data ()) == survey_id))
+            break;
+
+        //  If not, drop the response and carry on with the next one. This way
+        //  all the stale responses queued so far are discarded in one go
+        //  rather than waking up the caller once per response.
+        while (msg_->flags () & msg_t::more) {
             rc = xsurveyor_t::xrecv (msg_, flags_);
             errno_assert (rc == 0);
-            if (!(msg_->flags () & msg_t::more))
-                break;
         }
-        msg_->close ();
-        msg_->init ();
-        errno = EAGAIN;
-        return -1;
     }
 
     //  Get the body of the response.
     rc = xsurveyor_t::xrecv (msg_, flags_);
     errno_assert (rc == 0);
+    ++responses;
 
     return 0;
 }
@@ -151,9 +183,14 @@ bool xs::surveyor_t::xhas_in ()
     int rc = xrecv (&prefetched, XS_DONTWAIT);
 
     //  No message available.
-    if (rc != 0 && errno == EAGAIN)
+    if (rc != 0 && (errno == EAGAIN || errno == ETIMEDOUT))
         return false;
 
+    //  The survey is complete. Signal POLLIN so that the user learns about
+    //  it straight away rather than after the survey timeout.
+    if (rc != 0 && errno == EQUORUM)
+        return true;
+
     errno_assert (rc == 0);
 
     //  We have a message prefetched. We can signal POLLIN now.
@@ -166,14 +203,9 @@ bool xs::surveyor_t::xhas_out ()
     return xsurveyor_t::xhas_out ();
 }
 
-int xs::surveyor_t::rcvtimeo ()
+uint64_t xs::surveyor_t::rcvdeadline ()
 {
-    int t = (int) (timeout - now_ms ());
-    if (t < 0)
-        return options.rcvtimeo;
-    if (options.rcvtimeo < 0)
-        return t;
-    return std::min (t, options.rcvtimeo); 
+    return receiving_responses ? deadline : 0;
 }
 
 xs::surveyor_session_t::surveyor_session_t (io_thread_t *io_thread_,
@@ -44,7 +44,7 @@ namespace xs
         int xrecv (xs::msg_t *msg_, int flags_);
         bool xhas_in ();
         bool xhas_out ();
-        int rcvtimeo ();
+        uint64_t rcvdeadline ();
 
     private:
 
@@ -54,8 +54,16 @@ namespace xs
         //  The ID of the ongoing survey.
         uint32_t survey_id;
 
-        //  The time instant when the current survey expires.
-        uint64_t timeout;
+        //  The time instant when the current survey expires. 0 means that
+        //  the survey never expires.
+        uint64_t deadline;
+
+        //  Number of responses needed to complete the current survey early.
+        //  -1 means that the survey runs until it times out.
+        int quorum;
+
+        //  Number of responses to the current survey received so far.
+        int responses;
 
         //  Inbound message prefetched during polling.
         bool has_prefetched;
@@ -153,21 +153,30 @@ static void pf_unsubscribe_all (void *core_, void *pf_, void *subscriber_)
     }
 }
 
-static void pf_match (void *core_, void *pf_,
-    const unsigned char *data_, size_t size_)
+static void pf_match_batch (void *core_, void *pf_, int count_,
+    const unsigned char **data_, const size_t *size_)
 {
+    //  Subscribers are already stored in a dense array. Report them all
+    //  in a single call.
     topic_t *self = (topic_t*) pf_;
-    for (topic_t::iterator it = self->begin (); it != self->end (); ++it) {
-        if (topic_match (it->first.c_str (), data_, size_)) {
-            for (subscribers_t::iterator its = it->second.begin ();
-                  its != it->second.end (); ++its) {
-                int rc = xs_filter_matching (core_, *its);
+    for (int i = 0; i != count_; i++) {
+        for (topic_t::iterator it = self->begin (); it != self->end (); ++it) {
+            if (!it->second.empty () &&
+                  topic_match (it->first.c_str (), data_ [i], size_ [i])) {
+                int rc = xs_filter_matching_batch (core_, i, &it->second [0],
+                    (int) it->second.size ());
                 errno_assert (rc == 0);
             }
         }
     }
 }
 
+static void pf_match (void *core_, void *pf_,
+    const unsigned char *data_, size_t size_)
+{
+    pf_match_batch (core_, pf_, 1, &data_, &size_);
+}
+
 static void *sf_create (void *core_)
 {
     return pf_create (core_);
@@ -202,7 +211,7 @@ static int sf_match (void *core_, void *sf_,
 
 static xs_filter_t rgxp_filter = {
     XS_PLUGIN_FILTER,
-    1,
+    2,
     id,
     pf_create,
     pf_destroy,
@@ -214,7 +223,8 @@ static xs_filter_t rgxp_filter = {
     sf_destroy,
     sf_subscribe,
     sf_unsubscribe,
-    sf_match
+    sf_match,
+    pf_match_batch
 };
 
 void *xs::topic_filter = (void*) &rgxp_filter;
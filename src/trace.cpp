@@ -0,0 +1,358 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.hpp"
+#include "clock.hpp"
+#include "config.hpp"
+#include "mutex.hpp"
+#include "atomic_counter.hpp"
+#include "err.hpp"
+
+#if !defined XS_HAVE_WINDOWS
+#include <pthread.h>
+#endif
+
+#if defined _MSC_VER
+#define XS_THREAD_LOCAL __declspec (thread)
+#elif defined XS_HAVE_TLS
+#define XS_THREAD_LOCAL __thread
+#endif
+
+namespace xs
+{
+
+    struct trace_event_t
+    {
+        uint64_t timestamp;
+        const void *object;
+        int64_t arg;
+        int type;
+
+        //  Sequential number of the thread that recorded the event.
+        int thread;
+    };
+
+    //  Ring buffer of the events recorded by a single thread. Only
+    //  the owner thread writes into the buffer. Other threads may read it
+    //  while holding trace_sync. Once the owner exits, the ring is passed
+    //  to the next thread that starts recording.
+    struct trace_ring_t
+    {
+        trace_event_t *events;
+        uint32_t mask;
+
+        //  Number of events written so far, modulo 2^32. Event N is stored
+        //  at position N & mask. The increment publishes the event to other
+        //  threads.
+        atomic_counter_t pos;
+
+        //  True if the ring was filled up at least once.
+        volatile bool full;
+
+        //  Value of trace_generation when the ring was last reset.
+        volatile uint32_t generation;
+
+        //  Sequential number of the owner thread.
+        int thread;
+
+        //  False if the owner thread have exited.
+        bool owned;
+
+        trace_ring_t *next;
+    };
+
+    //  Event recorded by one of the threads, as collected by trace_dump.
+    struct trace_entry_t
+    {
+        trace_event_t event;
+
+        bool operator < (const trace_entry_t &other_) const
+        {
+            return event.timestamp < other_.event.timestamp;
+        }
+    };
+
+}
+
+volatile bool xs::trace_enabled = false;
+
+//  Each trace_start call increments the generation. Rings are reset lazily
+//  by their owners once they find out their generation is out of date.
+static volatile uint32_t trace_generation = 0;
+static int trace_size = 0;
+
+//  If false, the CPU has no timestamp counter and nanoseconds are recorded.
+static bool trace_tsc = true;
+
+//  Time when the tracing was started, in both TSC ticks and nanoseconds,
+//  so that the ticks can be converted to physical time.
+static uint64_t trace_start_tsc = 0;
+static uint64_t trace_start_ns = 0;
+
+//  All the rings ever created and the number of them.
+static xs::trace_ring_t *trace_rings = NULL;
+static int trace_threads = 0;
+static xs::mutex_t trace_sync;
+
+//  The calling thread's ring. If the compiler doesn't support thread-local
+//  variables, it's accessed via the thread-specific key alone.
+#if defined XS_THREAD_LOCAL
+static XS_THREAD_LOCAL xs::trace_ring_t *trace_local = NULL;
+#endif
+
+#if !defined XS_HAVE_WINDOWS
+
+//  The key's destructor returns the ring to the pool once the owner exits.
+static pthread_key_t trace_key;
+static pthread_once_t trace_key_once = PTHREAD_ONCE_INIT;
+
+static void trace_release (void *ring_)
+{
+    trace_sync.lock ();
+    ((xs::trace_ring_t*) ring_)->owned = false;
+    trace_sync.unlock ();
+}
+
+static void trace_create_key ()
+{
+    int rc = pthread_key_create (&trace_key, trace_release);
+    posix_assert (rc);
+}
+
+#endif
+
+static xs::trace_ring_t *trace_get_local ()
+{
+#if defined XS_THREAD_LOCAL
+    return trace_local;
+#else
+    int rc = pthread_once (&trace_key_once, trace_create_key);
+    posix_assert (rc);
+    return (xs::trace_ring_t*) pthread_getspecific (trace_key);
+#endif
+}
+
+static void trace_set_local (xs::trace_ring_t *ring_)
+{
+#if defined XS_THREAD_LOCAL
+    trace_local = ring_;
+#endif
+#if !defined XS_HAVE_WINDOWS
+    int rc = pthread_once (&trace_key_once, trace_create_key);
+    posix_assert (rc);
+    rc = pthread_setspecific (trace_key, ring_);
+    posix_assert (rc);
+#endif
+}
+
+static const char *trace_names [] = {
+    "none",
+    "pipe_write",
+    "pipe_read",
+    "pipe_hiccup",
+    "command_send",
+    "command_recv",
+    "engine_read",
+    "engine_write",
+    "timer",
+    "reconnect"
+};
+
+//  Assigns a ring to the calling thread, reusing the ring of an exited
+//  thread if possible, or resets the thread's ring if it's out of date.
+//  If the memory for the events cannot be allocated, the ring is left out
+//  of date and nothing is recorded into it.
+static xs::trace_ring_t *trace_attach ()
+{
+    xs::trace_ring_t *ring = trace_get_local ();
+    bool attached = ring != NULL;
+
+    trace_sync.lock ();
+    if (!attached) {
+        for (ring = trace_rings; ring && ring->owned; ring = ring->next)
+            ;
+        if (!ring) {
+            ring = new (std::nothrow) xs::trace_ring_t;
+            alloc_assert (ring);
+            ring->events = NULL;
+            ring->mask = 0;
+            ring->full = false;
+            ring->generation = trace_generation - 1;
+            ring->next = trace_rings;
+            trace_rings = ring;
+        }
+        ring->owned = true;
+        ring->thread = trace_threads++;
+    }
+
+    //  The events recorded by the previous owner in the current generation
+    //  are retained.
+    if (ring->generation != trace_generation) {
+        if (ring->mask + 1 != (uint32_t) trace_size || !ring->events) {
+            free (ring->events);
+            ring->events = (xs::trace_event_t*)
+                malloc (trace_size * sizeof (xs::trace_event_t));
+            ring->mask = ring->events ? trace_size - 1 : 0;
+        }
+        if (ring->events) {
+            ring->pos.set (0);
+            ring->full = false;
+            ring->generation = trace_generation;
+        }
+    }
+    trace_sync.unlock ();
+
+    if (!attached)
+        trace_set_local (ring);
+    return ring;
+}
+
+void xs::trace_record (trace_event_type_t type_, const void *object_,
+    int64_t arg_)
+{
+    trace_ring_t *ring = trace_get_local ();
+    if (unlikely (!ring || ring->generation != trace_generation)) {
+        ring = trace_attach ();
+        if (unlikely (ring->generation != trace_generation))
+            return;
+    }
+
+    uint32_t pos = ring->pos.get ();
+    trace_event_t *event = &ring->events [pos & ring->mask];
+    event->timestamp = trace_tsc ? clock_t::rdtsc () : clock_t::now_ns ();
+    event->object = object_;
+    event->arg = arg_;
+    event->type = type_;
+    event->thread = ring->thread;
+    if (unlikely (pos == ring->mask))
+        ring->full = true;
+    ring->pos.add (1);
+}
+
+int xs::trace_start (int size_)
+{
+    if (size_ <= 0 || size_ > max_trace_size || (size_ & (size_ - 1))) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    trace_sync.lock ();
+    trace_enabled = false;
+    trace_size = size_;
+    trace_tsc = clock_t::rdtsc () != 0;
+    trace_start_tsc = clock_t::rdtsc ();
+    trace_start_ns = clock_t::now_ns ();
+    trace_generation++;
+    trace_sync.unlock ();
+
+    //  Allocate the calling thread's ring straight away so that lack of
+    //  memory can be reported. Other threads allocate their rings lazily
+    //  and record nothing if the allocation fails.
+    trace_ring_t *ring = trace_attach ();
+    if (ring->generation != trace_generation) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    trace_enabled = true;
+    return 0;
+}
+
+void xs::trace_stop ()
+{
+    trace_enabled = false;
+}
+
+int xs::trace_dump (const char *filename_)
+{
+    FILE *out = fopen (filename_, "w");
+    if (!out)
+        return -1;
+
+    //  Collect the events from all the rings. The owners may be recording
+    //  new events in the meantime. Any event that might have been overwritten
+    //  while being copied is ignored.
+    std::vector <trace_entry_t> entries;
+    trace_sync.lock ();
+    for (trace_ring_t *ring = trace_rings; ring; ring = ring->next) {
+        if (ring->generation != trace_generation)
+            continue;
+
+        //  Adding zero is used to get a memory barrier, so that the events
+        //  published by the owner are visible.
+        uint32_t size = ring->mask + 1;
+        bool full = ring->full;
+        uint32_t end = ring->pos.add (0);
+        uint32_t begin = full ? end - size : 0;
+        size_t first = entries.size ();
+        for (uint32_t i = begin; i != end; i++) {
+            trace_entry_t entry;
+            entry.event = ring->events [i & ring->mask];
+            entries.push_back (entry);
+        }
+        uint32_t pos = ring->pos.add (0);
+        if (pos - begin > size)
+            entries.erase (entries.begin () + first, entries.begin () + first +
+                (size_t) std::min (pos - begin - size, end - begin));
+    }
+    uint64_t start_tsc = trace_start_tsc;
+    uint64_t start_ns = trace_start_ns;
+    bool tsc = trace_tsc;
+    trace_sync.unlock ();
+
+    std::stable_sort (entries.begin (), entries.end ());
+
+    //  Timestamps are written relative to the start of the tracing. The ratio
+    //  of the TSC and physical time elapsed since is written in the header.
+    fprintf (out, "# libxs trace\n");
+    if (tsc) {
+        uint64_t ticks = clock_t::rdtsc () - start_tsc;
+        uint64_t ns = clock_t::now_ns () - start_ns;
+        fprintf (out, "# clock: tsc\n");
+        fprintf (out, "# ticks per us: %.3f\n",
+            ns ? (double) ticks * 1000 / ns : 0.0);
+    }
+    else
+        fprintf (out, "# clock: ns\n");
+    fprintf (out, "# timestamp thread event object argument\n");
+    for (size_t i = 0; i != entries.size (); i++) {
+        const trace_event_t &event = entries [i].event;
+        int type = event.type;
+        if (type < 0 || type >= (int) (sizeof (trace_names) /
+              sizeof (trace_names [0])))
+            type = 0;
+        uint64_t start = tsc ? start_tsc : start_ns;
+        uint64_t timestamp = event.timestamp > start ?
+            event.timestamp - start : 0;
+        fprintf (out, "%llu %d %s %p %lld\n", (unsigned long long) timestamp,
+            event.thread, trace_names [type], event.object,
+            (long long) event.arg);
+    }
+
+    int rc = fclose (out);
+    return rc == 0 ? 0 : -1;
+}
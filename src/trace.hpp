@@ -0,0 +1,91 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __XS_TRACE_HPP_INCLUDED__
+#define __XS_TRACE_HPP_INCLUDED__
+
+#include "platform.hpp"
+#include "stdint.hpp"
+#include "likely.hpp"
+
+#if defined HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#endif
+
+namespace xs
+{
+
+    //  Types of the events recorded in the trace.
+    enum trace_event_type_t
+    {
+        trace_pipe_write = 1,
+        trace_pipe_read,
+        trace_pipe_hiccup,
+        trace_command_send,
+        trace_command_recv,
+        trace_engine_read,
+        trace_engine_write,
+        trace_timer,
+        trace_reconnect
+    };
+
+    //  True if the events are being recorded at the moment. Don't access
+    //  this variable directly, use XS_TRACE macro instead.
+    extern volatile bool trace_enabled;
+
+    //  Records the event into the calling thread's trace buffer.
+    void trace_record (trace_event_type_t type_, const void *object_,
+        int64_t arg_);
+
+    //  Starts recording the events. Each thread that records an event gets
+    //  its own ring buffer of 'size_' events, which must be a power of 2.
+    //  Any events recorded so far are discarded.
+    int trace_start (int size_);
+
+    //  Stops recording the events. Recorded events are retained.
+    void trace_stop ();
+
+    //  Writes the events recorded by all the threads to the file, ordered
+    //  by their timestamps.
+    int trace_dump (const char *filename_);
+
+}
+
+//  Static probe point for tools such as perf, SystemTap or DTrace. Probes
+//  compile into a single no-op instruction if there's no tool attached.
+#if defined HAVE_SYS_SDT_H
+#define XS_PROBE(name_, object_, arg_) \
+    DTRACE_PROBE2 (libxs, name_, object_, arg_)
+#else
+#define XS_PROBE(name_, object_, arg_)
+#endif
+
+//  Marks the spot in the code where the event of the specified type
+//  happens. If tracing is disabled, the cost is a single branch.
+#define XS_TRACE(name_, object_, arg_) \
+    do {\
+        XS_PROBE (name_, object_, arg_);\
+        if (unlikely (xs::trace_enabled))\
+            xs::trace_record (xs::trace_##name_, (object_),\
+                (int64_t) (arg_));\
+    } while (false)
+
+#endif
@@ -20,6 +20,7 @@
 */
 
 #include <string.h>
+#include <algorithm>
 
 #include "../include/xs/xs.h"
 
@@ -28,9 +29,11 @@
 #include "wire.hpp"
 #include "err.hpp"
 #include "msg.hpp"
+#include "likely.hpp"
 
 xs::xpub_t::xpub_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
     socket_base_t (parent_, tid_, sid_),
+    filtered (0),
     more (false),
     tmp_filter_id (-1)
 {
@@ -89,6 +92,13 @@ void xs::xpub_t::xattach_pipe (pipe_t *pipe_, bool icanhasall_)
     xs_assert (pipe_);
     dist.attach (pipe_);
 
+    //  If the session on the other side of the pipe does the filtering,
+    //  the socket doesn't have to match messages for it.
+    if (pipe_->get_filter_offload ())
+        offloaded.push_back (pipe_);
+    else
+        filtered++;
+
     //  If icanhasall_ is specified, the caller would like to subscribe
     //  to all data on this pipe, implicitly. Also, if we are using
     //  0MQ/2.1-style protocol, there's no subscription forwarding. Thus,
@@ -232,19 +242,47 @@ void xs::xpub_t::xterminated (pipe_t *pipe_)
         tmp_filter_id = -1;
     }
 
+    if (pipe_->get_filter_offload ())
+        offloaded.erase (std::find (offloaded.begin (), offloaded.end (),
+            pipe_));
+    else
+        filtered--;
+
     dist.terminated (pipe_);
 }
 
+uint64_t xs::xpub_t::xdropped ()
+{
+    return dist.dropped ();
+}
+
 int xs::xpub_t::xsend (msg_t *msg_, int flags_)
 {
     bool msg_more = msg_->flags () & msg_t::more ? true : false;
 
     //  For the first part of multi-part message, find the matching pipes.
+    //  The pipes with offloaded filtering match any message. If there are
+    //  no other pipes, we can avoid walking the subscriptions altogether.
     if (!more) {
-        for (filters_t::iterator it = filters.begin (); it != filters.end ();
+        for (pipes_t::iterator it = offloaded.begin (); it != offloaded.end ();
               ++it)
-            it->type->pf_match ((void*) (core_t*) this, it->instance,
-                (unsigned char*) msg_->data (), msg_->size ());
+            dist.match (*it);
+        if (filtered) {
+            const unsigned char *data = (unsigned char*) msg_->data ();
+            size_t size = msg_->size ();
+            for (filters_t::iterator it = filters.begin ();
+                  it != filters.end (); ++it) {
+
+                //  Filters implementing version 2 of the interface report
+                //  the matching pipes in batches.
+                if (it->type->version >= 2)
+                    it->type->pf_match_batch ((void*) (core_t*) this,
+                        it->instance, 1, &data, &size);
+                else
+                    it->type->pf_match ((void*) (core_t*) this, it->instance,
+                        data, size);
+            }
+        }
     }
 
     //  Send the message to all the pipes that were marked as matching
@@ -322,15 +360,294 @@ int xs::xpub_t::filter_matching (void *subscriber_)
     return 0;
 }
 
+int xs::xpub_t::filter_matching_batch (int index_, void **subscribers_,
+    int count_)
+{
+    //  XPUB socket matches a single message at a time, so the index is
+    //  always zero.
+    for (int i = 0; i != count_; i++)
+        dist.match ((xs::pipe_t*) subscribers_ [i]);
+    return 0;
+}
+
 xs::xpub_session_t::xpub_session_t (io_thread_t *io_thread_, bool connect_,
       socket_base_t *socket_, const options_t &options_,
       const char *protocol_, const char *address_) :
     session_base_t (io_thread_, connect_, socket_, options_, protocol_,
-        address_)
+        address_),
+    filter_offload (options_.filter_offload),
+    matching (false),
+    more (false),
+    out_more (false),
+    rematch (false),
+    batch_pos (0),
+    batch_end (0),
+    current (0)
 {
+    for (int i = 0; i != offload_batch_size; i++) {
+        int rc = batch [i].init ();
+        errno_assert (rc == 0);
+    }
+
+    //  PGM and 0MQ/2.1-style peers don't forward subscriptions. All the data
+    //  have to be sent to them.
+    if (options_.sp_version == 1 || (protocol_ &&
+          (strcmp (protocol_, "pgm") == 0 || strcmp (protocol_, "epgm") == 0)))
+        filter_offload = false;
 }
 
 xs::xpub_session_t::~xpub_session_t ()
 {
+    drop_batch ();
+    for (int i = 0; i != offload_batch_size; i++) {
+        int rc = batch [i].close ();
+        errno_assert (rc == 0);
+    }
+
+    //  Deallocate all the filters.
+    for (filters_t::iterator it = filters.begin (); it != filters.end (); ++it)
+        it->type->pf_destroy ((void*) (core_t*) this, it->instance);
+}
+
+int xs::xpub_session_t::read (msg_t *msg_)
+{
+    if (!filter_offload)
+        return session_base_t::read (msg_);
+
+    //  Messages kept over the reconnection are matched against whatever
+    //  subscriptions are known at this point, same as if they were still
+    //  in the pipe.
+    if (unlikely (rematch)) {
+        match (batch_end, false);
+        rematch = false;
+    }
+
+    while (true) {
+
+        if (batch_pos == batch_end) {
+            int rc = fill ();
+            if (rc != 0)
+                return rc;
+        }
+
+        //  Pass the matching message parts to the engine, drop the others.
+        int pos = batch_pos++;
+        out_more = batch [pos].flags () & msg_t::more ? true : false;
+        if (keep [pos]) {
+
+            //  Same as with reading from the pipe, the message passed in by
+            //  the engine is not initialised, so it's simply overwritten.
+            *msg_ = batch [pos];
+            int rc = batch [pos].init ();
+            errno_assert (rc == 0);
+            return 0;
+        }
+        int rc = batch [pos].close ();
+        errno_assert (rc == 0);
+        rc = batch [pos].init ();
+        errno_assert (rc == 0);
+    }
+}
+
+int xs::xpub_session_t::fill ()
+{
+    //  Read whatever is available in the pipe, up to the batch size.
+    bool first_more = more;
+    int parts = 0;
+    while (parts != offload_batch_size) {
+        if (session_base_t::read (&batch [parts]) != 0)
+            break;
+        more = batch [parts].flags () & msg_t::more ? true : false;
+        parts++;
+    }
+    if (!parts)
+        return -1;
+
+    match (parts, first_more);
+    return 0;
+}
+
+void xs::xpub_session_t::match (int parts_, bool more_)
+{
+    //  Remember the first parts of the messages.
+    const unsigned char *data [offload_batch_size];
+    size_t size [offload_batch_size];
+    int index [offload_batch_size];
+    int count = 0;
+    for (int i = 0; i != parts_; i++) {
+        index [i] = -1;
+        if (!more_) {
+            data [count] = (unsigned char*) batch [i].data ();
+            size [count] = batch [i].size ();
+            matches [count] = false;
+            index [i] = count++;
+        }
+        more_ = batch [i].flags () & msg_t::more ? true : false;
+    }
+
+    //  Match all the messages in a single pass over the filters. Filters
+    //  implementing version 1 of the interface have to be invoked for each
+    //  message separately.
+    for (filters_t::iterator it = filters.begin (); it != filters.end ();
+          ++it) {
+        if (it->type->version >= 2) {
+            if (count)
+                it->type->pf_match_batch ((void*) (core_t*) this,
+                    it->instance, count, data, size);
+            continue;
+        }
+        for (current = 0; current != count; current++)
+            if (!matches [current])
+                it->type->pf_match ((void*) (core_t*) this, it->instance,
+                    data [current], size [current]);
+    }
+
+    //  The remaining parts of a message follow the decision made for its
+    //  first part, even if it was read in one of the previous batches.
+    for (int i = 0; i != parts_; i++) {
+        if (index [i] >= 0)
+            matching = matches [index [i]];
+        keep [i] = matching;
+    }
+    batch_pos = 0;
+    batch_end = parts_;
+}
+
+void xs::xpub_session_t::drop_batch ()
+{
+    for (; batch_pos != batch_end; batch_pos++) {
+        int rc = batch [batch_pos].close ();
+        errno_assert (rc == 0);
+        rc = batch [batch_pos].init ();
+        errno_assert (rc == 0);
+    }
+    batch_pos = 0;
+    batch_end = 0;
+}
+
+int xs::xpub_session_t::write (msg_t *msg_)
+{
+    if (!filter_offload)
+        return session_base_t::write (msg_);
+
+    //  The only messages flowing upstream are (un)subscriptions. Make a copy
+    //  so that it can be applied once the socket have accepted it.
+    blob_t sub ((unsigned char*) msg_->data (), msg_->size ());
+    int rc = session_base_t::write (msg_);
+    if (rc == 0)
+        apply (sub);
+    return rc;
+}
+
+void xs::xpub_session_t::detach ()
+{
+    //  The peer will resend all its subscriptions on reconnect.
+    for (filters_t::iterator it = filters.begin (); it != filters.end (); ++it)
+        it->type->pf_destroy ((void*) (core_t*) this, it->instance);
+    filters.clear ();
+
+    if (filter_offload) {
+
+        //  Drop the remaining parts of the message the engine was in
+        //  the middle of.
+        while (out_more && batch_pos != batch_end) {
+            out_more = batch [batch_pos].flags () & msg_t::more ? true : false;
+            int rc = batch [batch_pos].close ();
+            errno_assert (rc == 0);
+            rc = batch [batch_pos].init ();
+            errno_assert (rc == 0);
+            batch_pos++;
+        }
+
+        if (out_more) {
+
+            //  The message continues in the pipe. The rest of it is dropped
+            //  by session_base_t::detach.
+            out_more = false;
+            more = false;
+        }
+        else if (batch_pos != batch_end) {
+
+            //  Keep the complete messages read in advance, so that they can
+            //  be matched against the subscriptions from the new connection.
+            //  If the last one is incomplete, its remainder has to stay in
+            //  the pipe.
+            if (batch_pos) {
+                int parts = batch_end - batch_pos;
+                for (int i = 0; i != parts; i++) {
+                    batch [i] = batch [batch_pos + i];
+                    int rc = batch [batch_pos + i].init ();
+                    errno_assert (rc == 0);
+                }
+                batch_pos = 0;
+                batch_end = parts;
+            }
+            rematch = true;
+            reset_incomplete_in ();
+        }
+    }
+
+    session_base_t::detach ();
+}
+
+void xs::xpub_session_t::apply (const blob_t &sub_)
+{
+    //  Malformed subscriptions are ignored. The socket will deal with them.
+    if (sub_.size () < 4)
+        return;
+    unsigned char *data = (unsigned char*) sub_.data ();
+    int cmd = get_uint16 (data);
+    int filter_id = get_uint16 (data + 2);
+
+    //  Find the relevant filter.
+    filters_t::iterator it;
+    for (it = filters.begin (); it != filters.end (); ++it)
+        if (it->type->id (NULL) == filter_id)
+            break;
+
+    if (cmd == SP_PUBSUB_CMD_UNSUBSCRIBE) {
+        if (it != filters.end ())
+            it->type->pf_unsubscribe ((void*) (core_t*) this, it->instance,
+                (void*) this, data + 4, sub_.size () - 4);
+        return;
+    }
+
+    if (cmd != SP_PUBSUB_CMD_SUBSCRIBE)
+        return;
+
+    //  If the filter of the specified type does not exist yet, create it.
+    if (it == filters.end ()) {
+        filter_t f;
+        f.type = get_filter (filter_id);
+        if (!f.type)
+            return;
+        f.instance = f.type->pf_create ((void*) (core_t*) this);
+        xs_assert (f.instance);
+        filters.push_back (f);
+        it = filters.end () - 1;
+    }
+
+    it->type->pf_subscribe ((void*) (core_t*) this, it->instance,
+        (void*) this, data + 4, sub_.size () - 4);
+}
+
+int xs::xpub_session_t::filter_unsubscribed (const unsigned char *data_,
+    size_t size_)
+{
+    return 0;
+}
+
+int xs::xpub_session_t::filter_matching (void *subscriber_)
+{
+    matches [current] = true;
+    return 0;
+}
+
+int xs::xpub_session_t::filter_matching_batch (int index_,
+    void **subscribers_, int count_)
+{
+    //  The only subscriber is the peer of this session.
+    matches [index_] = true;
+    return 0;
 }
 
@@ -25,9 +25,12 @@
 
 #include <deque>
 #include <string>
+#include <vector>
 
 #include "socket_base.hpp"
 #include "session_base.hpp"
+#include "config.hpp"
+#include "msg.hpp"
 #include "array.hpp"
 #include "dist.hpp"
 #include "blob.hpp"
@@ -58,12 +61,15 @@ namespace xs
         void xread_activated (xs::pipe_t *pipe_);
         void xwrite_activated (xs::pipe_t *pipe_);
         void xterminated (xs::pipe_t *pipe_);
+        uint64_t xdropped ();
 
     private:
 
         //  Overloaded functions from core_t.
         int filter_unsubscribed (const unsigned char *data_, size_t size_);
         int filter_matching (void *subscriber_);
+        int filter_matching_batch (int index_, void **subscribers_,
+            int count_);
 
         //  The repository of subscriptions.
         struct filter_t
@@ -77,6 +83,14 @@ namespace xs
         //  Distributor of messages holding the list of outbound pipes.
         dist_t dist;
 
+        //  Pipes whose sessions do the filtering themselves. Each message is
+        //  passed to all of them.
+        typedef std::vector <xs::pipe_t*> pipes_t;
+        pipes_t offloaded;
+
+        //  Number of pipes whose messages have to be matched by the socket.
+        int filtered;
+
         //  True if we are in the middle of sending a multi-part message.
         bool more;
 
@@ -92,7 +106,7 @@ namespace xs
         const xpub_t &operator = (const xpub_t&);
     };
 
-    class xpub_session_t : public session_base_t
+    class xpub_session_t : public session_base_t, public core_t
     {
     public:
 
@@ -101,8 +115,76 @@ namespace xs
             const char *protocol_, const char *address_);
         ~xpub_session_t ();
 
+        //  Overloads of the functions from session_base_t.
+        int read (msg_t *msg_);
+        int write (msg_t *msg_);
+        void detach ();
+
     private:
 
+        //  Overloaded functions from core_t.
+        int filter_unsubscribed (const unsigned char *data_, size_t size_);
+        int filter_matching (void *subscriber_);
+        int filter_matching_batch (int index_, void **subscribers_,
+            int count_);
+
+        //  Applies the subscription to the session's filters.
+        void apply (const blob_t &sub_);
+
+        //  Reads the messages available in the pipe into the batch and
+        //  matches them against the subscriptions.
+        int fill ();
+
+        //  Matches the first 'parts_' message parts in the batch against
+        //  the subscriptions. 'more_' is true if the first part is not
+        //  the first part of a message.
+        void match (int parts_, bool more_);
+
+        //  Drops the messages read in advance.
+        void drop_batch ();
+
+        //  If true, the session matches the outbound messages against
+        //  the subscriptions received from the peer instead of the socket.
+        bool filter_offload;
+
+        //  Session-local repository of the subscriptions.
+        struct filter_t
+        {
+            xs_filter_t *type;
+            void *instance;
+        };
+        typedef std::vector <filter_t> filters_t;
+        filters_t filters;
+
+        //  True if the last message read from the pipe matches
+        //  a subscription.
+        bool matching;
+
+        //  True if we are in the middle of reading a multi-part message.
+        bool more;
+
+        //  True if the last part taken from the batch, either passed to the
+        //  engine or dropped, was followed by more parts of the message.
+        bool out_more;
+
+        //  If true, the messages in the batch were kept over a reconnection
+        //  and have to be matched against the new subscriptions.
+        bool rematch;
+
+        //  Message parts read from the pipe in advance and, for each of them,
+        //  whether it belongs to a matching message. Parts from 'batch_pos'
+        //  to 'batch_end' are yet to be passed to the engine.
+        msg_t batch [offload_batch_size];
+        bool keep [offload_batch_size];
+        int batch_pos;
+        int batch_end;
+
+        //  For each message in the batch, whether it matches a subscription.
+        //  While a version 1 filter is executed, 'current' is the index of
+        //  the message being matched.
+        bool matches [offload_batch_size];
+        int current;
+
         xpub_session_t (const xpub_session_t&);
         const xpub_session_t &operator = (const xpub_session_t&);
     };
@@ -22,8 +22,6 @@
 
 #include "xrep.hpp"
 #include "pipe.hpp"
-#include "wire.hpp"
-#include "random.hpp"
 #include "likely.hpp"
 #include "err.hpp"
 
@@ -33,7 +31,7 @@ xs::xrep_t::xrep_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
     more_in (false),
     current_out (NULL),
     more_out (false),
-    next_peer_id (generate_random ())
+    drops (0)
 {
     options.type = XS_XREP;
     options.sp_pattern = SP_REQREP;
@@ -56,6 +54,7 @@ xs::xrep_t::xrep_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
 xs::xrep_t::~xrep_t ()
 {
     xs_assert (outpipes.empty ());
+    xs_assert (slots.empty ());
     prefetched_msg.close ();
 }
 
@@ -78,7 +77,7 @@ int xs::xrep_t::xsetsockopt (int option_, const void *optval_,
     }
 
     int version = *(int *) optval_;
-    if (version != 1) {
+    if (version != 1 && version != 4) {
         errno = EINVAL;
         return -1;
     }
@@ -91,38 +90,29 @@ void xs::xrep_t::xattach_pipe (pipe_t *pipe_, bool icanhasall_)
 {
     xs_assert (pipe_);
 
-    //  Generate a new unique peer identity.
-    unsigned char buf [5];
+    //  Add the pipe to the table of outbound pipes. This generates a new
+    //  unique peer identity.
+    unsigned char buf [1 + slots_t::id_size];
     buf [0] = 0;
-    put_uint32 (buf + 1, next_peer_id);
-    blob_t identity (buf, 5);
-    ++next_peer_id;
-
-    //  Add the pipe to the map out outbound pipes.
     outpipe_t outpipe = {pipe_, true};
-    bool ok = outpipes.insert (outpipes_t::value_type (
-        identity, outpipe)).second;
-    xs_assert (ok);
+    slots.insert (outpipe, buf + 1);
 
     //  Add the pipe to the list of inbound pipes.
-    pipe_->set_identity (identity);
+    pipe_->set_identity (blob_t (buf, sizeof buf));
     fq.attach (pipe_);    
 }
 
 void xs::xrep_t::xterminated (pipe_t *pipe_)
 {
     fq.terminated (pipe_);
+    erase_outpipe (pipe_);
+    if (pipe_ == current_out)
+        current_out = NULL;
+}
 
-    for (outpipes_t::iterator it = outpipes.begin ();
-          it != outpipes.end (); ++it) {
-        if (it->second.pipe == pipe_) {
-            outpipes.erase (it);
-            if (pipe_ == current_out)
-                current_out = NULL;
-            return;
-        }
-    }
-    xs_assert (false);
+uint64_t xs::xrep_t::xdropped ()
+{
+    return drops;
 }
 
 void xs::xrep_t::xread_activated (pipe_t *pipe_)
@@ -132,15 +122,12 @@ void xs::xrep_t::xread_activated (pipe_t *pipe_)
 
 void xs::xrep_t::xwrite_activated (pipe_t *pipe_)
 {
-    for (outpipes_t::iterator it = outpipes.begin ();
-          it != outpipes.end (); ++it) {
-        if (it->second.pipe == pipe_) {
-            xs_assert (!it->second.active);
-            it->second.active = true;
-            return;
-        }
-    }
-    xs_assert (false);
+    blob_t identity = pipe_->get_identity ();
+    outpipe_t *outpipe = find_outpipe ((unsigned char*) identity.data (),
+        identity.size ());
+    xs_assert (outpipe && outpipe->pipe == pipe_);
+    xs_assert (!outpipe->active);
+    outpipe->active = true;
 }
 
 int xs::xrep_t::xsend (msg_t *msg_, int flags_)
@@ -159,18 +146,19 @@ int xs::xrep_t::xsend (msg_t *msg_, int flags_)
 
             //  Find the pipe associated with the identity stored in the prefix.
             //  If there's no such pipe just silently ignore the message.
-            blob_t identity ((unsigned char*) msg_->data (), msg_->size ());
-            outpipes_t::iterator it = outpipes.find (identity);
+            outpipe_t *outpipe = find_outpipe (
+                (unsigned char*) msg_->data (), msg_->size ());
 
-            if (it != outpipes.end ()) {
-                current_out = it->second.pipe;
+            if (outpipe) {
+                current_out = outpipe->pipe;
                 msg_t empty;
                 int rc = empty.init ();
                 errno_assert (rc == 0);
                 if (!current_out->check_write (&empty)) {
-                    it->second.active = false;
+                    outpipe->active = false;
                     more_out = false;
                     current_out = NULL;
+                    drops++;
                 }
                 rc = empty.close ();
                 errno_assert (rc == 0);
@@ -188,11 +176,42 @@ int xs::xrep_t::xsend (msg_t *msg_, int flags_)
     //  Check whether this is the last part of the message.
     more_out = msg_->flags () & msg_t::more ? true : false;
 
+    //  In version 4 of the pattern the envelope is packed into the first
+    //  part of the body. Messages with envelopes that can't be packed are
+    //  dropped.
+    if (options.sp_version >= 4) {
+        int rc = packer.store (msg_);
+        if (rc == 1)
+            return 0;
+        if (rc == -1)
+            current_out = NULL;
+        if (packer.pending ()) {
+            msg_t packed;
+            if (packer.pack (msg_, &packed)) {
+                rc = msg_->move (packed);
+                errno_assert (rc == 0);
+            }
+            else if (current_out) {
+                if (current_out->write (&packed)) {
+                    rc = packed.init ();
+                    errno_assert (rc == 0);
+                }
+                else
+                    current_out = NULL;
+            }
+            rc = packed.close ();
+            errno_assert (rc == 0);
+        }
+        packer.sent (more_out);
+    }
+
     //  Push the message into the pipe. If there's no out pipe, just drop it.
     if (current_out) {
         bool ok = current_out->write (msg_);
-        if (unlikely (!ok))
+        if (unlikely (!ok)) {
             current_out = NULL;
+            drops++;
+        }
         else if (!more_out) {
             current_out->flush ();
             current_out = NULL;
@@ -236,7 +255,8 @@ int xs::xrep_t::xrecv (msg_t *msg_, int flags_)
     while (true) {
 
         //  Get next message part.
-        int rc = fq.recvpipe (msg_, flags_, &pipe);
+        int rc = options.sp_version < 4 ? fq.recvpipe (msg_, flags_, &pipe) :
+            unpacker.recvpipe (&fq, msg_, flags_, &pipe);
         if (rc != 0)
             return -1;
 
@@ -249,31 +269,23 @@ int xs::xrep_t::xrecv (msg_t *msg_, int flags_)
         //  Empty identity means we can preserve the auto-generated identity.
         if (msg_->size () != 0) {
 
-            //  Check whether this is a duplicate identity. If so, drop the
-            //  corresponding connection.
+            //  Check whether this is a duplicate identity or an identity
+            //  clashing with the generated ones. If so, drop the corresponding
+            //  connection.
             blob_t identity ((unsigned char*) msg_->data (), msg_->size ());
-            if (outpipes.find (identity) != outpipes.end ()) {
+            if (is_generated (identity) ||
+                  outpipes.find (identity) != outpipes.end ()) {
                 pipe->terminate (false);
                 continue;
             }
 
             //  Actual change of the identity.
-            bool changed = false;
-            outpipes_t::iterator it = outpipes.begin ();
-            while (it != outpipes.end ()) {
-                if (it->second.pipe == pipe) {
-                    pipe->set_identity (identity);
-                    outpipes.erase (it);
-                    outpipe_t outpipe = {pipe, true};
-                    bool ok = outpipes.insert (outpipes_t::value_type (identity,
-                          outpipe)).second;
-                    xs_assert (ok);
-                    changed = true;
-                    break;
-                }
-                ++it;
-            }
-            xs_assert (changed);
+            erase_outpipe (pipe);
+            pipe->set_identity (identity);
+            outpipe_t outpipe = {pipe, true};
+            bool ok = outpipes.insert (outpipes_t::value_type (identity,
+                outpipe)).second;
+            xs_assert (ok);
         }
     }
 
@@ -339,6 +351,38 @@ bool xs::xrep_t::xhas_out ()
     return true;
 }
 
+bool xs::xrep_t::is_generated (const blob_t &identity_)
+{
+    return identity_.size () == 1 + slots_t::id_size && identity_ [0] == 0;
+}
+
+xs::xrep_t::outpipe_t *xs::xrep_t::find_outpipe (unsigned char *identity_,
+    size_t size_)
+{
+    //  Generated identities are resolved by the slot table. That way we don't
+    //  have to construct a blob and search the map when routing the replies.
+    if (size_ == 1 + slots_t::id_size && identity_ [0] == 0)
+        return slots.find (identity_ + 1);
+
+    outpipes_t::iterator it = outpipes.find (blob_t (identity_, size_));
+    if (it == outpipes.end ())
+        return NULL;
+    return &it->second;
+}
+
+void xs::xrep_t::erase_outpipe (pipe_t *pipe_)
+{
+    blob_t identity = pipe_->get_identity ();
+    if (is_generated (identity)) {
+        slots.erase ((unsigned char*) identity.data () + 1);
+        return;
+    }
+
+    outpipes_t::iterator it = outpipes.find (identity);
+    xs_assert (it != outpipes.end () && it->second.pipe == pipe_);
+    outpipes.erase (it);
+}
+
 xs::xrep_session_t::xrep_session_t (io_thread_t *io_thread_, bool connect_,
       socket_base_t *socket_, const options_t &options_,
       const char *protocol_, const char *address_) :
@@ -31,6 +31,8 @@
 #include "blob.hpp"
 #include "msg.hpp"
 #include "fq.hpp"
+#include "envelope.hpp"
+#include "slot_table.hpp"
 
 namespace xs
 {
@@ -58,6 +60,7 @@ namespace xs
         void xread_activated (xs::pipe_t *pipe_);
         void xwrite_activated (xs::pipe_t *pipe_);
         void xterminated (xs::pipe_t *pipe_);
+        uint64_t xdropped ();
 
     private:
 
@@ -83,19 +86,40 @@ namespace xs
             bool active;
         };
 
-        //  Outbound pipes indexed by the peer IDs.
+        //  Outbound pipes of the peers that have set their identities
+        //  explicitly, indexed by the peer IDs.
         typedef std::map <blob_t, outpipe_t> outpipes_t;
         outpipes_t outpipes;
 
+        //  Outbound pipes of the peers with generated identities. Generated
+        //  identity is a zero byte followed by the identity of the slot.
+        typedef slot_table_t <outpipe_t> slots_t;
+        slots_t slots;
+
+        //  Returns true if the identity is a generated one.
+        bool is_generated (const blob_t &identity_);
+
+        //  Returns outbound pipe associated with the identity, NULL if there
+        //  is no such pipe.
+        outpipe_t *find_outpipe (unsigned char *identity_, size_t size_);
+
+        //  Removes the pipe from the outbound pipes.
+        void erase_outpipe (xs::pipe_t *pipe_);
+
         //  The pipe we are currently writing to.
         xs::pipe_t *current_out;
 
         //  If true, more outgoing message parts are expected.
         bool more_out;
 
-        //  Peer ID are generated. It's a simple increment and wrap-over
-        //  algorithm. This value is the next ID to use (if not used already).
-        uint32_t next_peer_id;
+        //  Number of messages dropped because the peer's pipe have reached
+        //  the high watermark.
+        uint64_t drops;
+
+        //  Convert between the separate envelope parts and the envelope
+        //  packed into the body in version 4 of the pattern.
+        envelope_packer_t packer;
+        envelope_unpacker_t unpacker;
 
         xrep_t (const xrep_t&);
         const xrep_t &operator = (const xrep_t&);
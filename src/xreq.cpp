@@ -54,6 +54,21 @@ xs::xreq_t::~xreq_t ()
 int xs::xreq_t::xsetsockopt (int option_, const void *optval_,
     size_t optvallen_)
 {
+    if (option_ == XS_LB_STRATEGY) {
+        if (optvallen_ != sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (!optval_) {
+            errno = EFAULT;
+            return -1;
+        }
+        int rc = lb.set_strategy (*(int*) optval_);
+        if (rc == 0)
+            options.lb_strategy = *(int*) optval_;
+        return rc;
+    }
+
     if (option_ != XS_PATTERN_VERSION) {
         errno = EINVAL;
         return -1;
@@ -70,7 +85,7 @@ int xs::xreq_t::xsetsockopt (int option_, const void *optval_,
     }
 
     int version = *(int *) optval_;
-    if (version != 1) {
+    if (version != 1 && version != 4) {
         errno = EINVAL;
         return -1;
     }
@@ -88,7 +103,60 @@ void xs::xreq_t::xattach_pipe (pipe_t *pipe_, bool icanhasall_)
 
 int xs::xreq_t::xsend (msg_t *msg_, int flags_)
 {
-    return lb.send (msg_, flags_);
+    if (options.sp_version < 4)
+        return lb.send (msg_, flags_);
+
+    //  The envelope is not sent straight away. It's packed into the first
+    //  part of the body instead. Still, if the message can't be sent at the
+    //  moment, fail on its first part, same as with the unpacked envelope.
+    if (packer.empty () && !lb.has_out ()) {
+        errno = EAGAIN;
+        return -1;
+    }
+    int rc = packer.store (msg_);
+    if (rc == 1)
+        return 0;
+    if (rc != 0) {
+        packer.reset ();
+        return -1;
+    }
+
+    bool more = msg_->flags () & msg_t::more ? true : false;
+
+    if (!packer.pending ()) {
+        rc = lb.send (msg_, flags_);
+        if (rc != 0) {
+            packer.reset ();
+            return -1;
+        }
+        packer.sent (more);
+        return 0;
+    }
+
+    msg_t packed;
+    bool packs = packer.pack (msg_, &packed);
+    rc = lb.send (&packed, flags_);
+    if (rc != 0) {
+        packed.close ();
+        packer.reset ();
+        return -1;
+    }
+    packed.close ();
+
+    //  Once the first part of a message is sent, the following parts
+    //  can be sent without blocking.
+    if (packs) {
+        rc = msg_->close ();
+        errno_assert (rc == 0);
+        rc = msg_->init ();
+        errno_assert (rc == 0);
+    }
+    else {
+        rc = lb.send (msg_, flags_);
+        errno_assert (rc == 0);
+    }
+    packer.sent (more);
+    return 0;
 }
 
 int xs::xreq_t::xrecv (msg_t *msg_, int flags_)
@@ -103,7 +171,8 @@ int xs::xreq_t::xrecv (msg_t *msg_, int flags_)
 
     //  XREQ socket doesn't use identities. We can safely drop them.
     while (true) {
-        int rc = fq.recv (msg_, flags_);
+        int rc = options.sp_version < 4 ? fq.recv (msg_, flags_) :
+            unpacker.recvpipe (&fq, msg_, flags_, NULL);
         if (rc != 0)
             return rc;
         if (likely (!(msg_->flags () & msg_t::identity)))
@@ -148,6 +217,11 @@ void xs::xreq_t::xterminated (pipe_t *pipe_)
     lb.terminated (pipe_);
 }
 
+uint64_t xs::xreq_t::xdropped ()
+{
+    return lb.dropped ();
+}
+
 xs::xreq_session_t::xreq_session_t (io_thread_t *io_thread_, bool connect_,
       socket_base_t *socket_, const options_t &options_,
       const char *protocol_, const char *address_) :
@@ -25,6 +25,7 @@
 #include "session_base.hpp"
 #include "fq.hpp"
 #include "lb.hpp"
+#include "envelope.hpp"
 
 namespace xs
 {
@@ -55,6 +56,7 @@ namespace xs
         void xread_activated (xs::pipe_t *pipe_);
         void xwrite_activated (xs::pipe_t *pipe_);
         void xterminated (xs::pipe_t *pipe_);
+        uint64_t xdropped ();
 
     private:
 
@@ -63,6 +65,11 @@ namespace xs
         fq_t fq;
         lb_t lb;
 
+        //  Convert between the separate envelope parts and the envelope
+        //  packed into the body in version 4 of the pattern.
+        envelope_packer_t packer;
+        envelope_unpacker_t unpacker;
+
         //  Have we prefetched a message.
         bool prefetched;
 
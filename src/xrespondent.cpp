@@ -20,8 +20,6 @@
 
 #include "xrespondent.hpp"
 #include "pipe.hpp"
-#include "wire.hpp"
-#include "random.hpp"
 #include "likely.hpp"
 #include "err.hpp"
 
@@ -32,7 +30,7 @@ xs::xrespondent_t::xrespondent_t (class ctx_t *parent_, uint32_t tid_,
     more_in (false),
     current_out (NULL),
     more_out (false),
-    next_peer_id (generate_random ())
+    drops (0)
 {
     options.type = XS_XRESPONDENT;
     options.sp_pattern = SP_SURVEY;
@@ -85,36 +83,30 @@ void xs::xrespondent_t::xattach_pipe (pipe_t *pipe_, bool icanhasall_)
 {
     xs_assert (pipe_);
 
-    //  Add the pipe to the map out outbound pipes.
+    //  Add the pipe to the table of outbound pipes. This generates a new
+    //  unique peer identity.
+    unsigned char identity [outpipes_t::id_size];
     outpipe_t outpipe = {pipe_, true};
-    bool ok = outpipes.insert (outpipes_t::value_type (
-        next_peer_id, outpipe)).second;
-    xs_assert (ok);
+    outpipes.insert (outpipe, identity);
 
     //  Add the pipe to the list of inbound pipes.
-    blob_t identity (4, 0);
-    put_uint32 ((unsigned char*) identity.data (), next_peer_id);
-    pipe_->set_identity (identity);
+    pipe_->set_identity (blob_t (identity, sizeof identity));
     fq.attach (pipe_);
-
-    //  Generate a new unique peer identity.
-    ++next_peer_id;    
 }
 
 void xs::xrespondent_t::xterminated (pipe_t *pipe_)
 {
     fq.terminated (pipe_);
 
-    for (outpipes_t::iterator it = outpipes.begin ();
-          it != outpipes.end (); ++it) {
-        if (it->second.pipe == pipe_) {
-            outpipes.erase (it);
-            if (pipe_ == current_out)
-                current_out = NULL;
-            return;
-        }
-    }
-    xs_assert (false);
+    blob_t identity = pipe_->get_identity ();
+    outpipes.erase ((unsigned char*) identity.data ());
+    if (pipe_ == current_out)
+        current_out = NULL;
+}
+
+uint64_t xs::xrespondent_t::xdropped ()
+{
+    return drops;
 }
 
 void xs::xrespondent_t::xread_activated (pipe_t *pipe_)
@@ -124,15 +116,11 @@ void xs::xrespondent_t::xread_activated (pipe_t *pipe_)
 
 void xs::xrespondent_t::xwrite_activated (pipe_t *pipe_)
 {
-    for (outpipes_t::iterator it = outpipes.begin ();
-          it != outpipes.end (); ++it) {
-        if (it->second.pipe == pipe_) {
-            xs_assert (!it->second.active);
-            it->second.active = true;
-            return;
-        }
-    }
-    xs_assert (false);
+    blob_t identity = pipe_->get_identity ();
+    outpipe_t *outpipe = outpipes.find ((unsigned char*) identity.data ());
+    xs_assert (outpipe && outpipe->pipe == pipe_);
+    xs_assert (!outpipe->active);
+    outpipe->active = true;
 }
 
 int xs::xrespondent_t::xsend (msg_t *msg_, int flags_)
@@ -145,24 +133,25 @@ int xs::xrespondent_t::xsend (msg_t *msg_, int flags_)
         //  If we have malformed message (prefix with no subsequent message)
         //  then just silently ignore it.
         //  TODO: The connections should be killed instead.
-        if (msg_->flags () & msg_t::more && msg_->size () == 4) {
+        if (msg_->flags () & msg_t::more &&
+              msg_->size () == outpipes_t::id_size) {
 
             more_out = true;
 
             //  Find the pipe associated with the identity stored in the prefix.
             //  If there's no such pipe just silently ignore the message.
-            uint32_t identity = get_uint32 ((unsigned char*) msg_->data ());
-            outpipes_t::iterator it = outpipes.find (identity);
+            outpipe_t *outpipe = outpipes.find ((unsigned char*) msg_->data ());
 
-            if (it != outpipes.end ()) {
-                current_out = it->second.pipe;
+            if (outpipe) {
+                current_out = outpipe->pipe;
                 msg_t empty;
                 int rc = empty.init ();
                 errno_assert (rc == 0);
                 if (!current_out->check_write (&empty)) {
-                    it->second.active = false;
+                    outpipe->active = false;
                     more_out = false;
                     current_out = NULL;
+                    drops++;
                 }
                 rc = empty.close ();
                 errno_assert (rc == 0);
@@ -183,8 +172,10 @@ int xs::xrespondent_t::xsend (msg_t *msg_, int flags_)
     //  Push the message into the pipe. If there's no out pipe, just drop it.
     if (current_out) {
         bool ok = current_out->write (msg_);
-        if (unlikely (!ok))
+        if (unlikely (!ok)) {
             current_out = NULL;
+            drops++;
+        }
         else if (!more_out) {
             current_out->flush ();
             current_out = NULL;
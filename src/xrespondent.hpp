@@ -21,14 +21,13 @@
 #ifndef __XS_XRESPONDENT_HPP_INCLUDED__
 #define __XS_XRESPONDENT_HPP_INCLUDED__
 
-#include <map>
-
 #include "socket_base.hpp"
 #include "session_base.hpp"
 #include "stdint.hpp"
 #include "blob.hpp"
 #include "msg.hpp"
 #include "fq.hpp"
+#include "slot_table.hpp"
 
 namespace xs
 {
@@ -56,6 +55,7 @@ namespace xs
         void xread_activated (xs::pipe_t *pipe_);
         void xwrite_activated (xs::pipe_t *pipe_);
         void xterminated (xs::pipe_t *pipe_);
+        uint64_t xdropped ();
 
     protected:
 
@@ -86,8 +86,8 @@ namespace xs
             bool active;
         };
 
-        //  Outbound pipes indexed by the peer IDs.
-        typedef std::map <uint32_t, outpipe_t> outpipes_t;
+        //  Outbound pipes indexed by the generated peer IDs.
+        typedef slot_table_t <outpipe_t> outpipes_t;
         outpipes_t outpipes;
 
         //  The pipe we are currently writing to.
@@ -96,9 +96,9 @@ namespace xs
         //  If true, more outgoing message parts are expected.
         bool more_out;
 
-        //  Peer ID are generated. It's a simple increment and wrap-over
-        //  algorithm. This value is the next ID to use (if not used already).
-        uint32_t next_peer_id;
+        //  Number of messages dropped because the peer's pipe have reached
+        //  the high watermark.
+        uint64_t drops;
 
         xrespondent_t (const xrespondent_t&);
         const xrespondent_t &operator = (const xrespondent_t&);
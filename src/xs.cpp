@@ -42,6 +42,7 @@
 #include "err.hpp"
 #include "msg.hpp"
 #include "fd.hpp"
+#include "trace.hpp"
 
 #if defined XS_HAVE_OPENPGM
 #define __PGM_WININT_H__
@@ -148,6 +149,16 @@ int xs_setctxopt (void *ctx_, int option_, const void *optval_,
     return ((xs::ctx_t*) ctx_)->setctxopt (option_, optval_, optvallen_);
 }
 
+int xs_getctxopt (void *ctx_, int option_, void *optval_, size_t *optvallen_)
+{
+    if (!ctx_ || !((xs::ctx_t*) ctx_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+
+    return ((xs::ctx_t*) ctx_)->getctxopt (option_, optval_, optvallen_);
+}
+
 void *xs_socket (void *ctx_, int type_)
 {
     if (!ctx_ || !((xs::ctx_t*) ctx_)->check_tag ()) {
@@ -352,6 +363,18 @@ int xs_getmsgopt (xs_msg_t *msg_, int option_, void *optval_,
             (((xs::msg_t*) msg_)->flags () & xs::msg_t::more) ? 1 : 0;
         *optvallen_ = sizeof (int);
         return 0;
+    case XS_AGE:
+        {
+            if (*optvallen_ < sizeof (unsigned long long)) {
+                errno = EINVAL;
+                return -1;
+            }
+            xs::msg_t *msg = (xs::msg_t*) msg_;
+            *((unsigned long long*) optval_) = msg->is_stamped () ?
+                xs::clock_t::now_ns () - msg->origin_stamp () : 0;
+            *optvallen_ = sizeof (unsigned long long);
+            return 0;
+        }
     default:
         errno = EINVAL;
         return -1;
@@ -389,3 +412,23 @@ unsigned long xs_stopwatch_stop (void *watch_)
     return (unsigned long) (end - start);
 }
 
+int xs_trace_start (int size_)
+{
+    return xs::trace_start (size_);
+}
+
+int xs_trace_stop ()
+{
+    xs::trace_stop ();
+    return 0;
+}
+
+int xs_trace_dump (const char *filename_)
+{
+    if (!filename_) {
+        errno = EFAULT;
+        return -1;
+    }
+    return xs::trace_dump (filename_);
+}
+
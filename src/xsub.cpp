@@ -49,6 +49,32 @@ xs::xsub_t::~xsub_t ()
 int xs::xsub_t::xsetsockopt (int option_, const void *optval_,
     size_t optvallen_)
 {
+    if (option_ == XS_FILTER_AGGREGATE) {
+        if (optvallen_ != sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (!optval_) {
+            errno = EFAULT;
+            return -1;
+        }
+        int val = *(int*) optval_;
+        if (val < -1) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        //  Subscriptions already forwarded upstream would not match
+        //  the new aggregation. Thus the option has to be set beforehand.
+        if (!subscriptions.empty ()) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        options.filter_aggregate = val;
+        return 0;
+    }
+
     if (option_ != XS_PATTERN_VERSION) {
         errno = EINVAL;
         return -1;
@@ -95,11 +121,7 @@ void xs::xsub_t::xattach_pipe (pipe_t *pipe_, bool icanhasall_)
     dist.attach (pipe_);
 
     //  Send all the cached subscriptions to the new upstream peer.
-    for (subscriptions_t::iterator its = subscriptions.begin ();
-          its != subscriptions.end (); ++its)
-        send_subscription (pipe_, true, its->first.first,
-            its->first.second.data (), its->first.second.size ());
-    pipe_->flush ();
+    send_subscriptions (pipe_);
 }
 
 void xs::xsub_t::xread_activated (pipe_t *pipe_)
@@ -119,6 +141,11 @@ void xs::xsub_t::xterminated (pipe_t *pipe_)
         dist.terminated (pipe_);
 }
 
+uint64_t xs::xsub_t::xdropped ()
+{
+    return dist.dropped ();
+}
+
 void xs::xsub_t::xhiccuped (pipe_t *pipe_)
 {
     //  In 0MQ/2.1 protocol there is no subscription forwarding.
@@ -126,11 +153,7 @@ void xs::xsub_t::xhiccuped (pipe_t *pipe_)
         return;
 
     //  Send all the cached subscriptions to the new upstream peer.
-    for (subscriptions_t::iterator its = subscriptions.begin ();
-          its != subscriptions.end (); ++its)
-        send_subscription (pipe_, true, its->first.first,
-            its->first.second.data (), its->first.second.size ());
-    pipe_->flush ();
+    send_subscriptions (pipe_);
 }
 
 int xs::xsub_t::xsend (msg_t *msg_, int flags_)
@@ -155,8 +178,19 @@ int xs::xsub_t::xsend (msg_t *msg_, int flags_)
            std::make_pair (std::make_pair (filter_id,
            blob_t (data + 4, size - 4)), 0)).first;
         ++it->second;
-        if (it->second == 1)
-            return dist.send_to_all (msg_, flags_);
+        if (it->second == 1) {
+            if (!aggregated (filter_id, size - 4))
+                return dist.send_to_all (msg_, flags_);
+
+            //  Forward the covering prefix unless it was already forwarded
+            //  for a different subscription.
+            blob_t cover (data + 4, options.filter_aggregate);
+            subscriptions_t::iterator itc = covering.insert (
+                std::make_pair (std::make_pair (filter_id, cover), 0)).first;
+            ++itc->second;
+            if (itc->second == 1)
+                return send_covering (msg_, flags_, true, filter_id, cover);
+        }
     }
     else if (cmd == SP_PUBSUB_CMD_UNSUBSCRIBE) {
         subscriptions_t::iterator it = subscriptions.find (
@@ -166,7 +200,21 @@ int xs::xsub_t::xsend (msg_t *msg_, int flags_)
             --it->second;
             if (!it->second) {
                 subscriptions.erase (it);
-                return dist.send_to_all (msg_, flags_);
+                if (!aggregated (filter_id, size - 4))
+                    return dist.send_to_all (msg_, flags_);
+
+                //  Withdraw the covering prefix once there are no more
+                //  subscriptions it covers.
+                blob_t cover (data + 4, options.filter_aggregate);
+                subscriptions_t::iterator itc = covering.find (
+                    std::make_pair (filter_id, cover));
+                xs_assert (itc != covering.end () && itc->second);
+                --itc->second;
+                if (!itc->second) {
+                    covering.erase (itc);
+                    return send_covering (msg_, flags_, false, filter_id,
+                        cover);
+                }
             }
         }
     }
@@ -218,6 +266,46 @@ void xs::xsub_t::send_subscription (pipe_t *pipe_, bool subscribe_,
         msg.close ();
 }
 
+void xs::xsub_t::send_subscriptions (pipe_t *pipe_)
+{
+    //  Subscriptions that are not aggregated are sent verbatim.
+    for (subscriptions_t::iterator its = subscriptions.begin ();
+          its != subscriptions.end (); ++its)
+        if (!aggregated (its->first.first, its->first.second.size ()))
+            send_subscription (pipe_, true, its->first.first,
+                its->first.second.data (), its->first.second.size ());
+
+    //  The rest is represented by the covering prefixes.
+    for (subscriptions_t::iterator its = covering.begin ();
+          its != covering.end (); ++its)
+        send_subscription (pipe_, true, its->first.first,
+            its->first.second.data (), its->first.second.size ());
+
+    pipe_->flush ();
+}
+
+bool xs::xsub_t::aggregated (int filter_id_, size_t size_)
+{
+    //  Only prefix subscriptions can be safely replaced by shorter ones.
+    return options.filter_aggregate >= 0 && filter_id_ == XS_FILTER_PREFIX &&
+        size_ > (size_t) options.filter_aggregate;
+}
+
+int xs::xsub_t::send_covering (msg_t *msg_, int flags_, bool subscribe_,
+    int filter_id_, const blob_t &cover_)
+{
+    int rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init_size (cover_.size () + 4);
+    errno_assert (rc == 0);
+    unsigned char *data = (unsigned char*) msg_->data ();
+    put_uint16 (data, subscribe_ ? SP_PUBSUB_CMD_SUBSCRIBE :
+        SP_PUBSUB_CMD_UNSUBSCRIBE);
+    put_uint16 (data + 2, filter_id_);
+    memcpy (data + 4, cover_.data (), cover_.size ());
+    return dist.send_to_all (msg_, flags_);
+}
+
 xs::xsub_session_t::xsub_session_t (io_thread_t *io_thread_, bool connect_,
       socket_base_t *socket_, const options_t &options_,
       const char *protocol_, const char *address_) :
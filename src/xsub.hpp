@@ -57,12 +57,25 @@ namespace xs
         void xwrite_activated (xs::pipe_t *pipe_);
         void xhiccuped (pipe_t *pipe_);
         void xterminated (xs::pipe_t *pipe_);
+        uint64_t xdropped ();
 
     private:
 
         void send_subscription (pipe_t *pipe_, bool subscribe_, int filter_id_,
             const unsigned char *data_, size_t size_);
 
+        //  Sends all the cached subscriptions to the upstream peer.
+        void send_subscriptions (pipe_t *pipe_);
+
+        //  Returns true if the subscription is forwarded upstream in the form
+        //  of its covering prefix rather than verbatim.
+        bool aggregated (int filter_id_, size_t size_);
+
+        //  Replaces the content of the message by the (un)subscription and
+        //  sends it upstream.
+        int send_covering (msg_t *msg_, int flags_, bool subscribe_,
+            int filter_id_, const blob_t &cover_);
+
         //  Fair queueing object for inbound pipes.
         fq_t fq;
 
@@ -73,6 +86,10 @@ namespace xs
         typedef std::map <std::pair <int, blob_t>, int> subscriptions_t;
         subscriptions_t subscriptions;
 
+        //  Covering prefixes forwarded upstream instead of the aggregated
+        //  subscriptions, each with the number of subscriptions it covers.
+        subscriptions_t covering;
+
         xsub_t (const xsub_t&);
         const xsub_t &operator = (const xsub_t&);
     };
@@ -112,6 +112,16 @@ void xs::xsurveyor_t::xterminated (pipe_t *pipe_)
     dist.terminated (pipe_);
 }
 
+uint64_t xs::xsurveyor_t::xdropped ()
+{
+    return dist.dropped ();
+}
+
+int xs::xsurveyor_t::delivered ()
+{
+    return dist.delivered ();
+}
+
 xs::xsurveyor_session_t::xsurveyor_session_t (io_thread_t *io_thread_,
       bool connect_, socket_base_t *socket_, const options_t &options_,
       const char *protocol_, const char *address_) :
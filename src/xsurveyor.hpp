@@ -54,6 +54,10 @@ namespace xs
         void xread_activated (xs::pipe_t *pipe_);
         void xwrite_activated (xs::pipe_t *pipe_);
         void xterminated (xs::pipe_t *pipe_);
+        uint64_t xdropped ();
+
+        //  Number of peers the last message was delivered to.
+        int delivered ();
 
     private:
 
@@ -23,6 +23,7 @@
 #define __XS_YPIPE_HPP_INCLUDED__
 
 #include "atomic_ptr.hpp"
+#include "ypipe_base.hpp"
 #include "yqueue.hpp"
 #include "platform.hpp"
 
@@ -36,12 +37,13 @@ namespace xs
     //  N is granularity of the pipe, i.e. how many items are needed to
     //  perform next memory allocation.
 
-    template <typename T, int N> class ypipe_t
+    template <typename T, int N> class ypipe_t : public ypipe_base_t <T>
     {
     public:
 
         //  Initialises the pipe.
-        inline ypipe_t ()
+        inline ypipe_t () :
+            ypipe_base_t <T> (false)
         {
             //  Insert terminator element into the queue.
             queue.push ();
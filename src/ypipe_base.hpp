@@ -0,0 +1,55 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __XS_YPIPE_BASE_HPP_INCLUDED__
+#define __XS_YPIPE_BASE_HPP_INCLUDED__
+
+namespace xs
+{
+
+    //  Base shared by the lock-free pipe implementations (ypipe_t,
+    //  yring_t). It allows a message pipe to pick its underlying queue at
+    //  runtime. There are no virtual functions. Instead, the users check
+    //  the flag and call the actual implementation directly.
+
+    template <typename T> class ypipe_base_t
+    {
+    public:
+
+        inline ypipe_base_t (bool ring_) :
+            ring (ring_)
+        {
+        }
+
+        //  True if the object is yring_t, false if it is ypipe_t.
+        const bool ring;
+
+    protected:
+
+        //  The object has to be deleted via pointer to the actual type.
+        inline ~ypipe_base_t ()
+        {
+        }
+    };
+
+}
+
+#endif
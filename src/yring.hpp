@@ -0,0 +1,381 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __XS_YRING_HPP_INCLUDED__
+#define __XS_YRING_HPP_INCLUDED__
+
+#include <new>
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "atomic_ptr.hpp"
+#include "ypipe_base.hpp"
+#include "platform.hpp"
+#include "err.hpp"
+
+namespace xs
+{
+
+    //  Lock-free pipe backed by a preallocated circular buffer. It has the
+    //  same semantics as ypipe_t, but in the steady state it never
+    //  allocates memory and consecutive items are stored in the same block
+    //  of memory, which is reused over and over again. It is meant for
+    //  pipes where the number of items in flight is bounded (e.g. by HWM).
+    //  If the writer still runs out of space (say, a long multi-part
+    //  message is being written) a ring twice the size is allocated and
+    //  chained after the current one. The reader switches to it once the
+    //  old ring is drained. Thus, the capacity is a hint, not a limit.
+    //  Only a single thread can read from the pipe at any specific moment.
+    //  Only a single thread can write to the pipe at any specific moment.
+
+    template <typename T> class yring_t : public ypipe_base_t <T>
+    {
+    public:
+
+        //  Initialises the pipe with a ring of the specified capacity.
+        //  One slot of the ring is always left empty.
+        inline yring_t (size_t capacity_) :
+            ypipe_base_t <T> (true)
+        {
+            wring = rring = new_ring (capacity_ < 16 ? 16 : capacity_);
+            wpos = rpos = wring->items;
+            wfree = wring->size - 1;
+            ravail = 0;
+            unreported = 0;
+
+            //  Let all the pointers to point to the first slot.
+            r = w = f = wring->items;
+            c.set (wring->items);
+        }
+
+        inline ~yring_t ()
+        {
+            while (rring) {
+                ring_t *next = rring->next;
+                delete_ring (rring);
+                rring = next;
+            }
+        }
+
+#ifdef XS_HAVE_OPENVMS
+#pragma message save
+#pragma message disable(UNINIT)
+#endif
+
+        //  Write an item to the pipe.  Don't flush it yet. If incomplete is
+        //  set to true the item is assumed to be continued by items
+        //  subsequently written to the pipe. Incomplete items are never
+        //  flushed down the stream.
+        inline void write (const T &value_, bool incomplete_)
+        {
+            //  Make sure there's a free slot. The reader's position has to
+            //  be checked only once the free space known so far is used up.
+            if (unlikely (!wfree)) {
+                refresh ();
+                if (!wfree)
+                    grow ();
+            }
+
+            *wpos = value_;
+            if (unlikely (++wpos == wring->limit))
+                wpos = wring->items;
+            --wfree;
+
+            //  Move the "flush up to here" poiter.
+            if (!incomplete_)
+                f = wpos;
+        }
+
+#ifdef XS_HAVE_OPENVMS
+#pragma message restore
+#endif
+
+        //  Pop an incomplete item from the pipe. Returns true is such
+        //  item exists, false otherwise.
+        inline bool unwrite (T *value_)
+        {
+            if (f == wpos)
+                return false;
+
+            //  If the first un-flushed item is not in this ring and we are at
+            //  its beginning, nothing was written to this ring yet.
+            if (wpos == wring->items && !owns (wring, f)) {
+
+                //  No incomplete items were left in the previous ring.
+                if (!wring->prev)
+                    return false;
+
+                //  Drop the empty ring and get back to the previous one.
+                //  The reader haven't seen the ring yet so it's safe to do so.
+                ring_t *prev = wring->prev;
+                prev->next = NULL;
+                delete_ring (wring);
+                wring = prev;
+                wpos = prev->end;
+                wfree = 0;
+            }
+
+            if (wpos == wring->items)
+                wpos = wring->limit;
+            --wpos;
+            ++wfree;
+            *value_ = *wpos;
+            return true;
+        }
+
+        //  Flush all the completed items into the pipe. Returns false if
+        //  the reader thread is sleeping. In that case, caller is obliged to
+        //  wake the reader up before using the pipe again.
+        inline bool flush ()
+        {
+            //  If there are no un-flushed items, do nothing.
+            if (w == f)
+                return true;
+
+            //  Try to set 'c' to 'f'. If it fails, the reader is asleep.
+            //  See ypipe_t::flush for details.
+            if (c.cas (w, f) != w) {
+                c.set (f);
+                w = f;
+                return false;
+            }
+
+            w = f;
+            return true;
+        }
+
+        //  Check whether item is available for reading.
+        inline bool check_read ()
+        {
+            //  Was the value prefetched already? If so, return.
+            if (ravail)
+                return true;
+
+            //  Items up to 'r' were already read. Switch to the next ring
+            //  if needed.
+            follow ();
+            if (rpos != r && r) {
+                ravail = available ();
+                return true;
+            }
+
+            //  There's no prefetched value, so let us prefetch more values.
+            //  If there are no items to prefetch, set c to NULL.
+            r = c.cas (rpos, NULL);
+
+            //  Compare-and-swap is a full memory barrier, so all the items
+            //  read so far are guaranteed to be copied out of the ring.
+            //  It's safe to let the writer reuse their slots.
+            rring->head.set (rpos);
+            unreported = 0;
+
+            //  If there are no elements prefetched, exit.
+            if (rpos == r || !r)
+                return false;
+
+            //  There was at least one value prefetched.
+            follow ();
+            ravail = available ();
+            return true;
+        }
+
+        //  Reads an item from the pipe. Returns false if there is no value.
+        //  available.
+        inline bool read (T *value_)
+        {
+            //  Try to prefetch a value.
+            if (unlikely (!ravail) && !check_read ())
+                return false;
+
+            *value_ = *rpos;
+            if (unlikely (++rpos == rring->limit))
+                rpos = rring->items;
+            --ravail;
+
+            //  Let the writer know about the freed slots once in a while.
+            //  Exchange is used to get a memory barrier.
+            if (unlikely (++unreported == rring->batch)) {
+                rring->head.xchg (rpos);
+                unreported = 0;
+            }
+
+            return true;
+        }
+
+        //  Applies the function fn to the first elemenent in the pipe
+        //  and returns the value returned by the fn.
+        //  The pipe mustn't be empty or the function crashes.
+        inline bool probe (bool (*fn)(T &))
+        {
+                bool rc = check_read ();
+                xs_assert (rc);
+
+                return (*fn) (*rpos);
+        }
+
+    private:
+
+        //  A single circular buffer.
+        struct ring_t
+        {
+            T *items;
+            T *limit;
+            size_t size;
+
+            //  Number of items read after which the reader reports its
+            //  position to the writer.
+            size_t batch;
+
+            //  First slot not yet read. Written by the reader, read by the
+            //  writer when it runs out of space.
+            atomic_ptr_t <T> head;
+
+            //  Following ring and the slot past the last item written to
+            //  this ring. Valid only once the writer have moved to the next
+            //  ring and the reader have seen an item from it.
+            ring_t *next;
+            T *end;
+
+            //  Previous ring, if it contains incomplete items. Used
+            //  exclusively by writer thread.
+            ring_t *prev;
+        };
+
+        static inline ring_t *new_ring (size_t size_)
+        {
+            ring_t *ring = new (std::nothrow) ring_t;
+            alloc_assert (ring);
+            ring->items = (T*) malloc (size_ * sizeof (T));
+            alloc_assert (ring->items);
+            ring->limit = ring->items + size_;
+            ring->size = size_;
+            ring->batch = size_ / 8;
+            ring->head.set (ring->items);
+            ring->next = NULL;
+            ring->end = NULL;
+            ring->prev = NULL;
+            return ring;
+        }
+
+        static inline void delete_ring (ring_t *ring_)
+        {
+            free (ring_->items);
+            delete ring_;
+        }
+
+        static inline bool owns (ring_t *ring_, T *item_)
+        {
+            return item_ >= ring_->items && item_ < ring_->limit;
+        }
+
+        //  Returns number of slots between the two positions in the ring.
+        static inline size_t distance (ring_t *ring_, T *from_, T *to_)
+        {
+            return to_ >= from_ ? to_ - from_ : ring_->size - (from_ - to_);
+        }
+
+        //  Number of prefetched items in the reader's ring.
+        inline size_t available ()
+        {
+            return distance (rring, rpos, owns (rring, r) ? r : rring->end);
+        }
+
+        //  If the writer have already moved to a following ring and
+        //  the current one is drained, moves the reader to the following
+        //  ring. Deallocates the drained rings.
+        inline void follow ()
+        {
+            while (r && !owns (rring, r) && rpos == rring->end) {
+                ring_t *old = rring;
+                rring = old->next;
+                rpos = rring->items;
+                unreported = 0;
+                delete_ring (old);
+            }
+        }
+
+        //  Re-computes the free space in the writer's ring from the last
+        //  position reported by the reader. One slot is always left empty
+        //  so that a full ring can't be mistaken for an empty one.
+        inline void refresh ()
+        {
+            //  Compare-and-swap is used to read the pointer with a memory
+            //  barrier. The head is never NULL so it's left unchanged.
+            T *head = wring->head.cas (NULL, NULL);
+            wfree = wring->size - 1 - distance (wring, head, wpos);
+        }
+
+        //  Chains a new, twice as big ring after the current one.
+        inline void grow ()
+        {
+            ring_t *ring = new_ring (wring->size * 2);
+            wring->end = wpos;
+            wring->next = ring;
+            if (f != wpos)
+                ring->prev = wring;
+            wring = ring;
+            wpos = ring->items;
+            wfree = ring->size - 1;
+        }
+
+        //  Ring being written to, slot for the next item and the number of
+        //  slots known to be free. Used exclusively by writer thread.
+        ring_t *wring;
+        T *wpos;
+        size_t wfree;
+
+        //  Ring being read from, next item to read and the number of
+        //  prefetched items left in the ring. Used exclusively by reader
+        //  thread.
+        ring_t *rring;
+        T *rpos;
+        size_t ravail;
+
+        //  Number of items read since the position was last reported to
+        //  the writer.
+        size_t unreported;
+
+        //  Points to the first un-flushed item. This variable is used
+        //  exclusively by writer thread.
+        T *w;
+
+        //  Points to the first un-prefetched item. This variable is used
+        //  exclusively by reader thread.
+        T *r;
+
+        //  Points to the first item to be flushed in the future.
+        T *f;
+
+        //  The single point of contention between writer and reader thread.
+        //  Points past the last flushed item. If it is NULL, reader is
+        //  asleep. Unlike in ypipe_t, it may point to a different ring than
+        //  the one being read from. This pointer should be always accessed
+        //  using atomic operations.
+        atomic_ptr_t <T> c;
+
+        //  Disable copying of yring object.
+        yring_t (const yring_t&);
+        const yring_t &operator = (const yring_t&);
+    };
+
+}
+
+#endif
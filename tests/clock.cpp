@@ -0,0 +1,104 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    int rc;
+    int val;
+    size_t size;
+    char buf [32];
+
+    fprintf (stderr, "clock test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+
+    val = 2;
+    rc = xs_setctxopt (ctx, XS_CLOCK, &val, sizeof (val));
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Asking for the system clock succeeds as long as it is in use.
+    val = XS_CLOCK_SYSTEM;
+    rc = xs_setctxopt (ctx, XS_CLOCK, &val, sizeof (val));
+    errno_assert (rc == 0);
+
+    //  The clock is calibrated when the option is set. Whether the TSC can
+    //  be used depends on the hardware.
+    val = XS_CLOCK_TSC;
+    rc = xs_setctxopt (ctx, XS_CLOCK, &val, sizeof (val));
+    assert (rc == 0 || errno == ENOTSUP);
+    bool tsc = rc == 0;
+    size = sizeof (val);
+    rc = xs_getctxopt (ctx, XS_CLOCK, &val, &size);
+    errno_assert (rc == 0);
+    assert (size == sizeof (val));
+    assert (val == (tsc ? XS_CLOCK_TSC : XS_CLOCK_SYSTEM));
+    int clock = val;
+
+    //  There's no way back from the TSC-based clock.
+    val = XS_CLOCK_SYSTEM;
+    rc = xs_setctxopt (ctx, XS_CLOCK, &val, sizeof (val));
+    if (tsc)
+        assert (rc == -1 && errno == ENOTSUP);
+    else
+        errno_assert (rc == 0);
+
+    //  Creating a socket doesn't change the clock in use.
+    void *pull = xs_socket (ctx, XS_PULL);
+    errno_assert (pull);
+    size = sizeof (val);
+    rc = xs_getctxopt (ctx, XS_CLOCK, &val, &size);
+    errno_assert (rc == 0);
+    assert (val == clock);
+
+    //  Time never goes backwards, not even when the clock is resynchronised
+    //  with the system clock.
+    unsigned long elapsed = 0;
+    while (elapsed < 300000) {
+        void *watch = xs_stopwatch_start ();
+        for (int i = 0; i != 10000; i++) {
+            void *tick = xs_stopwatch_start ();
+            assert (xs_stopwatch_stop (tick) < 1000000);
+        }
+        unsigned long round = xs_stopwatch_stop (watch);
+        assert (round < 1000000);
+        elapsed += round;
+    }
+
+    //  Timeouts measured by the clock match the physical time.
+    val = 500;
+    rc = xs_setsockopt (pull, XS_RCVTIMEO, &val, sizeof (val));
+    errno_assert (rc == 0);
+    rc = xs_bind (pull, "inproc://a");
+    errno_assert (rc != -1);
+    void *watch = xs_stopwatch_start ();
+    rc = xs_recv (pull, buf, sizeof (buf), 0);
+    assert (rc == -1 && errno == EAGAIN);
+    elapsed = xs_stopwatch_stop (watch) / 1000;
+    time_assert (elapsed, 500);
+
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
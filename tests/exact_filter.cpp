@@ -0,0 +1,117 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static void subscribe (void *s_, bool subscribe_, const char *key_)
+{
+    unsigned char buf [32];
+    size_t size = strlen (key_);
+    assert (size + 4 <= sizeof (buf));
+    buf [0] = 0;
+    buf [1] = subscribe_ ? 1 : 2;
+    buf [2] = 0;
+    buf [3] = XS_FILTER_EXACT;
+    memcpy (buf + 4, key_, size);
+    int rc = xs_send (s_, buf, size + 4, 0);
+    errno_assert (rc == (int) size + 4);
+}
+
+int XS_TEST_MAIN ()
+{
+    fprintf (stderr, "exact_filter test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+    void *xpub = xs_socket (ctx, XS_XPUB);
+    errno_assert (xpub);
+    int rc = xs_bind (xpub, "inproc://a");
+    errno_assert (rc != -1);
+    void *xsub = xs_socket (ctx, XS_XSUB);
+    errno_assert (xsub);
+    rc = xs_connect (xsub, "inproc://a");
+    errno_assert (rc != -1);
+    void *sub = xs_socket (ctx, XS_SUB);
+    errno_assert (sub);
+    int filter = XS_FILTER_EXACT;
+    rc = xs_setsockopt (sub, XS_FILTER, &filter, sizeof (filter));
+    errno_assert (rc == 0);
+    rc = xs_connect (sub, "inproc://a");
+    errno_assert (rc != -1);
+
+    //  Subscribe for enough keys to make the hash table grow. Keys of
+    //  different lengths are used.
+    char key [16];
+    for (int i = 0; i != 100; i++) {
+        sprintf (key, "K%04d", i);
+        subscribe (xsub, true, key);
+    }
+    subscribe (xsub, true, "IBM");
+    for (int i = 0; i != 100; i += 2) {
+        sprintf (key, "K%04d", i);
+        subscribe (xsub, false, key);
+    }
+    rc = xs_setsockopt (sub, XS_SUBSCRIBE, "AAPL", 4);
+    errno_assert (rc == 0);
+
+    //  Wait till the subscriptions get to the publisher.
+    char buf [32];
+    for (int i = 0; i != 152; i++) {
+        rc = xs_recv (xpub, buf, sizeof (buf), 0);
+        errno_assert (rc > 4);
+    }
+
+    //  Publish messages. Only leading bytes of the message are compared to
+    //  the subscribed keys.
+    const char *msgs [] = {"K0002", "K0003x", "K003", "IBM", "IB", "AAPL.O",
+        "AAP", "K0099", NULL};
+    for (int i = 0; msgs [i]; i++) {
+        rc = xs_send (xpub, msgs [i], strlen (msgs [i]), 0);
+        errno_assert (rc == (int) strlen (msgs [i]));
+    }
+
+    //  The XSUB socket gets only the messages it's subscribed to.
+    rc = xs_recv (xsub, buf, sizeof (buf), 0);
+    errno_assert (rc == 6);
+    assert (memcmp (buf, "K0003x", 6) == 0);
+    rc = xs_recv (xsub, buf, sizeof (buf), 0);
+    errno_assert (rc == 3);
+    assert (memcmp (buf, "IBM", 3) == 0);
+    rc = xs_recv (xsub, buf, sizeof (buf), 0);
+    errno_assert (rc == 5);
+    assert (memcmp (buf, "K0099", 5) == 0);
+
+    //  So does the SUB socket.
+    rc = xs_recv (sub, buf, sizeof (buf), 0);
+    errno_assert (rc == 6);
+    assert (memcmp (buf, "AAPL.O", 6) == 0);
+
+    //  Clean up.
+    rc = xs_close (sub);
+    errno_assert (rc == 0);
+    rc = xs_close (xsub);
+    errno_assert (rc == 0);
+    rc = xs_close (xpub);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
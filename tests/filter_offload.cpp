@@ -0,0 +1,264 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    fprintf (stderr, "filter_offload test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+
+    //  The option is available only for publisher sockets.
+    void *xsub_tcp = xs_socket (ctx, XS_XSUB);
+    errno_assert (xsub_tcp);
+    int offload = 1;
+    int rc = xs_setsockopt (xsub_tcp, XS_FILTER_OFFLOAD, &offload,
+        sizeof (offload));
+    assert (rc == -1 && xs_errno () == ENOTSUP);
+
+    //  Create a publisher with filtering offloaded to the I/O threads.
+    void *xpub = xs_socket (ctx, XS_XPUB);
+    errno_assert (xpub);
+    rc = xs_setsockopt (xpub, XS_FILTER_OFFLOAD, &offload, sizeof (offload));
+    errno_assert (rc == 0);
+    offload = 0;
+    size_t offloadsz = sizeof (offload);
+    rc = xs_getsockopt (xpub, XS_FILTER_OFFLOAD, &offload, &offloadsz);
+    errno_assert (rc == 0);
+    assert (offload == 1);
+    rc = xs_bind (xpub, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+    rc = xs_bind (xpub, "inproc://a");
+    errno_assert (rc != -1);
+
+    //  Connect one subscriber via TCP and one via inproc. The latter is
+    //  still matched by the socket itself.
+    rc = xs_connect (xsub_tcp, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+    void *xsub_inproc = xs_socket (ctx, XS_XSUB);
+    errno_assert (xsub_inproc);
+    rc = xs_connect (xsub_inproc, "inproc://a");
+    errno_assert (rc != -1);
+
+    //  Subscribe for different topics.
+    unsigned char sub [5] = {0, 1, 0, 1, 'a'};
+    rc = xs_send (xsub_tcp, sub, sizeof (sub), 0);
+    errno_assert (rc == 5);
+    sub [4] = 'b';
+    rc = xs_send (xsub_inproc, sub, sizeof (sub), 0);
+    errno_assert (rc == 5);
+
+    //  Wait till both subscriptions get to the publisher.
+    char buf [5];
+    rc = xs_recv (xpub, buf, sizeof (buf), 0);
+    errno_assert (rc == 5);
+    rc = xs_recv (xpub, buf, sizeof (buf), 0);
+    errno_assert (rc == 5);
+    sleep (1);
+
+    //  Publish messages, including a multi-part one.
+    rc = xs_send (xpub, "c", 1, 0);
+    errno_assert (rc == 1);
+    rc = xs_send (xpub, "b", 1, XS_SNDMORE);
+    errno_assert (rc == 1);
+    rc = xs_send (xpub, "x", 1, 0);
+    errno_assert (rc == 1);
+    rc = xs_send (xpub, "a", 1, XS_SNDMORE);
+    errno_assert (rc == 1);
+    rc = xs_send (xpub, "y", 1, 0);
+    errno_assert (rc == 1);
+    rc = xs_send (xpub, "c", 1, 0);
+    errno_assert (rc == 1);
+
+    //  Each subscriber should get only the message it's subscribed to.
+    int timeo = 500;
+    rc = xs_setsockopt (xsub_tcp, XS_RCVTIMEO, &timeo, sizeof (timeo));
+    errno_assert (rc == 0);
+    rc = xs_setsockopt (xsub_inproc, XS_RCVTIMEO, &timeo, sizeof (timeo));
+    errno_assert (rc == 0);
+
+    rc = xs_recv (xsub_tcp, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+    assert (buf [0] == 'a');
+    rc = xs_recv (xsub_tcp, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+    assert (buf [0] == 'y');
+    rc = xs_recv (xsub_tcp, buf, sizeof (buf), 0);
+    assert (rc == -1 && xs_errno () == EAGAIN);
+
+    rc = xs_recv (xsub_inproc, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+    assert (buf [0] == 'b');
+    rc = xs_recv (xsub_inproc, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+    assert (buf [0] == 'x');
+    rc = xs_recv (xsub_inproc, buf, sizeof (buf), 0);
+    assert (rc == -1 && xs_errno () == EAGAIN);
+
+    //  Publish a burst of messages. The session reads them in batches and
+    //  matches each batch against the subscriptions in a single call.
+    char msg [16];
+    for (int i = 0; i != 300; i++) {
+        msg [0] = i % 3 == 1 ? 'b' : 'a';
+        msg [1] = (char) (i % 256);
+        rc = xs_send (xpub, msg, 2, i % 3 == 2 ? XS_SNDMORE : 0);
+        errno_assert (rc == 2);
+        if (i % 3 == 2) {
+            rc = xs_send (xpub, "z", 1, 0);
+            errno_assert (rc == 1);
+        }
+    }
+    for (int i = 0; i != 300; i++) {
+        if (i % 3 == 1)
+            continue;
+        rc = xs_recv (xsub_tcp, msg, sizeof (msg), 0);
+        errno_assert (rc == 2);
+        assert (msg [0] == 'a' && msg [1] == (char) (i % 256));
+        if (i % 3 == 2) {
+            rc = xs_recv (xsub_tcp, msg, sizeof (msg), 0);
+            errno_assert (rc == 1);
+            assert (msg [0] == 'z');
+        }
+    }
+    rc = xs_recv (xsub_tcp, buf, sizeof (buf), 0);
+    assert (rc == -1 && xs_errno () == EAGAIN);
+
+    //  Socket-side matching reports the subscribers of a single subscription
+    //  in chunks. Make sure all of them are reported.
+    void *xsubs [70];
+    sub [4] = 'd';
+    for (int i = 0; i != 70; i++) {
+        xsubs [i] = xs_socket (ctx, XS_XSUB);
+        errno_assert (xsubs [i]);
+        rc = xs_connect (xsubs [i], "inproc://a");
+        errno_assert (rc != -1);
+        rc = xs_send (xsubs [i], sub, sizeof (sub), 0);
+        errno_assert (rc == 5);
+    }
+    rc = xs_recv (xpub, buf, sizeof (buf), 0);
+    errno_assert (rc == 5);
+    rc = xs_send (xpub, "d", 1, 0);
+    errno_assert (rc == 1);
+    for (int i = 0; i != 70; i++) {
+        rc = xs_recv (xsubs [i], buf, sizeof (buf), 0);
+        errno_assert (rc == 1);
+        assert (buf [0] == 'd');
+        rc = xs_close (xsubs [i]);
+        errno_assert (rc == 0);
+    }
+
+    //  When the subscriber reconnects, the messages read in advance are
+    //  matched against the new subscriptions. Only the message that was
+    //  being sent at the time of disconnection is dropped, the messages
+    //  passed to the new connection are never cut in the middle.
+    void *xpub2 = xs_socket (ctx, XS_XPUB);
+    errno_assert (xpub2);
+    offload = 1;
+    rc = xs_setsockopt (xpub2, XS_FILTER_OFFLOAD, &offload, sizeof (offload));
+    errno_assert (rc == 0);
+    void *xsub = xs_socket (ctx, XS_XSUB);
+    errno_assert (xsub);
+    rc = xs_bind (xsub, "tcp://127.0.0.1:5561");
+    errno_assert (rc != -1);
+    rc = xs_connect (xpub2, "tcp://127.0.0.1:5561");
+    errno_assert (rc != -1);
+    sleep (1);
+    sub [4] = 'a';
+    rc = xs_send (xsub, sub, sizeof (sub), 0);
+    errno_assert (rc == 5);
+    rc = xs_recv (xpub2, buf, sizeof (buf), 0);
+    errno_assert (rc == 5);
+    sleep (1);
+
+    for (int i = 0; i != 300; i++) {
+        msg [0] = i % 2 ? 'b' : 'a';
+        rc = xs_send (xpub2, msg, 1, XS_SNDMORE);
+        errno_assert (rc == 1);
+        rc = xs_send (xpub2, msg, 1, XS_SNDMORE);
+        errno_assert (rc == 1);
+        rc = xs_send (xpub2, "z", 1, 0);
+        errno_assert (rc == 1);
+    }
+    rc = xs_recv (xsub, msg, sizeof (msg), 0);
+    errno_assert (rc == 1);
+    assert (msg [0] == 'a');
+    rc = xs_close (xsub);
+    errno_assert (rc == 0);
+    sleep (1);
+
+    xsub = xs_socket (ctx, XS_XSUB);
+    errno_assert (xsub);
+    rc = xs_setsockopt (xsub, XS_RCVTIMEO, &timeo, sizeof (timeo));
+    errno_assert (rc == 0);
+    rc = xs_bind (xsub, "tcp://127.0.0.1:5561");
+    errno_assert (rc != -1);
+    rc = xs_send (xsub, sub, sizeof (sub), 0);
+    errno_assert (rc == 5);
+
+    //  Let the subscriber attach to the new connection and resend its
+    //  subscriptions.
+    sleep (1);
+    rc = xs_recv (xsub, msg, sizeof (msg), XS_DONTWAIT);
+    assert (rc == -1 && xs_errno () == EAGAIN);
+    sleep (1);
+    rc = xs_send (xpub2, "a", 1, XS_SNDMORE);
+    errno_assert (rc == 1);
+    rc = xs_send (xpub2, "e", 1, XS_SNDMORE);
+    errno_assert (rc == 1);
+    rc = xs_send (xpub2, "z", 1, 0);
+    errno_assert (rc == 1);
+    while (true) {
+        rc = xs_recv (xsub, msg, sizeof (msg), 0);
+        errno_assert (rc == 1);
+        assert (msg [0] == 'a');
+        rc = xs_recv (xsub, msg, sizeof (msg), 0);
+        errno_assert (rc == 1);
+        char second = msg [0];
+        assert (second == 'a' || second == 'e');
+        rc = xs_recv (xsub, msg, sizeof (msg), 0);
+        errno_assert (rc == 1);
+        assert (msg [0] == 'z');
+        int more;
+        size_t moresz = sizeof (more);
+        rc = xs_getsockopt (xsub, XS_RCVMORE, &more, &moresz);
+        errno_assert (rc == 0);
+        assert (!more);
+        if (second == 'e')
+            break;
+    }
+    rc = xs_close (xsub);
+    errno_assert (rc == 0);
+    rc = xs_close (xpub2);
+    errno_assert (rc == 0);
+
+    //  Clean up.
+    rc = xs_close (xsub_tcp);
+    errno_assert (rc == 0);
+    rc = xs_close (xsub_inproc);
+    errno_assert (rc == 0);
+    rc = xs_close (xpub);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
@@ -0,0 +1,107 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+#include "../src/stdint.hpp"
+
+int XS_TEST_MAIN ()
+{
+    int rc;
+    char buf [10000];
+
+    fprintf (stderr, "hwm_bytes test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+
+    //  Limit the pipe only by the number of bytes. For inproc connections
+    //  the sender's and the receiver's limits are summed up.
+    int hwm = 0;
+    uint64_t hwm_bytes = 1000;
+    void *push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    rc = xs_setsockopt (push, XS_SNDHWM, &hwm, sizeof (hwm));
+    errno_assert (rc == 0);
+    rc = xs_setsockopt (push, XS_SNDHWM_BYTES, &hwm_bytes, sizeof (hwm_bytes));
+    errno_assert (rc == 0);
+    rc = xs_bind (push, "inproc://a");
+    errno_assert (rc != -1);
+    void *pull = xs_socket (ctx, XS_PULL);
+    errno_assert (pull);
+    rc = xs_setsockopt (pull, XS_RCVHWM, &hwm, sizeof (hwm));
+    errno_assert (rc == 0);
+    rc = xs_setsockopt (pull, XS_RCVHWM_BYTES, &hwm_bytes, sizeof (hwm_bytes));
+    errno_assert (rc == 0);
+    hwm_bytes = 0;
+    size_t size = sizeof (hwm_bytes);
+    rc = xs_getsockopt (pull, XS_RCVHWM_BYTES, &hwm_bytes, &size);
+    errno_assert (rc == 0);
+    assert (hwm_bytes == 1000 && size == sizeof (hwm_bytes));
+    rc = xs_connect (pull, "inproc://a");
+    errno_assert (rc != -1);
+
+    //  Messages of 100 bytes can be sent till there are 2000 bytes queued.
+    memset (buf, 0, sizeof (buf));
+    int sent = 0;
+    while (true) {
+        rc = xs_send (push, buf, 100, XS_DONTWAIT);
+        if (rc == -1) {
+            assert (errno == EAGAIN);
+            break;
+        }
+        errno_assert (rc == 100);
+        ++sent;
+    }
+    assert (sent == 20);
+
+    //  Once the messages are read, there's space in the pipe again. Message
+    //  larger than the limit can still be passed if the pipe is empty.
+    for (int i = 0; i != sent; i++) {
+        rc = xs_recv (pull, buf, sizeof (buf), 0);
+        errno_assert (rc == 100);
+    }
+    rc = xs_send (push, buf, 10000, XS_DONTWAIT);
+    errno_assert (rc == 10000);
+    rc = xs_send (push, buf, 100, XS_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = xs_recv (pull, buf, sizeof (buf), 0);
+    errno_assert (rc == 10000);
+
+    //  Multipart message is never blocked in the middle.
+    for (int i = 0; i != 30; i++) {
+        rc = xs_send (push, buf, 100, i == 29 ? XS_DONTWAIT :
+            XS_DONTWAIT | XS_SNDMORE);
+        errno_assert (rc == 100);
+    }
+    for (int i = 0; i != 30; i++) {
+        rc = xs_recv (pull, buf, sizeof (buf), 0);
+        errno_assert (rc == 100);
+    }
+
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
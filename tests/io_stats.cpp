@@ -0,0 +1,126 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    int rc;
+    char buf [32];
+    xs_io_stats_t stats [4];
+    size_t size;
+    int value;
+
+    fprintf (stderr, "io_stats test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+    value = 2;
+    rc = xs_setctxopt (ctx, XS_IO_THREADS, &value, sizeof (value));
+    errno_assert (rc == 0);
+    value = 2;
+    rc = xs_setctxopt (ctx, XS_IO_STATS, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    value = 1;
+    rc = xs_setctxopt (ctx, XS_IO_STATS, &value, sizeof (value));
+    errno_assert (rc == 0);
+    value = 0;
+    size = sizeof (value);
+    rc = xs_getctxopt (ctx, XS_IO_THREADS, &value, &size);
+    errno_assert (rc == 0);
+    assert (value == 2 && size == sizeof (value));
+    rc = xs_getctxopt (ctx, XS_IO_STATS, &value, &size);
+    errno_assert (rc == 0);
+    assert (value == 1);
+
+    //  No I/O threads are running before the first socket is created.
+    size = sizeof (stats);
+    rc = xs_getctxopt (ctx, XS_IO_THREAD_STATS, stats, &size);
+    errno_assert (rc == 0);
+    assert (size == 0);
+
+    void *pull = xs_socket (ctx, XS_PULL);
+    errno_assert (pull);
+    rc = xs_bind (pull, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+    void *push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+
+    //  The I/O threads are already running, the option can't be changed.
+    value = 0;
+    rc = xs_setctxopt (ctx, XS_IO_STATS, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    size = sizeof (value);
+    rc = xs_getctxopt (ctx, XS_IO_STATS, &value, &size);
+    errno_assert (rc == 0);
+    assert (value == 1);
+
+    rc = xs_connect (push, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+    for (int i = 0; i != 100; i++) {
+        rc = xs_send (push, "ABC", 3, 0);
+        errno_assert (rc == 3);
+    }
+    for (int i = 0; i != 100; i++) {
+        rc = xs_recv (pull, buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+    }
+
+    //  Let the threads publish the statistics.
+    sleep (1);
+
+    size = sizeof (stats);
+    rc = xs_getctxopt (ctx, XS_IO_THREAD_STATS, stats, &size);
+    errno_assert (rc == 0);
+    assert (size == 2 * sizeof (xs_io_stats_t));
+    unsigned long long wakeups = 0;
+    unsigned long long in_events = 0;
+    unsigned long long commands = 0;
+    int load = 0;
+    for (int i = 0; i != 2; i++) {
+        assert (stats [i].events >= stats [i].wakeups);
+        assert (stats [i].max_batch <= stats [i].events);
+        assert (stats [i].max_handler_ns <= stats [i].in_event_ns +
+            stats [i].out_event_ns + stats [i].timer_event_ns);
+        wakeups += stats [i].wakeups;
+        in_events += stats [i].in_events;
+        commands += stats [i].commands;
+        load += stats [i].load;
+    }
+    assert (wakeups > 0 && in_events > 0 && commands > 0);
+
+    //  Mailboxes of both threads, the listener and both ends
+    //  of the connection.
+    assert (load == 5);
+
+    //  Only as many threads as fit into the buffer are returned.
+    size = sizeof (xs_io_stats_t) + 1;
+    rc = xs_getctxopt (ctx, XS_IO_THREAD_STATS, stats, &size);
+    errno_assert (rc == 0);
+    assert (size == sizeof (xs_io_stats_t));
+
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
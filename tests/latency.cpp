@@ -0,0 +1,232 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "testutil.hpp"
+
+static void check_hop (xs_latency_stats_t *hop_, unsigned long long count_)
+{
+    assert (hop_->count == count_);
+    unsigned long long total = 0;
+    for (int i = 0; i != XS_LATENCY_BUCKETS; i++)
+        total += hop_->buckets [i];
+    assert (total == count_);
+    assert (hop_->max_ns <= hop_->sum_ns);
+}
+
+int XS_TEST_MAIN ()
+{
+    int rc;
+    char buf [64];
+    char large [100];
+    xs_latency_stats_t stats [XS_HOPS];
+    size_t size;
+    unsigned long long age;
+    int on = 1;
+
+    fprintf (stderr, "latency test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+
+    //  Over inproc transport the whole pipeline is the pipe itself.
+    void *push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    rc = xs_setsockopt (push, XS_LATENCY, &on, sizeof (on));
+    errno_assert (rc == 0);
+    rc = xs_bind (push, "inproc://a");
+    errno_assert (rc != -1);
+    void *pull = xs_socket (ctx, XS_PULL);
+    errno_assert (pull);
+    rc = xs_setsockopt (pull, XS_LATENCY, &on, sizeof (on));
+    errno_assert (rc == 0);
+    rc = xs_connect (pull, "inproc://a");
+    errno_assert (rc != -1);
+    rc = xs_send (push, "ABC", 3, 0);
+    errno_assert (rc == 3);
+
+    //  The stamps don't change the content of the message.
+    xs_msg_t msg;
+    rc = xs_msg_init (&msg);
+    errno_assert (rc == 0);
+    rc = xs_recvmsg (pull, &msg, 0);
+    errno_assert (rc == 3);
+    assert (memcmp (xs_msg_data (&msg), "ABC", 3) == 0);
+    size = sizeof (age);
+    rc = xs_getmsgopt (&msg, XS_AGE, &age, &size);
+    errno_assert (rc == 0);
+    assert (size == sizeof (age) && age > 0);
+    rc = xs_msg_close (&msg);
+    errno_assert (rc == 0);
+
+    size = sizeof (stats);
+    rc = xs_getsockopt (pull, XS_LATENCY_STATS, stats, &size);
+    errno_assert (rc == 0);
+    assert (size == sizeof (stats));
+    check_hop (&stats [XS_HOP_IN_PIPE], 1);
+    check_hop (&stats [XS_HOP_TOTAL], 1);
+    check_hop (&stats [XS_HOP_IN_DECODER], 0);
+    size = sizeof (stats) - 1;
+    rc = xs_getsockopt (pull, XS_LATENCY_STATS, stats, &size);
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+
+    //  Over TCP the sending side accounts for the outbound hops while
+    //  the receiving side accounts for the inbound ones.
+    pull = xs_socket (ctx, XS_PULL);
+    errno_assert (pull);
+    rc = xs_setsockopt (pull, XS_LATENCY, &on, sizeof (on));
+    errno_assert (rc == 0);
+    rc = xs_bind (pull, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+    push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    rc = xs_setsockopt (push, XS_LATENCY, &on, sizeof (on));
+    errno_assert (rc == 0);
+    rc = xs_connect (push, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+
+    memset (large, 'x', sizeof (large));
+    for (int i = 0; i != 10; i++) {
+        rc = xs_send (push, "ABC", 3, XS_SNDMORE);
+        errno_assert (rc == 3);
+        rc = xs_send (push, large, sizeof (large), 0);
+        errno_assert (rc == sizeof (large));
+    }
+    for (int i = 0; i != 10; i++) {
+        rc = xs_recv (pull, buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+        assert (memcmp (buf, "ABC", 3) == 0);
+        rc = xs_recv (pull, large, sizeof (large), 0);
+        errno_assert (rc == sizeof (large));
+        assert (large [0] == 'x' && large [sizeof (large) - 1] == 'x');
+    }
+
+    //  The sending side passes the samples to the socket only after the
+    //  data were written to the network. Give it some time to do so.
+    sleep (1);
+
+    size = sizeof (stats);
+    rc = xs_getsockopt (push, XS_LATENCY_STATS, stats, &size);
+    errno_assert (rc == 0);
+    check_hop (&stats [XS_HOP_OUT_PIPE], 20);
+    assert (stats [XS_HOP_OUT_ENGINE].count > 0);
+    check_hop (&stats [XS_HOP_IN_PIPE], 0);
+    size = sizeof (stats);
+    rc = xs_getsockopt (pull, XS_LATENCY_STATS, stats, &size);
+    errno_assert (rc == 0);
+    check_hop (&stats [XS_HOP_OUT_PIPE], 0);
+    check_hop (&stats [XS_HOP_IN_DECODER], 20);
+    check_hop (&stats [XS_HOP_IN_PIPE], 20);
+    check_hop (&stats [XS_HOP_TOTAL], 20);
+
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+
+    //  Stamps don't survive forwarding. A message received and re-sent by
+    //  a device that doesn't stamp the messages arrives unstamped.
+    push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    rc = xs_setsockopt (push, XS_LATENCY, &on, sizeof (on));
+    errno_assert (rc == 0);
+    rc = xs_bind (push, "inproc://b");
+    errno_assert (rc != -1);
+    void *fwdin = xs_socket (ctx, XS_PULL);
+    errno_assert (fwdin);
+    rc = xs_connect (fwdin, "inproc://b");
+    errno_assert (rc != -1);
+    void *fwdout = xs_socket (ctx, XS_PUSH);
+    errno_assert (fwdout);
+    rc = xs_bind (fwdout, "inproc://c");
+    errno_assert (rc != -1);
+    pull = xs_socket (ctx, XS_PULL);
+    errno_assert (pull);
+    rc = xs_setsockopt (pull, XS_LATENCY, &on, sizeof (on));
+    errno_assert (rc == 0);
+    rc = xs_connect (pull, "inproc://c");
+    errno_assert (rc != -1);
+
+    //  Small messages with no room left for the stamps are not stamped.
+    rc = xs_send (push, "ABCDEFGHIJKLMNOPQRSTUVWXYZ", 26, 0);
+    errno_assert (rc == 26);
+    rc = xs_msg_init (&msg);
+    errno_assert (rc == 0);
+    rc = xs_recvmsg (fwdin, &msg, 0);
+    errno_assert (rc == 26);
+    assert (memcmp (xs_msg_data (&msg), "ABCDEFGHIJKLMNOPQRSTUVWXYZ", 26) == 0);
+    size = sizeof (age);
+    rc = xs_getmsgopt (&msg, XS_AGE, &age, &size);
+    errno_assert (rc == 0);
+    assert (age == 0);
+
+    //  The largest small message that has room for the stamps.
+    rc = xs_send (push, "ABCDEFGHIJKLM", 13, 0);
+    errno_assert (rc == 13);
+    rc = xs_recvmsg (fwdin, &msg, 0);
+    errno_assert (rc == 13);
+    size = sizeof (age);
+    rc = xs_getmsgopt (&msg, XS_AGE, &age, &size);
+    errno_assert (rc == 0);
+    assert (age > 0);
+    rc = xs_sendmsg (fwdout, &msg, 0);
+    errno_assert (rc == 13);
+    rc = xs_recvmsg (pull, &msg, 0);
+    errno_assert (rc == 13);
+    assert (memcmp (xs_msg_data (&msg), "ABCDEFGHIJKLM", 13) == 0);
+    size = sizeof (age);
+    rc = xs_getmsgopt (&msg, XS_AGE, &age, &size);
+    errno_assert (rc == 0);
+    assert (age == 0);
+    rc = xs_msg_close (&msg);
+    errno_assert (rc == 0);
+    size = sizeof (stats);
+    rc = xs_getsockopt (pull, XS_LATENCY_STATS, stats, &size);
+    errno_assert (rc == 0);
+    check_hop (&stats [XS_HOP_IN_PIPE], 0);
+    check_hop (&stats [XS_HOP_TOTAL], 0);
+
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    rc = xs_close (fwdout);
+    errno_assert (rc == 0);
+    rc = xs_close (fwdin);
+    errno_assert (rc == 0);
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+
+    //  Messages that were never stamped have no age.
+    rc = xs_msg_init_size (&msg, 3);
+    errno_assert (rc == 0);
+    size = sizeof (age);
+    rc = xs_getmsgopt (&msg, XS_AGE, &age, &size);
+    errno_assert (rc == 0);
+    assert (age == 0);
+    rc = xs_msg_close (&msg);
+    errno_assert (rc == 0);
+
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
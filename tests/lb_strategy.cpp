@@ -0,0 +1,145 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    fprintf (stderr, "lb_strategy test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+
+    //  The option is specific to the load-balancing sockets.
+    void *pull_a = xs_socket (ctx, XS_PULL);
+    errno_assert (pull_a);
+    int strategy = XS_LB_LEAST_QUEUED;
+    int rc = xs_setsockopt (pull_a, XS_LB_STRATEGY, &strategy,
+        sizeof (strategy));
+    assert (rc == -1 && xs_errno () == ENOTSUP);
+
+    void *push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    strategy = 3;
+    rc = xs_setsockopt (push, XS_LB_STRATEGY, &strategy, sizeof (strategy));
+    assert (rc == -1 && xs_errno () == EINVAL);
+    strategy = XS_LB_LEAST_QUEUED;
+    rc = xs_setsockopt (push, XS_LB_STRATEGY, &strategy, sizeof (strategy));
+    errno_assert (rc == 0);
+    strategy = -1;
+    size_t size = sizeof (strategy);
+    rc = xs_getsockopt (push, XS_LB_STRATEGY, &strategy, &size);
+    errno_assert (rc == 0);
+    assert (strategy == XS_LB_LEAST_QUEUED);
+
+    //  Pipes can hold 20 messages each. Peers report reading 10 messages
+    //  at a time.
+    int hwm = 10;
+    rc = xs_setsockopt (push, XS_SNDHWM, &hwm, sizeof (hwm));
+    errno_assert (rc == 0);
+    rc = xs_bind (push, "inproc://a");
+    errno_assert (rc != -1);
+    rc = xs_setsockopt (pull_a, XS_RCVHWM, &hwm, sizeof (hwm));
+    errno_assert (rc == 0);
+    rc = xs_connect (pull_a, "inproc://a");
+    errno_assert (rc != -1);
+    void *pull_b = xs_socket (ctx, XS_PULL);
+    errno_assert (pull_b);
+    rc = xs_setsockopt (pull_b, XS_RCVHWM, &hwm, sizeof (hwm));
+    errno_assert (rc == 0);
+    rc = xs_connect (pull_b, "inproc://a");
+    errno_assert (rc != -1);
+
+    //  Peer A never reads while peer B reads everything straight away.
+    //  Round-robin would keep sending to A until it hits the high watermark.
+    //  The least queued strategy stops sending to A much earlier.
+    int received_b = 0;
+    for (int i = 0; i != 100; i++) {
+        rc = xs_send (push, "x", 1, 0);
+        errno_assert (rc == 1);
+        char buf [1];
+        while (true) {
+            rc = xs_recv (pull_b, buf, sizeof (buf), XS_DONTWAIT);
+            if (rc == -1 && xs_errno () == EAGAIN)
+                break;
+            errno_assert (rc == 1);
+            received_b++;
+        }
+
+        //  Make the socket process the read notifications from B.
+        int events;
+        size = sizeof (events);
+        rc = xs_getsockopt (push, XS_EVENTS, &events, &size);
+        errno_assert (rc == 0);
+    }
+    assert (received_b > 100 - 15);
+
+    rc = xs_close (pull_b);
+    errno_assert (rc == 0);
+    rc = xs_close (pull_a);
+    errno_assert (rc == 0);
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+
+    //  Power of two choices delivers all the messages.
+    push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    strategy = XS_LB_TWO_CHOICES;
+    rc = xs_setsockopt (push, XS_LB_STRATEGY, &strategy, sizeof (strategy));
+    errno_assert (rc == 0);
+    rc = xs_bind (push, "inproc://b");
+    errno_assert (rc != -1);
+    pull_a = xs_socket (ctx, XS_PULL);
+    errno_assert (pull_a);
+    rc = xs_connect (pull_a, "inproc://b");
+    errno_assert (rc != -1);
+    pull_b = xs_socket (ctx, XS_PULL);
+    errno_assert (pull_b);
+    rc = xs_connect (pull_b, "inproc://b");
+    errno_assert (rc != -1);
+    for (int i = 0; i != 100; i++) {
+        rc = xs_send (push, "x", 1, 0);
+        errno_assert (rc == 1);
+    }
+    int received = 0;
+    while (received != 100) {
+        char buf [1];
+        rc = xs_recv (pull_a, buf, sizeof (buf), XS_DONTWAIT);
+        if (rc == -1 && xs_errno () == EAGAIN)
+            rc = xs_recv (pull_b, buf, sizeof (buf), XS_DONTWAIT);
+        if (rc == -1 && xs_errno () == EAGAIN)
+            break;
+        errno_assert (rc == 1);
+        received++;
+    }
+    assert (received == 100);
+
+    rc = xs_close (pull_b);
+    errno_assert (rc == 0);
+    rc = xs_close (pull_a);
+    errno_assert (rc == 0);
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
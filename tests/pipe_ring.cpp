@@ -0,0 +1,136 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    int rc;
+    int val;
+
+    fprintf (stderr, "pipe_ring test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+
+    //  Pipes are backed by rings only if explicitly asked for.
+    void *push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    size_t size = sizeof (val);
+    rc = xs_getsockopt (push, XS_PIPE_RING, &val, &size);
+    errno_assert (rc == 0);
+    assert (size == sizeof (val) && val == 0);
+    val = 2;
+    rc = xs_setsockopt (push, XS_PIPE_RING, &val, sizeof (val));
+    assert (rc == -1 && errno == EINVAL);
+    val = 1;
+    rc = xs_setsockopt (push, XS_PIPE_RING, &val, sizeof (val));
+    errno_assert (rc == 0);
+    size = sizeof (val);
+    rc = xs_getsockopt (push, XS_PIPE_RING, &val, &size);
+    errno_assert (rc == 0);
+    assert (val == 1);
+
+    //  Pipes with finite HWM are backed by a ring sized according to
+    //  the HWM. Make it as small as possible.
+    int hwm = 1;
+    rc = xs_setsockopt (push, XS_SNDHWM, &hwm, sizeof (hwm));
+    errno_assert (rc == 0);
+    rc = xs_bind (push, "inproc://a");
+    errno_assert (rc != -1);
+    void *pull = xs_socket (ctx, XS_PULL);
+    errno_assert (pull);
+    rc = xs_setsockopt (pull, XS_RCVHWM, &hwm, sizeof (hwm));
+    errno_assert (rc == 0);
+    rc = xs_connect (pull, "inproc://a");
+    errno_assert (rc != -1);
+
+    //  Wrap around the ring many times.
+    for (int i = 0; i != 1000; i++) {
+        rc = xs_send (push, &i, sizeof (i), XS_DONTWAIT);
+        errno_assert (rc == sizeof (i));
+        rc = xs_recv (pull, &val, sizeof (val), 0);
+        errno_assert (rc == sizeof (val));
+        assert (val == i);
+    }
+
+    //  HWM is still enforced. For inproc the limits are summed up.
+    int sent = 0;
+    while (true) {
+        rc = xs_send (push, &sent, sizeof (sent), XS_DONTWAIT);
+        if (rc == -1) {
+            assert (errno == EAGAIN);
+            break;
+        }
+        ++sent;
+    }
+    assert (sent == 2);
+    for (int i = 0; i != sent; i++) {
+        rc = xs_recv (pull, &val, sizeof (val), 0);
+        errno_assert (rc == sizeof (val));
+        assert (val == i);
+    }
+
+    //  Multipart message that doesn't fit into the ring.
+    for (int i = 0; i != 200; i++) {
+        rc = xs_send (push, &i, sizeof (i), i == 199 ? XS_DONTWAIT :
+            XS_DONTWAIT | XS_SNDMORE);
+        errno_assert (rc == sizeof (i));
+    }
+    for (int i = 0; i != 200; i++) {
+        rc = xs_recv (pull, &val, sizeof (val), 0);
+        errno_assert (rc == sizeof (val));
+        assert (val == i);
+    }
+
+    //  The pipe keeps working after the ring was replaced by a larger one.
+    for (int i = 0; i != 1000; i++) {
+        rc = xs_send (push, &i, sizeof (i), XS_DONTWAIT);
+        errno_assert (rc == sizeof (i));
+        rc = xs_recv (pull, &val, sizeof (val), 0);
+        errno_assert (rc == sizeof (val));
+        assert (val == i);
+    }
+
+    //  Unfinished multipart message spanning several rings is rolled back
+    //  when the sender goes away.
+    rc = xs_send (push, "A", 1, 0);
+    errno_assert (rc == 1);
+    for (int i = 0; i != 500; i++) {
+        rc = xs_send (push, &i, sizeof (i), XS_SNDMORE);
+        errno_assert (rc == sizeof (i));
+    }
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+    char buf [32];
+    rc = xs_recv (pull, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+    assert (buf [0] == 'A');
+    rc = xs_recv (pull, buf, sizeof (buf), XS_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
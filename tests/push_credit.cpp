@@ -0,0 +1,195 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    int rc;
+    char buf [32];
+
+    fprintf (stderr, "push_credit test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+
+    //  Use version 4 of the pattern, i.e. credit-based flow control, on both
+    //  sides of the connections.
+    int version = 4;
+    void *push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    rc = xs_setsockopt (push, XS_PATTERN_VERSION, &version, sizeof (version));
+    errno_assert (rc == 0);
+    int timeo = 2000;
+    rc = xs_setsockopt (push, XS_SNDTIMEO, &timeo, sizeof (timeo));
+    errno_assert (rc == 0);
+    rc = xs_bind (push, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+
+    //  Each worker accepts two messages at most.
+    void *pulls [2];
+    for (int i = 0; i != 2; i++) {
+        pulls [i] = xs_socket (ctx, XS_PULL);
+        errno_assert (pulls [i]);
+        rc = xs_setsockopt (pulls [i], XS_PATTERN_VERSION, &version,
+            sizeof (version));
+        errno_assert (rc == 0);
+        int hwm = 2;
+        rc = xs_setsockopt (pulls [i], XS_RCVHWM, &hwm, sizeof (hwm));
+        errno_assert (rc == 0);
+        rc = xs_setsockopt (pulls [i], XS_RCVTIMEO, &timeo, sizeof (timeo));
+        errno_assert (rc == 0);
+        rc = xs_connect (pulls [i], "tcp://127.0.0.1:5560");
+        errno_assert (rc != -1);
+    }
+    sleep (1);
+
+    //  Only the messages the workers have granted credit for can be sent,
+    //  even though there's plenty of space in the TCP buffers.
+    int sent = 0;
+    while (true) {
+        rc = xs_send (push, "ABC", 3, XS_DONTWAIT);
+        if (rc == -1) {
+            assert (errno == EAGAIN);
+            break;
+        }
+        errno_assert (rc == 3);
+        ++sent;
+    }
+    assert (sent == 4);
+
+    //  The second worker processes its messages and the first one stalls.
+    //  All subsequent messages go to the second worker.
+    for (int i = 0; i != 2; i++) {
+        rc = xs_recv (pulls [1], buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+    }
+    for (int i = 0; i != 10; i++) {
+        rc = xs_send (push, "DE", 2, 0);
+        errno_assert (rc == 2);
+        rc = xs_recv (pulls [1], buf, sizeof (buf), 0);
+        errno_assert (rc == 2);
+    }
+
+    //  The first worker gets only the messages within its credit.
+    for (int i = 0; i != 2; i++) {
+        rc = xs_recv (pulls [0], buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+    }
+    sleep (1);
+    rc = xs_recv (pulls [0], buf, sizeof (buf), XS_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
+    for (int i = 0; i != 2; i++) {
+        rc = xs_close (pulls [i]);
+        errno_assert (rc == 0);
+    }
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+
+    //  When the connecting PUSH socket reconnects, the messages queued for
+    //  the old worker are passed to the new one and count against the credit
+    //  it grants.
+    push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    rc = xs_setsockopt (push, XS_PATTERN_VERSION, &version, sizeof (version));
+    errno_assert (rc == 0);
+    int window = 10;
+    void *pull = NULL;
+    for (int round = 0; round != 2; round++) {
+        pull = xs_socket (ctx, XS_PULL);
+        errno_assert (pull);
+        rc = xs_setsockopt (pull, XS_PATTERN_VERSION, &version,
+            sizeof (version));
+        errno_assert (rc == 0);
+        rc = xs_setsockopt (pull, XS_RCVHWM, &window, sizeof (window));
+        errno_assert (rc == 0);
+        rc = xs_setsockopt (pull, XS_RCVTIMEO, &timeo, sizeof (timeo));
+        errno_assert (rc == 0);
+        rc = xs_bind (pull, "tcp://127.0.0.1:5561");
+        errno_assert (rc != -1);
+        if (round == 0) {
+            rc = xs_connect (push, "tcp://127.0.0.1:5561");
+            errno_assert (rc != -1);
+        }
+        sleep (1);
+
+        //  The worker grants the credit once it processes the new connection.
+        int events;
+        size_t events_size = sizeof (events);
+        rc = xs_getsockopt (pull, XS_EVENTS, &events, &events_size);
+        errno_assert (rc == 0);
+        sleep (1);
+        if (round == 1)
+            break;
+
+        //  Let the first worker process some messages and get replaced.
+        for (int i = 0; i != window / 2; i++) {
+            rc = xs_send (push, "ABC", 3, 0);
+            errno_assert (rc == 3);
+            rc = xs_recv (pull, buf, sizeof (buf), 0);
+            errno_assert (rc == 3);
+        }
+        sleep (1);
+        rc = xs_close (pull);
+        errno_assert (rc == 0);
+        sleep (1);
+
+        //  The credit left from the old connection is used to queue messages
+        //  till the new worker is available.
+        for (int i = 0; i != window; i++) {
+            buf [0] = 'Q';
+            buf [1] = (char) i;
+            rc = xs_send (push, buf, 2, XS_DONTWAIT);
+            errno_assert (rc == 2);
+        }
+    }
+
+    //  All the queued messages are delivered to the new worker. As they take
+    //  up the whole window, nothing else can be sent in the meantime.
+    rc = xs_send (push, "ABC", 3, XS_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+    for (int i = 0; i != window; i++) {
+        rc = xs_recv (pull, buf, sizeof (buf), 0);
+        errno_assert (rc == 2);
+        assert (buf [0] == 'Q' && buf [1] == (char) i);
+    }
+    sleep (1);
+    sent = 0;
+    while (true) {
+        rc = xs_send (push, "ABC", 3, XS_DONTWAIT);
+        if (rc == -1) {
+            assert (errno == EAGAIN);
+            break;
+        }
+        errno_assert (rc == 3);
+        ++sent;
+    }
+    assert (sent == window);
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
@@ -0,0 +1,84 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    fprintf (stderr, "rcvpriority test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+
+    //  Bulk data are received with the default priority, control messages
+    //  with the higher one.
+    void *pull = xs_socket (ctx, XS_PULL);
+    errno_assert (pull);
+    int rc = xs_bind (pull, "inproc://bulk");
+    errno_assert (rc != -1);
+    int priority = 1;
+    rc = xs_setsockopt (pull, XS_RCVPRIORITY, &priority, sizeof (priority));
+    errno_assert (rc == 0);
+    priority = 0;
+    size_t size = sizeof (priority);
+    rc = xs_getsockopt (pull, XS_RCVPRIORITY, &priority, &size);
+    errno_assert (rc == 0);
+    assert (priority == 1);
+    rc = xs_bind (pull, "inproc://control");
+    errno_assert (rc != -1);
+
+    void *bulk = xs_socket (ctx, XS_PUSH);
+    errno_assert (bulk);
+    rc = xs_connect (bulk, "inproc://bulk");
+    errno_assert (rc != -1);
+    void *control = xs_socket (ctx, XS_PUSH);
+    errno_assert (control);
+    rc = xs_connect (control, "inproc://control");
+    errno_assert (rc != -1);
+
+    for (int i = 0; i != 10; i++) {
+        rc = xs_send (bulk, "b", 1, 0);
+        errno_assert (rc == 1);
+    }
+    for (int i = 0; i != 2; i++) {
+        rc = xs_send (control, "c", 1, 0);
+        errno_assert (rc == 1);
+    }
+
+    //  Control messages overtake the bulk data queued before them.
+    for (int i = 0; i != 12; i++) {
+        char buf [1];
+        rc = xs_recv (pull, buf, sizeof (buf), 0);
+        errno_assert (rc == 1);
+        assert (buf [0] == (i < 2 ? 'c' : 'b'));
+    }
+
+    rc = xs_close (control);
+    errno_assert (rc == 0);
+    rc = xs_close (bulk);
+    errno_assert (rc == 0);
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
@@ -0,0 +1,118 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    fprintf (stderr, "req_pipeline test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+    void *xrep = xs_socket (ctx, XS_XREP);
+    errno_assert (xrep);
+    int rc = xs_bind (xrep, "inproc://a");
+    errno_assert (rc != -1);
+
+    //  The option is specific to REQ sockets.
+    int outstanding = 3;
+    rc = xs_setsockopt (xrep, XS_REQ_OUTSTANDING, &outstanding,
+        sizeof (outstanding));
+    assert (rc == -1 && xs_errno () == ENOTSUP);
+
+    void *req = xs_socket (ctx, XS_REQ);
+    errno_assert (req);
+    outstanding = 0;
+    rc = xs_setsockopt (req, XS_REQ_OUTSTANDING, &outstanding,
+        sizeof (outstanding));
+    assert (rc == -1 && xs_errno () == EINVAL);
+    outstanding = 3;
+    rc = xs_setsockopt (req, XS_REQ_OUTSTANDING, &outstanding,
+        sizeof (outstanding));
+    errno_assert (rc == 0);
+    outstanding = 0;
+    size_t size = sizeof (outstanding);
+    rc = xs_getsockopt (req, XS_REQ_OUTSTANDING, &outstanding, &size);
+    errno_assert (rc == 0);
+    assert (outstanding == 3);
+    rc = xs_connect (req, "inproc://a");
+    errno_assert (rc != -1);
+
+    //  Three requests can be sent without waiting for the replies.
+    rc = xs_send (req, "A", 1, 0);
+    errno_assert (rc == 1);
+    rc = xs_send (req, "B", 1, 0);
+    errno_assert (rc == 1);
+    rc = xs_send (req, "C", 1, 0);
+    errno_assert (rc == 1);
+    rc = xs_send (req, "D", 1, XS_DONTWAIT);
+    assert (rc == -1 && xs_errno () == EFSM);
+
+    //  Each request consists of peer identity, request ID, delimiter
+    //  and body.
+    unsigned char parts [3][3][16];
+    int sizes [3][3];
+    for (int i = 0; i != 3; i++) {
+        for (int j = 0; j != 3; j++) {
+            rc = xs_recv (xrep, parts [i][j], sizeof (parts [i][j]), 0);
+            errno_assert (rc >= 0);
+            sizes [i][j] = rc;
+        }
+        char body [16];
+        rc = xs_recv (xrep, body, sizeof (body), 0);
+        errno_assert (rc == 1);
+        assert (body [0] == 'A' + i);
+    }
+
+    //  Reply in the reverse order.
+    for (int i = 2; i >= 0; i--) {
+        for (int j = 0; j != 3; j++) {
+            rc = xs_send (xrep, parts [i][j], sizes [i][j], XS_SNDMORE);
+            errno_assert (rc == sizes [i][j]);
+        }
+        char body = 'a' + i;
+        rc = xs_send (xrep, &body, 1, 0);
+        errno_assert (rc == 1);
+    }
+
+    //  The replies are passed to the user in the order of the requests.
+    for (int i = 0; i != 3; i++) {
+        char body;
+        rc = xs_recv (req, &body, 1, 0);
+        errno_assert (rc == 1);
+        assert (body == 'a' + i);
+    }
+
+    //  No more replies are expected.
+    char buf [16];
+    rc = xs_recv (req, buf, sizeof (buf), XS_DONTWAIT);
+    assert (rc == -1 && xs_errno () == EFSM);
+
+    //  Clean up.
+    rc = xs_close (req);
+    errno_assert (rc == 0);
+    rc = xs_close (xrep);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
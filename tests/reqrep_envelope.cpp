@@ -0,0 +1,203 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    fprintf (stderr, "reqrep_envelope test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+
+    //  Version 4 of the pattern packs the envelope into the body.
+    int version = 4;
+    void *xrep = xs_socket (ctx, XS_XREP);
+    errno_assert (xrep);
+    int rc = xs_setsockopt (xrep, XS_PATTERN_VERSION, &version,
+        sizeof (version));
+    errno_assert (rc == 0);
+    rc = xs_bind (xrep, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+
+    void *req = xs_socket (ctx, XS_REQ);
+    errno_assert (req);
+    rc = xs_setsockopt (req, XS_PATTERN_VERSION, &version, sizeof (version));
+    errno_assert (rc == 0);
+    rc = xs_connect (req, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+
+    //  XREP still gets the envelope as separate message parts. Check both
+    //  the small bodies packed along with the envelope and the large ones
+    //  sent separately. The packed envelope of REQ (request ID and
+    //  the bottom) takes 7 bytes, leaving 22 bytes for the body.
+    static char body [2000];
+    size_t sizes [] = {3, 22, 23, sizeof (body)};
+    for (int i = 0; i != 4; i++) {
+        memset (body, 'a' + i, sizeof (body));
+        rc = xs_send (req, body, sizes [i], XS_SNDMORE);
+        errno_assert (rc == (int) sizes [i]);
+        rc = xs_send (req, "end", 3, 0);
+        errno_assert (rc == 3);
+
+        unsigned char id [16];
+        int id_size = xs_recv (xrep, id, sizeof (id), 0);
+        errno_assert (id_size > 0);
+        unsigned char reqid [16];
+        rc = xs_recv (xrep, reqid, sizeof (reqid), 0);
+        errno_assert (rc == 4);
+        rc = xs_recv (xrep, NULL, 0, 0);
+        errno_assert (rc == 0);
+        int more;
+        size_t more_size = sizeof (more);
+        rc = xs_getsockopt (xrep, XS_RCVMORE, &more, &more_size);
+        errno_assert (rc == 0);
+        assert (more);
+        static char buf [sizeof (body)];
+        rc = xs_recv (xrep, buf, sizeof (buf), 0);
+        errno_assert (rc == (int) sizes [i]);
+        assert (memcmp (buf, body, sizes [i]) == 0);
+        rc = xs_recv (xrep, buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+        assert (memcmp (buf, "end", 3) == 0);
+        rc = xs_getsockopt (xrep, XS_RCVMORE, &more, &more_size);
+        errno_assert (rc == 0);
+        assert (!more);
+
+        //  Send the reply back using the same envelope.
+        rc = xs_send (xrep, id, id_size, XS_SNDMORE);
+        errno_assert (rc == id_size);
+        rc = xs_send (xrep, reqid, 4, XS_SNDMORE);
+        errno_assert (rc == 4);
+        rc = xs_send (xrep, NULL, 0, XS_SNDMORE);
+        errno_assert (rc == 0);
+        rc = xs_send (xrep, body, sizes [i], 0);
+        errno_assert (rc == (int) sizes [i]);
+
+        rc = xs_recv (req, buf, sizeof (buf), 0);
+        errno_assert (rc == (int) sizes [i]);
+        assert (memcmp (buf, body, sizes [i]) == 0);
+        rc = xs_getsockopt (req, XS_RCVMORE, &more, &more_size);
+        errno_assert (rc == 0);
+        assert (!more);
+    }
+
+    rc = xs_close (xrep);
+    errno_assert (rc == 0);
+    rc = xs_close (req);
+    errno_assert (rc == 0);
+
+    //  REQ and REP talking to each other directly.
+    void *rep = xs_socket (ctx, XS_REP);
+    errno_assert (rep);
+    rc = xs_setsockopt (rep, XS_PATTERN_VERSION, &version, sizeof (version));
+    errno_assert (rc == 0);
+    rc = xs_bind (rep, "tcp://127.0.0.1:5561");
+    errno_assert (rc != -1);
+    req = xs_socket (ctx, XS_REQ);
+    errno_assert (req);
+    rc = xs_setsockopt (req, XS_PATTERN_VERSION, &version, sizeof (version));
+    errno_assert (rc == 0);
+    rc = xs_connect (req, "tcp://127.0.0.1:5561");
+    errno_assert (rc != -1);
+    bounce (rep, req);
+
+    rc = xs_close (rep);
+    errno_assert (rc == 0);
+    rc = xs_close (req);
+    errno_assert (rc == 0);
+
+    //  A message that fails to be sent leaves no part of its envelope
+    //  behind to precede the next message.
+    void *xreq = xs_socket (ctx, XS_XREQ);
+    errno_assert (xreq);
+    rc = xs_setsockopt (xreq, XS_PATTERN_VERSION, &version, sizeof (version));
+    errno_assert (rc == 0);
+    rc = xs_send (xreq, "A", 1, XS_SNDMORE | XS_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
+    xrep = xs_socket (ctx, XS_XREP);
+    errno_assert (xrep);
+    rc = xs_setsockopt (xrep, XS_PATTERN_VERSION, &version, sizeof (version));
+    errno_assert (rc == 0);
+    rc = xs_bind (xrep, "inproc://a");
+    errno_assert (rc != -1);
+    rc = xs_connect (xreq, "inproc://a");
+    errno_assert (rc != -1);
+
+    static char label [300];
+    rc = xs_send (xreq, "B", 1, XS_SNDMORE);
+    errno_assert (rc == 1);
+    rc = xs_send (xreq, label, sizeof (label), XS_SNDMORE);
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = xs_send (xreq, "C", 1, XS_SNDMORE);
+    errno_assert (rc == 1);
+    rc = xs_send (xreq, NULL, 0, XS_SNDMORE);
+    errno_assert (rc == 0);
+    rc = xs_send (xreq, "body", 4, 0);
+    errno_assert (rc == 4);
+
+    char buf [16];
+    rc = xs_recv (xrep, buf, sizeof (buf), 0);
+    errno_assert (rc > 0);
+    rc = xs_recv (xrep, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+    assert (buf [0] == 'C');
+    rc = xs_recv (xrep, buf, sizeof (buf), 0);
+    errno_assert (rc == 0);
+    rc = xs_recv (xrep, buf, sizeof (buf), 0);
+    errno_assert (rc == 4);
+    assert (memcmp (buf, "body", 4) == 0);
+
+    //  The envelope is limited in total size as well.
+    for (int i = 0; i != 16; i++) {
+        rc = xs_send (xreq, label, 255, XS_SNDMORE);
+        errno_assert (rc == 255);
+    }
+    rc = xs_send (xreq, label, 255, XS_SNDMORE);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  A large body with no envelope at all follows the empty packed part.
+    memset (body, 'x', sizeof (body));
+    rc = xs_send (xreq, body, sizeof (body), 0);
+    errno_assert (rc == sizeof (body));
+    rc = xs_recv (xrep, buf, sizeof (buf), 0);
+    errno_assert (rc > 0);
+    static char large [sizeof (body)];
+    rc = xs_recv (xrep, large, sizeof (large), 0);
+    errno_assert (rc == sizeof (body));
+    assert (memcmp (large, body, sizeof (body)) == 0);
+    int more;
+    size_t more_size = sizeof (more);
+    rc = xs_getsockopt (xrep, XS_RCVMORE, &more, &more_size);
+    errno_assert (rc == 0);
+    assert (!more);
+
+    rc = xs_close (xrep);
+    errno_assert (rc == 0);
+    rc = xs_close (xreq);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
@@ -40,6 +40,9 @@ int XS_TEST_MAIN ()
     
     bounce (sb, sc);
 
+    //  Session has to expect the request ID of the next reply.
+    bounce (sb, sc);
+
     rc = xs_close (sc);
     errno_assert (rc == 0);
 
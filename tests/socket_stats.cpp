@@ -0,0 +1,152 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    int rc;
+    char buf [32];
+    xs_stats_t stats;
+    xs_pipe_stats_t pipe_stats [4];
+    size_t size;
+
+    fprintf (stderr, "socket_stats test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+
+    //  Multipart messages are counted once, bytes are counted for all parts.
+    void *push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    rc = xs_bind (push, "inproc://a");
+    errno_assert (rc != -1);
+    void *pull = xs_socket (ctx, XS_PULL);
+    errno_assert (pull);
+    rc = xs_connect (pull, "inproc://a");
+    errno_assert (rc != -1);
+    rc = xs_send (push, "ABC", 3, XS_SNDMORE);
+    errno_assert (rc == 3);
+    rc = xs_send (push, "DEFGH", 5, 0);
+    errno_assert (rc == 5);
+    rc = xs_recv (pull, buf, sizeof (buf), 0);
+    errno_assert (rc == 3);
+    rc = xs_recv (pull, buf, sizeof (buf), 0);
+    errno_assert (rc == 5);
+
+    size = sizeof (stats);
+    rc = xs_getsockopt (push, XS_STATS, &stats, &size);
+    errno_assert (rc == 0);
+    assert (size == sizeof (stats));
+    assert (stats.msgs_sent == 1 && stats.bytes_sent == 8);
+    assert (stats.msgs_received == 0 && stats.bytes_received == 0);
+    assert (stats.msgs_dropped == 0 && stats.pipes == 1);
+    size = sizeof (stats);
+    rc = xs_getsockopt (pull, XS_STATS, &stats, &size);
+    errno_assert (rc == 0);
+    assert (stats.msgs_received == 1 && stats.bytes_received == 8);
+    size = sizeof (stats) - 1;
+    rc = xs_getsockopt (pull, XS_STATS, &stats, &size);
+    assert (rc == -1 && errno == EINVAL);
+
+    size = sizeof (pipe_stats);
+    rc = xs_getsockopt (push, XS_PIPE_STATS, pipe_stats, &size);
+    errno_assert (rc == 0);
+    assert (size == sizeof (xs_pipe_stats_t));
+    assert (pipe_stats [0].msgs_out == 1 && pipe_stats [0].bytes_out == 8);
+    assert (pipe_stats [0].blocked_out == 0);
+    size = sizeof (pipe_stats);
+    rc = xs_getsockopt (pull, XS_PIPE_STATS, pipe_stats, &size);
+    errno_assert (rc == 0);
+    assert (size == sizeof (xs_pipe_stats_t));
+    assert (pipe_stats [0].msgs_in == 1 && pipe_stats [0].bytes_in == 8);
+
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+
+    //  Messages that don't fit into a slow subscriber's pipe are dropped.
+    int hwm = 10;
+    void *pub = xs_socket (ctx, XS_PUB);
+    errno_assert (pub);
+    rc = xs_setsockopt (pub, XS_SNDHWM, &hwm, sizeof (hwm));
+    errno_assert (rc == 0);
+    rc = xs_bind (pub, "inproc://b");
+    errno_assert (rc != -1);
+    void *sub = xs_socket (ctx, XS_SUB);
+    errno_assert (sub);
+    rc = xs_setsockopt (sub, XS_RCVHWM, &hwm, sizeof (hwm));
+    errno_assert (rc == 0);
+    rc = xs_setsockopt (sub, XS_SUBSCRIBE, "", 0);
+    errno_assert (rc == 0);
+    rc = xs_connect (sub, "inproc://b");
+    errno_assert (rc != -1);
+    sleep (1);
+
+    for (int i = 0; i != 100; i++) {
+        rc = xs_send (pub, "X", 1, 0);
+        errno_assert (rc == 1);
+    }
+    size = sizeof (stats);
+    rc = xs_getsockopt (pub, XS_STATS, &stats, &size);
+    errno_assert (rc == 0);
+    assert (stats.msgs_sent == 100 && stats.bytes_sent == 100);
+    size = sizeof (pipe_stats);
+    rc = xs_getsockopt (pub, XS_PIPE_STATS, pipe_stats, &size);
+    errno_assert (rc == 0);
+    assert (size == sizeof (xs_pipe_stats_t));
+    assert (pipe_stats [0].blocked_out == 1);
+    assert (pipe_stats [0].queued_out == pipe_stats [0].msgs_out);
+    assert (stats.msgs_dropped == 100 - pipe_stats [0].msgs_out);
+    assert (stats.msgs_dropped > 0);
+
+    rc = xs_close (sub);
+    errno_assert (rc == 0);
+    rc = xs_close (pub);
+    errno_assert (rc == 0);
+
+    //  Lost connections are reported as reconnects.
+    pull = xs_socket (ctx, XS_PULL);
+    errno_assert (pull);
+    rc = xs_bind (pull, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+    push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    rc = xs_connect (push, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+    rc = xs_send (push, "ABC", 3, 0);
+    errno_assert (rc == 3);
+    rc = xs_recv (pull, buf, sizeof (buf), 0);
+    errno_assert (rc == 3);
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    sleep (1);
+    size = sizeof (stats);
+    rc = xs_getsockopt (push, XS_STATS, &stats, &size);
+    errno_assert (rc == 0);
+    assert (stats.reconnects == 1);
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
@@ -0,0 +1,103 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    fprintf (stderr, "sub_aggregate test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+    void *xpub = xs_socket (ctx, XS_XPUB);
+    errno_assert (xpub);
+    int rc = xs_bind (xpub, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+
+    //  Forward at most 1-byte long prefixes upstream.
+    void *sub = xs_socket (ctx, XS_SUB);
+    errno_assert (sub);
+    int aggregate = 1;
+    rc = xs_setsockopt (sub, XS_FILTER_AGGREGATE, &aggregate,
+        sizeof (aggregate));
+    errno_assert (rc == 0);
+    rc = xs_connect (sub, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+
+    //  Two subscriptions with the same covering prefix and a short one.
+    rc = xs_setsockopt (sub, XS_SUBSCRIBE, "abc", 3);
+    errno_assert (rc == 0);
+    rc = xs_setsockopt (sub, XS_SUBSCRIBE, "abd", 3);
+    errno_assert (rc == 0);
+    rc = xs_setsockopt (sub, XS_SUBSCRIBE, "x", 1);
+    errno_assert (rc == 0);
+
+    //  The option can't be changed once there are subscriptions.
+    rc = xs_setsockopt (sub, XS_FILTER_AGGREGATE, &aggregate,
+        sizeof (aggregate));
+    assert (rc == -1 && xs_errno () == EINVAL);
+
+    //  Only the covering prefix and the short subscription are forwarded.
+    char buf [8];
+    rc = xs_recv (xpub, buf, sizeof (buf), 0);
+    errno_assert (rc == 5);
+    assert (buf [1] == 1 && buf [4] == 'a');
+    rc = xs_recv (xpub, buf, sizeof (buf), 0);
+    errno_assert (rc == 5);
+    assert (buf [1] == 1 && buf [4] == 'x');
+
+    //  The covering prefix is withdrawn with the last subscription it covers.
+    rc = xs_setsockopt (sub, XS_UNSUBSCRIBE, "abc", 3);
+    errno_assert (rc == 0);
+    rc = xs_setsockopt (sub, XS_UNSUBSCRIBE, "x", 1);
+    errno_assert (rc == 0);
+    rc = xs_recv (xpub, buf, sizeof (buf), 0);
+    errno_assert (rc == 5);
+    assert (buf [1] == 2 && buf [4] == 'x');
+    rc = xs_setsockopt (sub, XS_UNSUBSCRIBE, "abd", 3);
+    errno_assert (rc == 0);
+    rc = xs_recv (xpub, buf, sizeof (buf), 0);
+    errno_assert (rc == 5);
+    assert (buf [1] == 2 && buf [4] == 'a');
+
+    //  Subscriber still does the exact filtering.
+    rc = xs_setsockopt (sub, XS_SUBSCRIBE, "abc", 3);
+    errno_assert (rc == 0);
+    rc = xs_recv (xpub, buf, sizeof (buf), 0);
+    errno_assert (rc == 5);
+    sleep (1);
+    rc = xs_send (xpub, "abz", 3, 0);
+    errno_assert (rc == 3);
+    rc = xs_send (xpub, "abc", 3, 0);
+    errno_assert (rc == 3);
+    rc = xs_recv (sub, buf, sizeof (buf), 0);
+    errno_assert (rc == 3);
+    assert (memcmp (buf, "abc", 3) == 0);
+
+    //  Clean up.
+    rc = xs_close (sub);
+    errno_assert (rc == 0);
+    rc = xs_close (xpub);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
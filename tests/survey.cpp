@@ -56,11 +56,11 @@ int XS_TEST_MAIN ()
     errno_assert (rc == 3);
 
     //  Forward the survey through the intermediate device.
-    //  Survey consist of identity (4 bytes), survey ID (4 bytes) and the body.
+    //  Survey consist of identity (8 bytes), survey ID (4 bytes) and the body.
     rc = xs_recv (xrespondent, buf, sizeof (buf), 0);
-    errno_assert (rc == 4);
-    rc = xs_send (xsurveyor, buf, 4, XS_SNDMORE);
-    errno_assert (rc == 4);
+    errno_assert (rc == 8);
+    rc = xs_send (xsurveyor, buf, 8, XS_SNDMORE);
+    errno_assert (rc == 8);
     rc = xs_recv (xrespondent, buf, sizeof (buf), 0);
     errno_assert (rc == 4);
     rc = xs_send (xsurveyor, buf, 4, XS_SNDMORE);
@@ -78,9 +78,9 @@ int XS_TEST_MAIN ()
 
     //  Forward the response through the intermediate device.
     rc = xs_recv (xsurveyor, buf, sizeof (buf), 0);
-    errno_assert (rc == 4);
-    rc = xs_send (xrespondent, buf, 4, XS_SNDMORE);
-    errno_assert (rc == 4);
+    errno_assert (rc == 8);
+    rc = xs_send (xrespondent, buf, 8, XS_SNDMORE);
+    errno_assert (rc == 8);
     rc = xs_recv (xsurveyor, buf, sizeof (buf), 0);
     errno_assert (rc == 4);
     rc = xs_send (xrespondent, buf, 4, XS_SNDMORE);
@@ -102,9 +102,9 @@ int XS_TEST_MAIN ()
 
     //  Forward the response through the intermediate device.
     rc = xs_recv (xsurveyor, buf, sizeof (buf), 0);
-    errno_assert (rc == 4);
-    rc = xs_send (xrespondent, buf, 4, XS_SNDMORE);
-    errno_assert (rc == 4);
+    errno_assert (rc == 8);
+    rc = xs_send (xrespondent, buf, 8, XS_SNDMORE);
+    errno_assert (rc == 8);
     rc = xs_recv (xsurveyor, buf, sizeof (buf), 0);
     errno_assert (rc == 4);
     rc = xs_send (xrespondent, buf, 4, XS_SNDMORE);
@@ -139,9 +139,9 @@ int XS_TEST_MAIN ()
 
     //  Read, process and reply to the old survey.
     rc = xs_recv (xrespondent, buf, sizeof (buf), 0);
-    errno_assert (rc == 4);
-    rc = xs_send (xrespondent, buf, 4, XS_SNDMORE);
-    errno_assert (rc == 4);
+    errno_assert (rc == 8);
+    rc = xs_send (xrespondent, buf, 8, XS_SNDMORE);
+    errno_assert (rc == 8);
     rc = xs_recv (xrespondent, buf, sizeof (buf), 0);
     errno_assert (rc == 4);
     rc = xs_send (xrespondent, buf, 4, XS_SNDMORE);
@@ -153,9 +153,9 @@ int XS_TEST_MAIN ()
 
     //  Read, process and reply to the new survey.
     rc = xs_recv (xrespondent, buf, sizeof (buf), 0);
-    errno_assert (rc == 4);
-    rc = xs_send (xrespondent, buf, 4, XS_SNDMORE);
-    errno_assert (rc == 4);
+    errno_assert (rc == 8);
+    rc = xs_send (xrespondent, buf, 8, XS_SNDMORE);
+    errno_assert (rc == 8);
     rc = xs_recv (xrespondent, buf, sizeof (buf), 0);
     errno_assert (rc == 4);
     rc = xs_send (xrespondent, buf, 4, XS_SNDMORE);
@@ -170,6 +170,33 @@ int XS_TEST_MAIN ()
     rc = xs_recv (surveyor, buf, sizeof (buf), 0);
     errno_assert (rc == 2);
 
+    //  Survey deadline wakes up blocking recv even if RCVTIMEO is longer.
+    //  Once expired, the survey is reported as timed out immediately.
+    int rcvtimeo = 1000;
+    rc = xs_setsockopt (surveyor, XS_RCVTIMEO, &rcvtimeo, sizeof (int));
+    errno_assert (rc == 0);
+    rc = xs_send (surveyor, "ABC", 3, 0);
+    errno_assert (rc == 3);
+    watch = xs_stopwatch_start ();
+    rc = xs_recv (surveyor, buf, sizeof (buf), 0);
+    assert (rc == - 1 && errno == ETIMEDOUT);
+    elapsed = xs_stopwatch_stop (watch) / 1000;
+    time_assert (elapsed, (unsigned long) timeout);
+    rc = xs_recv (surveyor, buf, sizeof (buf), XS_DONTWAIT);
+    assert (rc == - 1 && errno == ETIMEDOUT);
+
+    //  RCVTIMEO shorter than the survey deadline results in EAGAIN.
+    rcvtimeo = 50;
+    rc = xs_setsockopt (surveyor, XS_RCVTIMEO, &rcvtimeo, sizeof (int));
+    errno_assert (rc == 0);
+    rc = xs_send (surveyor, "ABC", 3, 0);
+    errno_assert (rc == 3);
+    rc = xs_recv (surveyor, buf, sizeof (buf), 0);
+    assert (rc == - 1 && errno == EAGAIN);
+    rcvtimeo = -1;
+    rc = xs_setsockopt (surveyor, XS_RCVTIMEO, &rcvtimeo, sizeof (int));
+    errno_assert (rc == 0);
+
     rc = xs_close (respondent2);
     errno_assert (rc == 0);
     rc = xs_close (respondent1);
@@ -0,0 +1,136 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    int rc;
+    char buf [32];
+
+    fprintf (stderr, "survey_quorum test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+    void *surveyor = xs_socket (ctx, XS_SURVEYOR);
+    errno_assert (surveyor);
+    rc = xs_bind (surveyor, "inproc://a");
+    errno_assert (rc != -1);
+    void *respondents [3];
+    for (int i = 0; i != 3; i++) {
+        respondents [i] = xs_socket (ctx, XS_RESPONDENT);
+        errno_assert (respondents [i]);
+        rc = xs_connect (respondents [i], "inproc://a");
+        errno_assert (rc != -1);
+    }
+
+    //  The survey timeout is long. The survey should complete as soon as
+    //  all the respondents have answered.
+    int timeout = 5000;
+    rc = xs_setsockopt (surveyor, XS_SURVEY_TIMEOUT, &timeout, sizeof (int));
+    errno_assert (rc == 0);
+    int quorum = -1;
+    rc = xs_setsockopt (surveyor, XS_SURVEY_QUORUM, &quorum, sizeof (int));
+    errno_assert (rc == 0);
+    quorum = 0;
+    size_t size = sizeof (quorum);
+    rc = xs_getsockopt (surveyor, XS_SURVEY_QUORUM, &quorum, &size);
+    errno_assert (rc == 0);
+    assert (quorum == -1);
+
+    void *watch = xs_stopwatch_start ();
+    rc = xs_send (surveyor, "ABC", 3, 0);
+    errno_assert (rc == 3);
+    for (int i = 0; i != 3; i++) {
+        rc = xs_recv (respondents [i], buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+        rc = xs_send (respondents [i], "DE", 2, 0);
+        errno_assert (rc == 2);
+    }
+    for (int i = 0; i != 3; i++) {
+        rc = xs_recv (surveyor, buf, sizeof (buf), 0);
+        errno_assert (rc == 2);
+    }
+
+    //  Completion of the survey is signaled as POLLIN.
+    xs_pollitem_t pi;
+    pi.socket = surveyor;
+    pi.events = XS_POLLIN;
+    rc = xs_poll (&pi, 1, timeout);
+    errno_assert (rc == 1);
+    rc = xs_recv (surveyor, buf, sizeof (buf), 0);
+    assert (rc == -1 && errno == EQUORUM);
+    unsigned long elapsed = xs_stopwatch_stop (watch) / 1000;
+    assert (elapsed < (unsigned long) timeout / 2);
+
+    //  With the quorum of two, the third response is discarded.
+    quorum = 2;
+    rc = xs_setsockopt (surveyor, XS_SURVEY_QUORUM, &quorum, sizeof (int));
+    errno_assert (rc == 0);
+    rc = xs_send (surveyor, "FGH", 3, 0);
+    errno_assert (rc == 3);
+    for (int i = 0; i != 3; i++) {
+        rc = xs_recv (respondents [i], buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+        rc = xs_send (respondents [i], "IJ", 2, 0);
+        errno_assert (rc == 2);
+    }
+    for (int i = 0; i != 2; i++) {
+        rc = xs_recv (surveyor, buf, sizeof (buf), 0);
+        errno_assert (rc == 2);
+    }
+    rc = xs_recv (surveyor, buf, sizeof (buf), 0);
+    assert (rc == -1 && errno == EQUORUM);
+
+    //  The quorum never exceeds the number of respondents reached.
+    quorum = 10;
+    rc = xs_setsockopt (surveyor, XS_SURVEY_QUORUM, &quorum, sizeof (int));
+    errno_assert (rc == 0);
+    rc = xs_send (surveyor, "KLM", 3, 0);
+    errno_assert (rc == 3);
+    for (int i = 0; i != 3; i++) {
+        rc = xs_recv (respondents [i], buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+        rc = xs_send (respondents [i], "NO", 2, 0);
+        errno_assert (rc == 2);
+    }
+    for (int i = 0; i != 3; i++) {
+        rc = xs_recv (surveyor, buf, sizeof (buf), 0);
+        errno_assert (rc == 2);
+    }
+    rc = xs_recv (surveyor, buf, sizeof (buf), 0);
+    assert (rc == -1 && errno == EQUORUM);
+
+    //  The option is not supported by other socket types.
+    rc = xs_setsockopt (respondents [0], XS_SURVEY_QUORUM, &quorum,
+        sizeof (int));
+    assert (rc == -1 && errno == ENOTSUP);
+
+    for (int i = 0; i != 3; i++) {
+        rc = xs_close (respondents [i]);
+        errno_assert (rc == 0);
+    }
+    rc = xs_close (surveyor);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
@@ -123,6 +123,74 @@
 #include "backlog.cpp"
 #undef XS_TEST_MAIN
 
+#define XS_TEST_MAIN filter_offload
+#include "filter_offload.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN sub_aggregate
+#include "sub_aggregate.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN exact_filter
+#include "exact_filter.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN req_pipeline
+#include "req_pipeline.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN reqrep_envelope
+#include "reqrep_envelope.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN lb_strategy
+#include "lb_strategy.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN rcvpriority
+#include "rcvpriority.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN survey_quorum
+#include "survey_quorum.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN xrep_slots
+#include "xrep_slots.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN push_credit
+#include "push_credit.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN hwm_bytes
+#include "hwm_bytes.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN pipe_ring
+#include "pipe_ring.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN socket_stats
+#include "socket_stats.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN io_stats
+#include "io_stats.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN trace
+#include "trace.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN latency
+#include "latency.cpp"
+#undef XS_TEST_MAIN
+
+#define XS_TEST_MAIN clock
+#include "clock.cpp"
+#undef XS_TEST_MAIN
+
 int main ()
 {
     int rc;
@@ -173,6 +241,40 @@ int main ()
     assert (rc == 0);
     rc = backlog ();
     assert (rc == 0);
+    rc = filter_offload ();
+    assert (rc == 0);
+    rc = sub_aggregate ();
+    assert (rc == 0);
+    rc = exact_filter ();
+    assert (rc == 0);
+    rc = req_pipeline ();
+    assert (rc == 0);
+    rc = reqrep_envelope ();
+    assert (rc == 0);
+    rc = lb_strategy ();
+    assert (rc == 0);
+    rc = rcvpriority ();
+    assert (rc == 0);
+    rc = survey_quorum ();
+    assert (rc == 0);
+    rc = xrep_slots ();
+    assert (rc == 0);
+    rc = push_credit ();
+    assert (rc == 0);
+    rc = hwm_bytes ();
+    assert (rc == 0);
+    rc = pipe_ring ();
+    assert (rc == 0);
+    rc = socket_stats ();
+    assert (rc == 0);
+    rc = io_stats ();
+    assert (rc == 0);
+    rc = trace ();
+    assert (rc == 0);
+    rc = latency ();
+    assert (rc == 0);
+    rc = clock ();
+    assert (rc == 0);
     fprintf (stderr, "SUCCESS\n");
     sleep (1);
 
@@ -0,0 +1,203 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "testutil.hpp"
+
+static int count_events (const char *filename_, const char *name_)
+{
+    FILE *f = fopen (filename_, "r");
+    assert (f);
+    char line [256];
+    char name [64];
+    int count = 0;
+    while (fgets (line, sizeof (line), f)) {
+        if (line [0] == '#')
+            continue;
+        int rc = sscanf (line, "%*s %*s %63s", name);
+        assert (rc == 1);
+        if (strcmp (name, name_) == 0)
+            count++;
+    }
+    fclose (f);
+    return count;
+}
+
+static int max_thread_events (const char *filename_)
+{
+    FILE *f = fopen (filename_, "r");
+    assert (f);
+    char line [256];
+    int counts [64] = {0};
+    int max = 0;
+    while (fgets (line, sizeof (line), f)) {
+        if (line [0] == '#')
+            continue;
+        int thread;
+        int rc = sscanf (line, "%*s %d", &thread);
+        assert (rc == 1 && thread >= 0 && thread < 64);
+        if (++counts [thread] > max)
+            max = counts [thread];
+    }
+    fclose (f);
+    return max;
+}
+
+//  Returns the number of events recorded by the threads numbered
+//  'first_thread_' and above. Stores the highest thread number seen.
+static int thread_events (const char *filename_, int first_thread_,
+    int *last_thread_)
+{
+    FILE *f = fopen (filename_, "r");
+    assert (f);
+    char line [256];
+    int count = 0;
+    *last_thread_ = -1;
+    while (fgets (line, sizeof (line), f)) {
+        if (line [0] == '#')
+            continue;
+        int thread;
+        int rc = sscanf (line, "%*s %d", &thread);
+        assert (rc == 1);
+        if (thread >= first_thread_)
+            count++;
+        if (thread > *last_thread_)
+            *last_thread_ = thread;
+    }
+    fclose (f);
+    return count;
+}
+
+static void short_lived (void *ctx_)
+{
+    for (int i = 0; i != 5; i++) {
+        void *s = xs_socket (ctx_, XS_PUSH);
+        errno_assert (s);
+        int rc = xs_close (s);
+        errno_assert (rc == 0);
+    }
+}
+
+int XS_TEST_MAIN ()
+{
+    int rc;
+    char buf [32];
+    const char *filename = "trace.log";
+
+    fprintf (stderr, "trace test running...\n");
+
+    rc = xs_trace_start (1000);
+    assert (rc == -1 && errno == EINVAL);
+    rc = xs_trace_start (1 << 30);
+    assert (rc == -1 && errno == EINVAL);
+    rc = xs_trace_start (0);
+    assert (rc == -1 && errno == EINVAL);
+    rc = xs_trace_start (1024);
+    errno_assert (rc == 0);
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+    void *pull = xs_socket (ctx, XS_PULL);
+    errno_assert (pull);
+    rc = xs_bind (pull, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+    void *push = xs_socket (ctx, XS_PUSH);
+    errno_assert (push);
+    rc = xs_connect (push, "tcp://127.0.0.1:5560");
+    errno_assert (rc != -1);
+    for (int i = 0; i != 10; i++) {
+        rc = xs_send (push, "ABC", 3, 0);
+        errno_assert (rc == 3);
+    }
+    for (int i = 0; i != 10; i++) {
+        rc = xs_recv (pull, buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+    }
+    rc = xs_trace_stop ();
+    errno_assert (rc == 0);
+
+    //  Each message passes two pipes, one at each end of the connection.
+    rc = xs_trace_dump (filename);
+    errno_assert (rc == 0);
+    assert (count_events (filename, "pipe_write") == 20);
+    assert (count_events (filename, "pipe_read") == 20);
+    assert (count_events (filename, "command_send") > 0);
+    assert (count_events (filename, "command_recv") > 0);
+    assert (count_events (filename, "engine_write") > 0);
+    assert (count_events (filename, "engine_read") > 0);
+
+    //  Once stopped, nothing more is recorded.
+    rc = xs_send (push, "ABC", 3, 0);
+    errno_assert (rc == 3);
+    rc = xs_recv (pull, buf, sizeof (buf), 0);
+    errno_assert (rc == 3);
+    rc = xs_trace_dump (filename);
+    errno_assert (rc == 0);
+    assert (count_events (filename, "pipe_write") == 20);
+
+    //  Only the last events fit into a small ring buffer.
+    rc = xs_trace_start (4);
+    errno_assert (rc == 0);
+    for (int i = 0; i != 10; i++) {
+        rc = xs_send (push, "ABC", 3, 0);
+        errno_assert (rc == 3);
+    }
+    rc = xs_trace_stop ();
+    errno_assert (rc == 0);
+    rc = xs_trace_dump (filename);
+    errno_assert (rc == 0);
+    assert (max_thread_events (filename) <= 4);
+    for (int i = 0; i != 10; i++) {
+        rc = xs_recv (pull, buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+    }
+
+#if !defined XS_HAVE_WINDOWS
+    //  Threads that have exited pass their buffers to the new ones. Apart
+    //  from the reaper thread, all the short-lived threads share one buffer.
+    int last_thread;
+    thread_events (filename, 0, &last_thread);
+    rc = xs_trace_start (16);
+    errno_assert (rc == 0);
+    for (int i = 0; i != 20; i++) {
+        void *thread = thread_create (short_lived, ctx);
+        thread_join (thread);
+    }
+    rc = xs_trace_stop ();
+    errno_assert (rc == 0);
+    rc = xs_trace_dump (filename);
+    errno_assert (rc == 0);
+    int first_thread = last_thread + 1;
+    assert (thread_events (filename, first_thread, &last_thread) <= 32);
+    assert (last_thread >= first_thread + 19);
+#endif
+
+    rc = xs_trace_dump (NULL);
+    assert (rc == -1 && errno == EFAULT);
+    rc = remove (filename);
+    assert (rc == 0);
+
+    rc = xs_close (push);
+    errno_assert (rc == 0);
+    rc = xs_close (pull);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}
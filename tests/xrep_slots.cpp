@@ -0,0 +1,117 @@
+/*
+    Copyright (c) 2012 250bpm s.r.o.
+    Copyright (c) 2012 Other contributors as noted in the AUTHORS file
+
+    This file is part of Crossroads I/O project.
+
+    Crossroads I/O is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Crossroads is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+int XS_TEST_MAIN ()
+{
+    int rc;
+    unsigned char id1 [32];
+    unsigned char id2 [32];
+    char buf [32];
+
+    fprintf (stderr, "xrep_slots test running...\n");
+
+    void *ctx = xs_init ();
+    errno_assert (ctx);
+    void *xrep = xs_socket (ctx, XS_XREP);
+    errno_assert (xrep);
+    rc = xs_bind (xrep, "inproc://a");
+    errno_assert (rc != -1);
+
+    //  Get the identity of the first peer.
+    void *xreq1 = xs_socket (ctx, XS_XREQ);
+    errno_assert (xreq1);
+    rc = xs_connect (xreq1, "inproc://a");
+    errno_assert (rc != -1);
+    rc = xs_send (xreq1, "A", 1, 0);
+    errno_assert (rc == 1);
+    rc = xs_recv (xrep, id1, sizeof (id1), 0);
+    errno_assert (rc == 9);
+    rc = xs_recv (xrep, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+
+    //  Disconnect the first peer and let XREP process the disconnection.
+    //  Disconnection requires several commands to be exchanged.
+    rc = xs_close (xreq1);
+    errno_assert (rc == 0);
+    xs_pollitem_t pi;
+    pi.socket = xrep;
+    pi.events = XS_POLLIN;
+    for (int i = 0; i != 5; i++) {
+        rc = xs_poll (&pi, 1, 100);
+        errno_assert (rc == 0);
+    }
+
+    //  The second peer reuses the slot of the first one, however, it gets
+    //  a different identity.
+    void *xreq2 = xs_socket (ctx, XS_XREQ);
+    errno_assert (xreq2);
+    rc = xs_connect (xreq2, "inproc://a");
+    errno_assert (rc != -1);
+    rc = xs_send (xreq2, "B", 1, 0);
+    errno_assert (rc == 1);
+    rc = xs_recv (xrep, id2, sizeof (id2), 0);
+    errno_assert (rc == 9);
+    rc = xs_recv (xrep, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+    assert (memcmp (id1, id2, 5) == 0);
+    assert (memcmp (id1, id2, 9) != 0);
+
+    //  Reply addressed to the first peer is dropped, reply addressed to
+    //  the second one is delivered.
+    rc = xs_send (xrep, id1, 9, XS_SNDMORE);
+    errno_assert (rc == 9);
+    rc = xs_send (xrep, "X", 1, 0);
+    errno_assert (rc == 1);
+    rc = xs_send (xrep, id2, 9, XS_SNDMORE);
+    errno_assert (rc == 9);
+    rc = xs_send (xrep, "Y", 1, 0);
+    errno_assert (rc == 1);
+    rc = xs_recv (xreq2, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+    assert (buf [0] == 'Y');
+    rc = xs_recv (xreq2, buf, sizeof (buf), XS_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
+    //  Identities that don't match any slot are dropped silently.
+    id2 [4] ^= 0xff;
+    rc = xs_send (xrep, id2, 9, XS_SNDMORE);
+    errno_assert (rc == 9);
+    rc = xs_send (xrep, "Z", 1, 0);
+    errno_assert (rc == 1);
+    rc = xs_send (xrep, "", 0, XS_SNDMORE);
+    errno_assert (rc == 0);
+    rc = xs_send (xrep, "Z", 1, 0);
+    errno_assert (rc == 1);
+    sleep (1);
+    rc = xs_recv (xreq2, buf, sizeof (buf), XS_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
+    rc = xs_close (xreq2);
+    errno_assert (rc == 0);
+    rc = xs_close (xrep);
+    errno_assert (rc == 0);
+    rc = xs_term (ctx);
+    errno_assert (rc == 0);
+
+    return 0 ;
+}